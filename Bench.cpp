@@ -0,0 +1,177 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <math.h>
+#include <ctype.h>
+#include <algorithm>
+#include "Bench.h"
+
+//two-sided 95% quantiles of t-distribution for 1..30 degrees of freedom
+static const double t95[30] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+
+static double GetT95(int df)
+{
+	if (df <= 30)
+		return t95[df - 1];
+	if (df <= 60)
+		return 2.000;
+	if (df <= 120)
+		return 1.980;
+	return 1.960;
+}
+
+static bool HasExt(char* fn, const char* ext)
+{
+	size_t len = strlen(fn);
+	size_t ext_len = strlen(ext);
+	if (len < ext_len)
+		return false;
+	char* s = fn + len - ext_len;
+	for (size_t i = 0; i < ext_len; i++)
+		if (tolower(s[i]) != ext[i])
+			return false;
+	return true;
+}
+
+TBenchReport::TBenchReport()
+{
+	Range = 0;
+	DP = 0;
+	GpuCnt = 0;
+	Warmup = 0;
+	SeedSet = false;
+	Seed = 0;
+}
+
+void TBenchReport::Add(TBenchRec* rec)
+{
+	recs.push_back(*rec);
+}
+
+int TBenchReport::GetMeasuredCnt()
+{
+	int cnt = 0;
+	for (size_t i = 0; i < recs.size(); i++)
+		if (!recs[i].warmup)
+			cnt++;
+	return cnt;
+}
+
+void TBenchReport::Summarize(bool speed, TBenchSummary* res)
+{
+	std::vector <double> vals;
+	for (size_t i = 0; i < recs.size(); i++)
+		if (!recs[i].warmup)
+			vals.push_back(speed ? recs[i].speed : recs[i].K);
+	memset(res, 0, sizeof(TBenchSummary));
+	res->cnt = (int)vals.size();
+	if (!res->cnt)
+		return;
+	double sum = 0;
+	for (size_t i = 0; i < vals.size(); i++)
+		sum += vals[i];
+	res->mean = sum / res->cnt;
+	std::sort(vals.begin(), vals.end());
+	if (res->cnt & 1)
+		res->median = vals[res->cnt / 2];
+	else
+		res->median = (vals[res->cnt / 2 - 1] + vals[res->cnt / 2]) / 2;
+	res->ci_low = res->ci_high = res->mean;
+	if (res->cnt < 2)
+		return;
+	double sq = 0;
+	for (size_t i = 0; i < vals.size(); i++)
+		sq += (vals[i] - res->mean) * (vals[i] - res->mean);
+	res->stdev = sqrt(sq / (res->cnt - 1)); //sample stdev
+	double hw = GetT95(res->cnt - 1) * res->stdev / sqrt((double)res->cnt);
+	res->ci_low = res->mean - hw;
+	res->ci_high = res->mean + hw;
+}
+
+void TBenchReport::PrintSummary()
+{
+	TBenchSummary k, sp;
+	Summarize(false, &k);
+	Summarize(true, &sp);
+	if (!k.cnt)
+		return;
+	printf("Benchmark summary, %d solves (%d warm-up excluded):\r\n", k.cnt, (int)recs.size() - k.cnt);
+	printf("K:     mean %.3f, median %.3f, stdev %.3f, 95%% CI [%.3f, %.3f]\r\n", k.mean, k.median, k.stdev, k.ci_low, k.ci_high);
+	printf("Speed: mean %.1f, median %.1f, stdev %.1f, 95%% CI [%.1f, %.1f] MKeys/s\r\n", sp.mean, sp.median, sp.stdev, sp.ci_low, sp.ci_high);
+}
+
+bool TBenchReport::IsFormatSupported(char* fn)
+{
+	return HasExt(fn, ".json") || HasExt(fn, ".csv");
+}
+
+bool TBenchReport::SaveJson(FILE* fp)
+{
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"range\": %d,\n  \"dp\": %d,\n  \"gpus\": %d,\n  \"warmup\": %d,\n", Range, DP, GpuCnt, Warmup);
+	if (SeedSet)
+		fprintf(fp, "  \"seed\": %llu,\n", Seed);
+	else
+		fprintf(fp, "  \"seed\": null,\n");
+	fprintf(fp, "  \"solves\": [\n");
+	for (size_t i = 0; i < recs.size(); i++)
+	{
+		TBenchRec* r = &recs[i];
+		fprintf(fp, "    {\"index\": %u, \"warmup\": %s, \"seed\": %llu, \"ops\": %llu, \"dps\": %llu, \"time_ms\": %llu, \"K\": %.4f, \"speed\": %.2f}%s\n",
+			r->index, r->warmup ? "true" : "false", r->seed, r->ops, r->dps, r->time_ms, r->K, r->speed, (i + 1 < recs.size()) ? "," : "");
+	}
+	fprintf(fp, "  ],\n");
+	for (int i = 0; i < 2; i++)
+	{
+		TBenchSummary s;
+		Summarize(i == 1, &s);
+		fprintf(fp, "  \"%s\": {\"count\": %d, \"mean\": %.4f, \"median\": %.4f, \"stdev\": %.4f, \"ci95_low\": %.4f, \"ci95_high\": %.4f}%s\n",
+			i ? "speed" : "K", s.cnt, s.mean, s.median, s.stdev, s.ci_low, s.ci_high, i ? "" : ",");
+	}
+	fprintf(fp, "}\n");
+	return !ferror(fp);
+}
+
+//per-solve rows, summary rows have "summary_" prefix in first column
+bool TBenchReport::SaveCsv(FILE* fp)
+{
+	fprintf(fp, "index,warmup,seed,ops,dps,time_ms,K,speed,range,dp,gpus\n");
+	for (size_t i = 0; i < recs.size(); i++)
+	{
+		TBenchRec* r = &recs[i];
+		fprintf(fp, "%u,%d,%llu,%llu,%llu,%llu,%.4f,%.2f,%d,%d,%d\n",
+			r->index, r->warmup ? 1 : 0, r->seed, r->ops, r->dps, r->time_ms, r->K, r->speed, Range, DP, GpuCnt);
+	}
+	fprintf(fp, "\nsummary,count,mean,median,stdev,ci95_low,ci95_high\n");
+	for (int i = 0; i < 2; i++)
+	{
+		TBenchSummary s;
+		Summarize(i == 1, &s);
+		fprintf(fp, "summary_%s,%d,%.4f,%.4f,%.4f,%.4f,%.4f\n", i ? "speed" : "K", s.cnt, s.mean, s.median, s.stdev, s.ci_low, s.ci_high);
+	}
+	return !ferror(fp);
+}
+
+//report is rewritten after every solve so interrupted benchmark keeps its results
+bool TBenchReport::Save(char* fn)
+{
+	char tmp_fn[1100];
+	sprintf(tmp_fn, "%s.tmp", fn);
+	FILE* fp = fopen(tmp_fn, "wt");
+	if (!fp)
+		return false;
+	bool res = HasExt(fn, ".json") ? SaveJson(fp) : SaveCsv(fp);
+	fclose(fp);
+	if (!res)
+	{
+		remove(tmp_fn);
+		return false;
+	}
+	return RenameFile(tmp_fn, fn);
+}
@@ -0,0 +1,59 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+
+//benchmark results, one record per solved point
+//warm-up solves are recorded but excluded from summary
+//summary uses Student's t-distribution for 95% confidence intervals because number of solves is usually small
+
+struct TBenchRec
+{
+	u32 index;
+	bool warmup;
+	u64 seed; //0 if seed is not set
+	u64 ops;
+	u64 dps;
+	u64 time_ms;
+	double K;
+	double speed; //MKeys/s
+};
+
+struct TBenchSummary
+{
+	int cnt;
+	double mean;
+	double median;
+	double stdev;
+	double ci_low;
+	double ci_high;
+};
+
+class TBenchReport
+{
+private:
+	std::vector <TBenchRec> recs;
+	void Summarize(bool speed, TBenchSummary* res);
+	bool SaveJson(FILE* fp);
+	bool SaveCsv(FILE* fp);
+public:
+	int Range;
+	int DP;
+	int GpuCnt;
+	int Warmup;
+	bool SeedSet;
+	u64 Seed;
+
+	TBenchReport();
+	void Add(TBenchRec* rec);
+	int GetMeasuredCnt();
+	void PrintSummary();
+	//format is selected by file extension, .json or .csv
+	bool Save(char* fn);
+	static bool IsFormatSupported(char* fn);
+};
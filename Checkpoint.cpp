@@ -0,0 +1,246 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <math.h>
+#include "Checkpoint.h"
+
+TCheckpoint::TCheckpoint()
+{
+	fn[0] = 0;
+	interval_ms = (u64)CHK_DEF_INTERVAL * 60 * 1000;
+	workers = NULL;
+	worker_cnt = 0;
+	memset(&hdr, 0, sizeof(hdr));
+	last_tm = 0;
+	thr_active = false;
+	running = false;
+	abort = false;
+	last_res = false;
+}
+
+void TCheckpoint::SetFile(char* _fn)
+{
+	strcpy(fn, _fn);
+}
+
+void TCheckpoint::SetInterval(int minutes)
+{
+	interval_ms = (u64)minutes * 60 * 1000;
+}
+
+//FNV-1a of distances and points
+u64 TCheckpoint::CalcJumpsHash(EcJMP* EcJumps1, EcJMP* EcJumps2, EcJMP* EcJumps3)
+{
+	EcJMP* tbls[3] = { EcJumps1, EcJumps2, EcJumps3 };
+	u64 h = 0xCBF29CE484222325ull;
+	for (int t = 0; t < 3; t++)
+		for (int i = 0; i < JMP_CNT; i++)
+		{
+			u8 buf[64 + 24];
+			tbls[t][i].p.SaveToBuffer64(buf);
+			memcpy(buf + 64, tbls[t][i].dist.data, 24);
+			for (int j = 0; j < (int)sizeof(buf); j++)
+				h = (h ^ buf[j]) * 0x100000001B3ull;
+		}
+	return h;
+}
+
+void TCheckpoint::Start(RCKangWorker** _workers, int _worker_cnt, TChkHeader* _hdr)
+{
+	workers = _workers;
+	worker_cnt = _worker_cnt;
+	hdr = *_hdr;
+	memcpy(hdr.magic, CHK_MAGIC, 4);
+	hdr.version = CHK_VERSION;
+	hdr.worker_cnt = worker_cnt;
+	last_tm = GetTickCount64();
+	abort = false;
+	last_res = false;
+}
+
+bool TCheckpoint::Load(u64* total_ops, u64* solve_ms)
+{
+	FILE* fp = fopen(fn, "rb");
+	if (!fp)
+	{
+		printf("checkpoint: cannot open %s\r\n", fn);
+		return false;
+	}
+	TChkHeader fh;
+	if ((fread(&fh, 1, sizeof(fh), fp) != sizeof(fh)) || memcmp(fh.magic, CHK_MAGIC, 4) || (fh.version != CHK_VERSION))
+	{
+		printf("checkpoint: %s is not a checkpoint file\r\n", fn);
+		fclose(fp);
+		return false;
+	}
+	if ((fh.range != hdr.range) || (fh.dp != hdr.dp) || (fh.target_cnt != hdr.target_cnt) || memcmp(fh.pnt, hdr.pnt, 64) || (fh.jumps_hash != hdr.jumps_hash))
+	{
+		printf("checkpoint: %s is for another task (range %d, dp %d) or jumps are different\r\n", fn, fh.range, fh.dp);
+		fclose(fp);
+		return false;
+	}
+	//kangaroos are restored only if worker has the same kangaroos, others start from random points
+	TKangState* buf = (TKangState*)malloc(CHK_CHUNK * sizeof(TKangState));
+	u64 restored = 0;
+	u64 skipped = 0;
+	bool res = true;
+	for (u32 w = 0; res && (w < fh.worker_cnt); w++)
+	{
+		TChkWorker cw;
+		if (fread(&cw, 1, sizeof(cw), fp) != sizeof(cw))
+		{
+			res = false;
+			break;
+		}
+		RCKangWorker* worker = ((int)w < worker_cnt) ? workers[w] : NULL;
+		bool same = worker && !worker->Failed && worker->HasKangStates() && (cw.state_cnt == (u32)worker->KangCnt) &&
+			(cw.kang_cnt == (u32)worker->KangCnt) && (cw.tame_cnt == worker->TameCnt) && (cw.wild1_cnt == worker->Wild1Cnt);
+		if (!same)
+		{
+			skipped += cw.state_cnt;
+			if (cw.state_cnt && fseek64(fp, (u64)cw.state_cnt * sizeof(TKangState), SEEK_CUR))
+				res = false;
+			continue;
+		}
+		for (u32 first = 0; first < cw.state_cnt; first += CHK_CHUNK)
+		{
+			u32 cnt = (cw.state_cnt - first < CHK_CHUNK) ? cw.state_cnt - first : CHK_CHUNK;
+			if (fread(buf, sizeof(TKangState), cnt, fp) != cnt)
+			{
+				res = false;
+				break;
+			}
+			for (u32 i = 0; i < cnt; i++)
+				worker->AddKangFix(first + i, &buf[i]);
+			restored += cnt;
+		}
+	}
+	free(buf);
+	fclose(fp);
+	if (!res)
+	{
+		printf("checkpoint: %s is corrupted\r\n", fn);
+		return false;
+	}
+	*total_ops = fh.total_ops;
+	*solve_ms = fh.solve_ms;
+	printf("checkpoint: %llu kangaroos restored", restored);
+	if (skipped)
+		printf(", %llu kangaroos skipped because workers are different", skipped);
+	printf(", ops: 2^%.3f\r\n", log2((double)fh.total_ops + 1));
+	return true;
+}
+
+THR_PROC(chk_thr_proc)
+{
+	((TCheckpoint*)data)->Run();
+	return 0;
+}
+
+bool TCheckpoint::Begin(u64 total_ops, u64 solve_ms)
+{
+	if (!fn[0] || running)
+		return false;
+	if (thr_active)
+	{
+		WaitThread(thr);
+		thr_active = false;
+	}
+	last_tm = GetTickCount64();
+	hdr.total_ops = total_ops;
+	hdr.solve_ms = solve_ms;
+	running = true;
+	thr_active = StartThread(&thr, chk_thr_proc, this);
+	if (!thr_active)
+	{
+		running = false;
+		last_res = false;
+		printf("checkpoint: cannot start thread\r\n");
+		return false;
+	}
+	return true;
+}
+
+void TCheckpoint::Check(u64 total_ops, u64 solve_ms)
+{
+	if (!fn[0] || running || (GetTickCount64() - last_tm < interval_ms))
+		return;
+	Begin(total_ops, solve_ms);
+}
+
+void TCheckpoint::Stop()
+{
+	abort = true;
+	if (thr_active)
+		WaitThread(thr);
+	thr_active = false;
+	running = false;
+}
+
+void TCheckpoint::Remove()
+{
+	if (fn[0])
+		remove(fn);
+}
+
+bool TCheckpoint::Write()
+{
+	char tmp_fn[1100];
+	sprintf(tmp_fn, "%s.tmp", fn);
+	FILE* fp = fopen(tmp_fn, "wb");
+	if (!fp)
+	{
+		printf("\r\ncheckpoint: cannot create %s\r\n", tmp_fn);
+		return false;
+	}
+	TKangState* buf = (TKangState*)malloc(CHK_CHUNK * sizeof(TKangState));
+	bool res = fwrite(&hdr, 1, sizeof(hdr), fp) == sizeof(hdr);
+	for (int w = 0; res && (w < worker_cnt) && !abort; w++)
+	{
+		RCKangWorker* worker = workers[w];
+		TChkWorker cw;
+		cw.kang_cnt = worker->KangCnt;
+		cw.tame_cnt = worker->TameCnt;
+		cw.wild1_cnt = worker->Wild1Cnt;
+		cw.state_cnt = (!worker->Failed && worker->HasKangStates()) ? worker->KangCnt : 0;
+		res = fwrite(&cw, 1, sizeof(cw), fp) == sizeof(cw);
+		for (u32 first = 0; res && (first < cw.state_cnt); first += CHK_CHUNK)
+		{
+			u32 cnt = (cw.state_cnt - first < CHK_CHUNK) ? cw.state_cnt - first : CHK_CHUNK;
+			if (!worker->GetKangStates(first, cnt, buf, &abort))
+			{
+				if (!abort)
+					printf("\r\ncheckpoint: cannot get kangaroos of worker %d\r\n", worker->CudaIndex);
+				res = false;
+				break;
+			}
+			res = fwrite(buf, sizeof(TKangState), cnt, fp) == cnt;
+		}
+	}
+	free(buf);
+	res = res && !abort && FlushFileToDisk(fp);
+	fclose(fp);
+	if (!res)
+	{
+		remove(tmp_fn);
+		return false;
+	}
+	if (!RenameFile(tmp_fn, fn))
+	{
+		printf("\r\ncheckpoint: cannot rename %s\r\n", tmp_fn);
+		return false;
+	}
+	return true;
+}
+
+void TCheckpoint::Run()
+{
+	u64 tm = GetTickCount64();
+	last_res = Write();
+	if (last_res)
+		printf("\r\nCheckpoint saved in %llu ms, ops: 2^%.3f\r\n", GetTickCount64() - tm, log2((double)hdr.total_ops + 1));
+	running = false;
+}
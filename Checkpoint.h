@@ -0,0 +1,84 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+#include "Ec.h"
+#include "KangWorker.h"
+
+//checkpoint file: TChkHeader, then for every worker: TChkWorker, state_cnt * TKangState
+//DPs are not in checkpoint, they are in DP journal that is written all the time, so checkpoint has kangaroos and counters only.
+//Kangaroos are taken from workers part by part between kernel calls like for audit, workers are not stopped.
+//File is written to "<name>.tmp" and renamed when it's complete, so previous checkpoint is valid until then
+
+#define CHK_MAGIC			"RCKC"
+#define CHK_VERSION			1
+#define CHK_CHUNK			(64 * 1024) //kangaroos per request to worker
+#define CHK_DEF_INTERVAL	10 //minutes
+
+#pragma pack(push, 1)
+struct TChkHeader
+{
+	char magic[4];
+	u8 version;
+	u8 range;
+	u8 dp;
+	u8 target_cnt; //multi-target mode only, 0 - single point
+	u8 pnt[64]; //xor of points to solve, like in DP journal
+	u64 jumps_hash; //all jump tables, kangaroos cannot continue with other jumps
+	u64 total_ops;
+	u64 solve_ms; //time of solving before checkpoint
+	u32 worker_cnt;
+	u8 reserved[36];
+};
+
+struct TChkWorker
+{
+	u32 kang_cnt;
+	u32 tame_cnt;
+	u32 wild1_cnt;
+	u32 state_cnt; //0 if worker has no kangaroo states
+};
+#pragma pack(pop)
+
+class TCheckpoint
+{
+private:
+	char fn[1024];
+	u64 interval_ms;
+	RCKangWorker** workers;
+	int worker_cnt;
+	TChkHeader hdr;
+	u64 last_tm;
+	HHANDLER thr;
+	bool thr_active;
+	volatile bool running;
+	volatile bool abort;
+	bool last_res;
+	bool Write();
+public:
+	TCheckpoint();
+	void SetFile(char* _fn);
+	void SetInterval(int minutes);
+	bool IsEnabled() { return fn[0] != 0; }
+	char* GetFileName() { return fn; }
+	//for every point before workers are started, header has task fields
+	void Start(RCKangWorker** _workers, int _worker_cnt, TChkHeader* _hdr);
+	//restored kangaroos are sent to workers as fixes, so it must be called after Prepare and before Execute
+	bool Load(u64* total_ops, u64* solve_ms);
+	//executes in main thread, starts writing if it's time
+	void Check(u64 total_ops, u64 solve_ms);
+	//starts writing now if it's not running, result is known when IsRunning is false
+	bool Begin(u64 total_ops, u64 solve_ms);
+	bool IsRunning() { return running; }
+	bool GetResult() { return last_res; }
+	//must be called before workers are stopped
+	void Stop();
+	void Remove();
+	void Run(); //writing thread
+	static u64 CalcJumpsHash(EcJMP* EcJumps1, EcJMP* EcJumps2, EcJMP* EcJumps3);
+};
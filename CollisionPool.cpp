@@ -0,0 +1,141 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include "CollisionPool.h"
+
+THR_PROC(coll_thr_proc)
+{
+	((TCollisionPool*)data)->Execute();
+	return 0;
+}
+
+TCollisionPool::TCollisionPool()
+{
+	thr_cnt = 0;
+	stop = false;
+	solved_mask = 0;
+	verify = NULL;
+	verify_ctx = NULL;
+	checked = 0;
+	errors = 0;
+}
+
+TCollisionPool::~TCollisionPool()
+{
+	Stop();
+}
+
+bool TCollisionPool::Start(TCollVerifyProc proc, void* ctx)
+{
+	verify = proc;
+	verify_ctx = ctx;
+	queue.clear();
+	results.clear();
+	stop = false;
+	solved_mask = 0;
+	checked = 0;
+	errors = 0;
+	for (thr_cnt = 0; thr_cnt < COLL_THR_CNT; thr_cnt++)
+		if (!StartThread(&thrs[thr_cnt], coll_thr_proc, this))
+		{
+			Stop();
+			return false;
+		}
+	return true;
+}
+
+//remaining candidates are dropped
+void TCollisionPool::Stop()
+{
+	stop = true;
+	for (int i = 0; i < thr_cnt; i++)
+		WaitThread(thrs[i]);
+	thr_cnt = 0;
+	queue.clear();
+}
+
+//executes in main thread
+void TCollisionPool::Add(TCollCand* cand)
+{
+	if (IsSolved(cand->target))
+		return;
+	cs.Enter();
+	queue.push_back(*cand);
+	cs.Leave();
+}
+
+//executes in main thread
+bool TCollisionPool::PopResult(TCollResult* res)
+{
+	cs.Enter();
+	bool ok = !results.empty();
+	if (ok)
+	{
+		*res = results.front();
+		results.pop_front();
+	}
+	cs.Leave();
+	return ok;
+}
+
+//executes in separate threads
+void TCollisionPool::AddResult(int target, EcInt& key)
+{
+	cs.Enter();
+	if (!IsSolved(target))
+	{
+		TCollResult r;
+		r.target = target;
+		r.key = key;
+		results.push_back(r);
+		solved_mask |= 1ull << target;
+	}
+	cs.Leave();
+}
+
+void TCollisionPool::Execute()
+{
+	while (!stop)
+	{
+		cs.Enter();
+		if (queue.empty())
+		{
+			cs.Leave();
+			Sleep(1);
+			continue;
+		}
+		TCollCand cand = queue.front();
+		queue.pop_front();
+		cs.Leave();
+		if (IsSolved(cand.target))
+			continue;
+
+		EcInt pk;
+		u64 tm = GetTimeUs();
+		bool res = verify(verify_ctx, &cand, &pk);
+		check_hist.Add(GetTimeUs() - tm);
+		checked++;
+		if (res)
+		{
+			cs.Enter();
+			if (!IsSolved(cand.target))
+			{
+				TCollResult r;
+				r.target = cand.target;
+				r.key = pk;
+				results.push_back(r);
+				solved_mask |= 1ull << cand.target;
+			}
+			cs.Leave();
+			continue;
+		}
+		if (!cand.w12) //in rare cases WILD and WILD2 can collide in mirror, in this case there is no way to find K
+		{
+			printf("Collision Error\r\n");
+			errors++;
+		}
+	}
+}
@@ -0,0 +1,69 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include "utils.h"
+#include "Ec.h"
+#include "Metrics.h"
+
+//collision candidates are verified by a few threads so DPs processing is not blocked by point multiplications
+//first verified key of a target retires it, remaining candidates for this target are dropped
+
+#define COLL_THR_CNT		4
+
+struct TCollCand
+{
+	EcInt t;
+	EcInt w;
+	int TameType;
+	int WildType;
+	bool w12; //WILD1 and WILD2, they can collide in mirror and then key cannot be found
+	int target;
+};
+
+struct TCollResult
+{
+	int target;
+	EcInt key;
+};
+
+//returns true and key if candidate is verified, ctx is from Start
+typedef bool (*TCollVerifyProc)(void* ctx, TCollCand* cand, EcInt* pk);
+
+class TCollisionPool
+{
+private:
+	CriticalSection cs;
+	std::deque <TCollCand> queue;
+	HHANDLER thrs[COLL_THR_CNT];
+	int thr_cnt;
+	volatile bool stop;
+	std::atomic<u64> solved_mask;
+	std::deque <TCollResult> results;
+	TCollVerifyProc verify;
+	void* verify_ctx;
+	std::atomic<u64> checked;
+	std::atomic<u32> errors;
+	THistogram check_hist; //time of one candidate check, not cleared by Start
+public:
+	TCollisionPool();
+	~TCollisionPool();
+	bool Start(TCollVerifyProc proc, void* ctx);
+	void Stop();
+	void Add(TCollCand* cand);
+	bool IsSolved(int target) { return (solved_mask >> target) & 1; }
+	//returns false if there are no new solved targets
+	bool PopResult(TCollResult* res);
+	//key found in other way, target is retired like by verified candidate
+	void AddResult(int target, EcInt& key);
+	u64 GetCheckedCnt() { return checked; }
+	u32 GetErrorCnt() { return errors; }
+	THistogram* GetCheckHist() { return &check_hist; }
+	void Execute();
+};
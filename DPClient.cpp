@@ -0,0 +1,209 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include "DPClient.h"
+
+THR_PROC(client_thr_proc)
+{
+	((TDPClient*)data)->Execute();
+	return 0;
+}
+
+TDPClient::TDPClient()
+{
+	sock = NET_INVALID_SOCKET;
+	thr_started = false;
+	stop = false;
+	cur_ops = 0;
+	sent_ops = 0;
+	solved_mask = 0;
+	connected = false;
+	rejected = false;
+	dropped = 0;
+}
+
+TDPClient::~TDPClient()
+{
+	Stop();
+}
+
+bool TDPClient::Start(char* _addr, EcPoint* pnts, int cnt, int range, int dp)
+{
+	strcpy(addr, _addr);
+	NetMakeHello(&hello, pnts, cnt, range, dp);
+	all_mask = (cnt >= 64) ? 0xFFFFFFFFFFFFFFFFull : ((1ull << cnt) - 1);
+	pending.clear();
+	cur_ops = 0;
+	sent_ops = 0;
+	solved_mask = 0;
+	connected = false;
+	rejected = false;
+	dropped = 0;
+	stop = false;
+	thr_started = StartThread(&thr, client_thr_proc, this);
+	return thr_started;
+}
+
+void TDPClient::Stop()
+{
+	if (!thr_started)
+		return;
+	stop = true;
+	WaitThread(thr);
+	thr_started = false;
+	if (connected)
+		SendPending(true);
+	NetClose(sock);
+	sock = NET_INVALID_SOCKET;
+	connected = false;
+	if (dropped)
+		printf("DP client: %llu DPs were dropped because server was not available\r\n", dropped);
+	if (!pending.empty())
+		printf("DP client: %lluK DPs were not sent\r\n", (u64)pending.size() / 1000);
+}
+
+void TDPClient::Add(DBRec* rec)
+{
+	cs.Enter();
+	if (pending.size() < NET_MAX_PENDING)
+		pending.push_back(*rec);
+	else
+		dropped++;
+	cs.Leave();
+}
+
+void TDPClient::SetOps(u64 ops)
+{
+	cs.Enter();
+	cur_ops = ops;
+	cs.Leave();
+}
+
+u64 TDPClient::GetPendingCnt()
+{
+	cs.Enter();
+	u64 res = pending.size();
+	cs.Leave();
+	return res;
+}
+
+bool TDPClient::Connect()
+{
+	sock = NetConnect(addr);
+	if (sock == NET_INVALID_SOCKET)
+		return false;
+	TNetMsgHdr hdr;
+	if (!NetSend(sock, &hello, sizeof(hello)) || !NetRecv(sock, &hdr, sizeof(hdr)))
+	{
+		NetClose(sock);
+		sock = NET_INVALID_SOCKET;
+		return false;
+	}
+	if (hdr.type != NET_MSG_HELLO_OK)
+	{
+		printf("\r\nDP client: server %s works on another task, check range, dp, public keys and their order\r\n", addr);
+		rejected = true;
+		NetClose(sock);
+		sock = NET_INVALID_SOCKET;
+		return false;
+	}
+	solved_mask = hdr.val;
+	connected = true;
+	printf("\r\nDP client: connected to %s\r\n", addr);
+	return true;
+}
+
+//DPs are removed from pending only when they are sent
+bool TDPClient::SendPending(bool all)
+{
+	std::vector <DBRec> batch;
+	std::vector <u8> packed;
+	do
+	{
+		cs.Enter();
+		size_t cnt = pending.size();
+		if (cnt > NET_MAX_BATCH)
+			cnt = NET_MAX_BATCH;
+		batch.assign(pending.begin(), pending.begin() + cnt);
+		u64 ops = cur_ops - sent_ops;
+		cs.Leave();
+		if (!cnt && !ops)
+			return true;
+
+		packed.resize(1 + cnt * (13 + 22));
+		TNetMsgHdr hdr;
+		hdr.type = NET_MSG_DPS;
+		hdr.cnt = (u32)cnt;
+		hdr.val = ops;
+		hdr.size = PackDPs(batch.data(), (int)cnt, packed.data());
+		if (!NetSend(sock, &hdr, sizeof(hdr)) || !NetSend(sock, packed.data(), hdr.size))
+			return false;
+
+		cs.Enter();
+		pending.erase(pending.begin(), pending.begin() + cnt);
+		sent_ops += ops;
+		bool more = !pending.empty();
+		cs.Leave();
+		if (!more)
+			return true;
+	}
+	while (all || !stop);
+	return true;
+}
+
+//executes in separate thread
+void TDPClient::Execute()
+{
+	u64 tm_retry = 0;
+	bool warned = false;
+	while (!stop)
+	{
+		if (!connected)
+		{
+			if (rejected || (solved_mask == all_mask) || (GetTickCount64() < tm_retry))
+			{
+				Sleep(100);
+				continue;
+			}
+			if (!Connect())
+			{
+				if (!warned && !rejected)
+					printf("\r\nDP client: cannot connect to %s, retrying...\r\n", addr);
+				warned = true;
+				tm_retry = GetTickCount64() + 3000;
+				continue;
+			}
+			warned = false;
+		}
+
+		//server sends solved points
+		bool ok = true;
+		int res;
+		while ((res = NetWait(sock, 0)) != 0)
+		{
+			TNetMsgHdr hdr;
+			if ((res < 0) || !NetRecv(sock, &hdr, sizeof(hdr)) || (hdr.type != NET_MSG_SOLVED))
+			{
+				ok = false;
+				break;
+			}
+			solved_mask = hdr.val;
+		}
+		if (ok)
+			ok = SendPending(false);
+		if (!ok)
+		{
+			//server closes connection when everything is solved
+			if (solved_mask != all_mask)
+				printf("\r\nDP client: connection to %s lost\r\n", addr);
+			NetClose(sock);
+			sock = NET_INVALID_SOCKET;
+			connected = false;
+			continue;
+		}
+		Sleep(NET_SEND_MS);
+	}
+}
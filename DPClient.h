@@ -0,0 +1,54 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include <atomic>
+#include "Net.h"
+
+//DP client sends DPs to DP server instead of local DB, background thread sends batches and reconnects if connection is lost
+//DPs are kept in RAM until they are sent, so short network problems don't lose any work
+
+#define NET_SEND_MS			200
+#define NET_MAX_PENDING		(16 * 1024 * 1024)
+
+class TDPClient
+{
+private:
+	char addr[256];
+	TNetHello hello;
+	u64 sock;
+	HHANDLER thr;
+	bool thr_started;
+	volatile bool stop;
+	CriticalSection cs;
+	std::vector <DBRec> pending;
+	u64 cur_ops;
+	u64 sent_ops;
+	std::atomic<u64> solved_mask;
+	u64 all_mask;
+	std::atomic<bool> connected;
+	std::atomic<bool> rejected;
+	u64 dropped;
+
+	bool Connect();
+	bool SendPending(bool all);
+public:
+	TDPClient();
+	~TDPClient();
+	bool Start(char* _addr, EcPoint* pnts, int cnt, int range, int dp);
+	//sends remaining DPs if connected
+	void Stop();
+	bool IsActive() { return thr_started; }
+	//executes in main thread
+	void Add(DBRec* rec);
+	void SetOps(u64 ops);
+	u64 GetSolvedMask() { return solved_mask; }
+	bool IsConnected() { return connected; }
+	bool IsRejected() { return rejected; }
+	u64 GetPendingCnt();
+	void Execute();
+};
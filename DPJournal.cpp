@@ -0,0 +1,205 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <stdlib.h>
+#include "DPJournal.h"
+#include "TamesFile.h"
+
+#ifdef _WIN32
+	#include <io.h>
+#endif
+
+#define JOURNAL_IO_BUF_SIZE		(16 * 1024 * 1024)
+#define JOURNAL_REPLAY_CNT		(256 * 1024)
+
+THR_PROC(journal_thr_proc)
+{
+	((TDPJournal*)data)->Execute();
+	return 0;
+}
+
+static bool TruncateFile(FILE* fp, u64 size)
+{
+	fflush(fp);
+#ifdef _WIN32
+	return _chsize_s(_fileno(fp), size) == 0;
+#else
+	return ftruncate(fileno(fp), size) == 0;
+#endif
+}
+
+TDPJournal::TDPJournal()
+{
+	fp = NULL;
+	pending_ops = 0;
+	stop = false;
+	write_failed = false;
+	count_hits = false;
+}
+
+TDPJournal::~TDPJournal()
+{
+	Close();
+}
+
+//stops at first incomplete block, it's a tail of interrupted write
+bool TDPJournal::Replay(TFastBase* db, u64* total_ops, u64* rec_cnt)
+{
+	*rec_cnt = 0;
+	u64 good_pos = ftell64(fp);
+	DBRec* recs = (DBRec*)malloc(JOURNAL_REPLAY_CNT * sizeof(DBRec));
+	while (1)
+	{
+		u32 cnt;
+		u64 ops;
+		if ((fread(&cnt, 1, 4, fp) != 4) || (fread(&ops, 1, 8, fp) != 8))
+			break;
+		bool ok = true;
+		while (cnt)
+		{
+			u32 n = (cnt > JOURNAL_REPLAY_CNT) ? JOURNAL_REPLAY_CNT : cnt;
+			if (fread(recs, sizeof(DBRec), n, fp) != n)
+			{
+				ok = false;
+				break;
+			}
+			for (u32 i = 0; i < n; i++)
+			{
+				u8* pref = db->FindOrAddDataBlock((u8*)&recs[i]);
+				//in tames generation mode same tames are journaled again to restore hits counters
+				if (pref && count_hits && (pref[DB_REC_LEN - 1] < TAMES_MAX_HITS))
+					pref[DB_REC_LEN - 1]++;
+			}
+			*rec_cnt += n;
+			cnt -= n;
+		}
+		if (!ok)
+			break;
+		*total_ops = ops;
+		good_pos = ftell64(fp);
+	}
+	free(recs);
+	if (fseek64(fp, good_pos, SEEK_SET))
+		return false;
+	return TruncateFile(fp, good_pos);
+}
+
+bool TDPJournal::Open(char* fn, TJournalHeader* hdr, TFastBase* db, u64* total_ops, u64* rec_cnt)
+{
+	*total_ops = 0;
+	*rec_cnt = 0;
+	memcpy(hdr->magic, JOURNAL_MAGIC, 4);
+	hdr->version = JOURNAL_VERSION;
+	fp = fopen(fn, "r+b");
+	if (fp)
+	{
+		//buffer must be set before any I/O on the stream
+		setvbuf(fp, NULL, _IOFBF, JOURNAL_IO_BUF_SIZE);
+		TJournalHeader fhdr;
+		if ((fread(&fhdr, 1, sizeof(fhdr), fp) != sizeof(fhdr)) || memcmp(&fhdr, hdr, sizeof(fhdr)))
+		{
+			printf("journal %s belongs to another task, it cannot be used\r\n", fn);
+			fclose(fp);
+			fp = NULL;
+			return false;
+		}
+		count_hits = hdr->gen_mode != 0;
+		if (!Replay(db, total_ops, rec_cnt))
+		{
+			printf("journal %s replay failed\r\n", fn);
+			fclose(fp);
+			fp = NULL;
+			return false;
+		}
+	}
+	else
+	{
+		fp = fopen(fn, "wb");
+		if (!fp)
+			return false;
+		setvbuf(fp, NULL, _IOFBF, JOURNAL_IO_BUF_SIZE);
+		if ((fwrite(hdr, 1, sizeof(TJournalHeader), fp) != sizeof(TJournalHeader)) || !FlushFileToDisk(fp))
+		{
+			fclose(fp);
+			fp = NULL;
+			return false;
+		}
+	}
+	pending.clear();
+	pending_ops = *total_ops;
+	stop = false;
+	write_failed = false;
+	if (!StartThread(&thr, journal_thr_proc, this))
+	{
+		fclose(fp);
+		fp = NULL;
+		return false;
+	}
+	return true;
+}
+
+//executes in main thread, must be fast
+void TDPJournal::Append(DBRec* rec)
+{
+	cs.Enter();
+	pending.insert(pending.end(), (u8*)rec, (u8*)rec + sizeof(DBRec));
+	cs.Leave();
+}
+
+void TDPJournal::SetOps(u64 total_ops)
+{
+	cs.Enter();
+	pending_ops = total_ops;
+	cs.Leave();
+}
+
+bool TDPJournal::WriteBlock(std::vector <u8>& recs, u64 ops)
+{
+	u32 cnt = (u32)(recs.size() / sizeof(DBRec));
+	if (fwrite(&cnt, 1, 4, fp) != 4)
+		return false;
+	if (fwrite(&ops, 1, 8, fp) != 8)
+		return false;
+	if (fwrite(recs.data(), 1, recs.size(), fp) != recs.size())
+		return false;
+	return FlushFileToDisk(fp);
+}
+
+//executes in separate thread
+void TDPJournal::Execute()
+{
+	std::vector <u8> recs;
+	bool last = false;
+	while (!last)
+	{
+		u64 tm = GetTickCount64();
+		while (!stop && (GetTickCount64() - tm < JOURNAL_FLUSH_MS))
+			Sleep(10);
+		last = stop;
+		cs.Enter();
+		recs.swap(pending);
+		u64 ops = pending_ops;
+		cs.Leave();
+		if (recs.empty() || write_failed)
+			continue;
+		if (!WriteBlock(recs, ops))
+		{
+			printf("\r\nDP journal write failed, journaling stopped!\r\n");
+			write_failed = true;
+		}
+		recs.clear();
+	}
+}
+
+void TDPJournal::Close()
+{
+	if (!fp)
+		return;
+	stop = true;
+	WaitThread(thr);
+	fclose(fp);
+	fp = NULL;
+}
@@ -0,0 +1,55 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+
+//journal file: TJournalHeader, then blocks: cnt(4), total ops(8), cnt * DBRec
+//blocks are appended by background thread and flushed to disk at least every JOURNAL_FLUSH_MS
+
+#define JOURNAL_MAGIC		"RCDJ"
+#define JOURNAL_VERSION		1
+#define JOURNAL_FLUSH_MS	1000
+
+#pragma pack(push, 1)
+struct TJournalHeader
+{
+	char magic[4];
+	u8 version;
+	u8 range;
+	u8 dp;
+	u8 gen_mode;
+	u8 pnt[64]; //point to solve (xor of points in multi-target mode), zero in tames generation mode
+	u8 target_cnt; //multi-target mode only, 0 - single point
+	u8 reserved[55];
+};
+#pragma pack(pop)
+
+class TDPJournal
+{
+private:
+	FILE* fp;
+	CriticalSection cs;
+	std::vector <u8> pending;
+	u64 pending_ops;
+	volatile bool stop;
+	bool write_failed;
+	bool count_hits;
+	HHANDLER thr;
+	bool Replay(TFastBase* db, u64* total_ops, u64* rec_cnt);
+	bool WriteBlock(std::vector <u8>& recs, u64 ops);
+public:
+	TDPJournal();
+	~TDPJournal();
+	bool IsOpened() { return fp != NULL; }
+	//replays existing journal to db and opens it for appending
+	bool Open(char* fn, TJournalHeader* hdr, TFastBase* db, u64* total_ops, u64* rec_cnt);
+	void Append(DBRec* rec);
+	void SetOps(u64 total_ops);
+	void Close();
+	void Execute();
+};
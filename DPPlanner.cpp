@@ -0,0 +1,113 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <math.h>
+#include "DPPlanner.h"
+
+#define DB_RAM_REC_COST		(32 + 4 + 4) //+4 for grow allocation and memory fragmentation, same as in TKangarooSolver::Solve
+#define DB_RAM_FIXED		(sizeof(TListRec) * 256 * 256 * 256) //3byte-prefix table
+#define SPILL_REC_COST		sizeof(DBRec)
+
+//min DP so that val / 2^DP <= limit
+static int MinDP(double val, double limit)
+{
+	if (val <= limit)
+		return 0;
+	return (int)ceil(log2(val / limit));
+}
+
+static double GetStoreSize(TDPPlanIn* in, double dps)
+{
+	switch (in->Store)
+	{
+	case PLAN_STORE_RAM:
+		return (DB_RAM_REC_COST * dps + DB_RAM_FIXED) / (1024.0 * 1024 * 1024);
+	case PLAN_STORE_SPILL:
+		return SPILL_REC_COST * dps / (1024.0 * 1024 * 1024);
+	default:
+		return 0.0;
+	}
+}
+
+bool PlanDP(TDPPlanIn* in, TDPPlan* plan)
+{
+	memset(plan, 0, sizeof(TDPPlan));
+	plan->budget_ops = (in->MaxOps > 0.0) ? in->MaxOps : PLAN_OPS_FACTOR * in->ExpOps;
+
+	if (in->Store == PLAN_STORE_RAM)
+	{
+		if (in->RamBytes <= DB_RAM_FIXED)
+			plan->dp_ram = 61;
+		else
+			plan->dp_ram = MinDP(plan->budget_ops * DB_RAM_REC_COST, (double)(in->RamBytes - DB_RAM_FIXED));
+	}
+	plan->dp_gpu_buf = MinDP((double)in->MaxWorkerKangs * STEP_CNT * PLAN_BUF_MARGIN, MAX_DP_CNT);
+	plan->dp_host_buf = MinDP((double)in->TotalKangs * STEP_CNT * PLAN_BUF_MARGIN, MAX_CNT_LIST);
+	plan->dp_overhead = in->TotalKangs ? (int)floor(log2(in->ExpOps / (in->TotalKangs * PLAN_MIN_DPS_PER_KANG))) : 60;
+	if (plan->dp_overhead < 0)
+		plan->dp_overhead = 0;
+
+	int dp = 14;
+	if (plan->dp_ram > dp)
+		dp = plan->dp_ram;
+	if (plan->dp_gpu_buf > dp)
+		dp = plan->dp_gpu_buf;
+	if (plan->dp_host_buf > dp)
+		dp = plan->dp_host_buf;
+	if (dp > 60)
+		return false;
+	plan->dp = dp;
+	double dp_val = pow(2.0, dp);
+	plan->exp_dps = in->ExpOps / dp_val;
+	plan->max_dps = plan->budget_ops / dp_val;
+	plan->ram_gb = GetStoreSize(in, plan->max_dps);
+	plan->dps_per_kang = in->TotalKangs ? in->ExpOps / in->TotalKangs / dp_val : 0.0;
+	return true;
+}
+
+void PlanHerd(double ExpOps, double TameOps, THerd* herd)
+{
+	double tame = (1.0 - 3.0 * TameOps / ExpOps) / 3.0;
+	if (tame < 0.0)
+		tame = 0.0;
+	herd->tame = (u32)(tame * HERD_PARTS + 0.5);
+	herd->wild1 = (HERD_PARTS - herd->tame) / 2;
+	herd->wild2 = HERD_PARTS - herd->tame - herd->wild1;
+}
+
+double CalcWildRestartOps(int Range, int DP, u64 tames_cnt, THerd* herd)
+{
+	u32 wilds = herd->wild1 + herd->wild2;
+	if (!tames_cnt || !wilds)
+		return 0.0;
+	double dp_val = pow(2.0, DP);
+	double ops = pow(2.0, Range) / ((double)tames_cnt * dp_val) + dp_val;
+	return ops * ((double)herd->tame + wilds) / wilds;
+}
+
+void PrintDPPlan(TDPPlanIn* in, TDPPlan* plan)
+{
+	const char* store_names[] = { "RAM", "disk (spill)", "DP server" };
+	printf("DP plan: range %d, kangaroos %llu, expected ops 2^%.3f, ops budget 2^%.3f, DPs stored in %s\r\n",
+		in->Range, in->TotalKangs, log2(in->ExpOps), log2(plan->budget_ops), store_names[in->Store]);
+	if (in->Store == PLAN_STORE_RAM)
+		printf("  RAM budget %.3f GB: DP >= %d\r\n", in->RamBytes / (1024.0 * 1024 * 1024), plan->dp_ram);
+	printf("  GPU DP buffer: DP >= %d, host DP queue: DP >= %d, low DP overhead: DP <= %d\r\n", plan->dp_gpu_buf, plan->dp_host_buf, plan->dp_overhead);
+	if (!plan->dp)
+	{
+		printf("  no valid DP value, RAM budget is too small\r\n");
+		return;
+	}
+	printf("  selected DP %d: expected DPs %.0fK (max %.0fK), %s %.3f GB, DPs per kangaroo %.3f\r\n", plan->dp, plan->exp_dps / 1000, plan->max_dps / 1000,
+		(in->Store == PLAN_STORE_SPILL) ? "disk" : "RAM", plan->ram_gb, plan->dps_per_kang);
+	if (in->TotalKangs && (plan->dp > plan->dp_overhead))
+	{
+		if (plan->dp == plan->dp_ram)
+			printf("  WARNING: DP overhead is big, more RAM is needed\r\n");
+		else
+			printf("  WARNING: DP overhead is big, range is too small for this number of kangaroos\r\n");
+	}
+}
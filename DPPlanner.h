@@ -0,0 +1,66 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+
+//selects the lowest DP value that fits all limits, lower DP means less DP overhead but more DPs to store:
+//- DB must fit into RAM budget even for unlucky solve (PLAN_OPS_FACTOR * expected ops, or -max limit)
+//- DPs of one kernel call must fit into GPU DP buffer (MAX_DP_CNT) and into host DP queue (MAX_CNT_LIST) with 2x margin
+//DP overhead is big if DP is above dp_overhead, planner warns about it
+
+#define PLAN_OPS_FACTOR		3.0
+#define PLAN_BUF_MARGIN		2.0
+#define PLAN_MIN_DPS_PER_KANG	5.0
+#define PLAN_RAM_USAGE		0.8 //part of physical RAM if RAM budget is not specified
+
+//where DPs are stored
+enum EPlanStore
+{
+	PLAN_STORE_RAM, //TFastBase
+	PLAN_STORE_SPILL, //sorted runs on disk, RAM is limited by -spill
+	PLAN_STORE_REMOTE //DP server
+};
+
+struct TDPPlanIn
+{
+	int Range;
+	double ExpOps;
+	double MaxOps; //-max limit, 0 - not set
+	u64 TotalKangs;
+	u64 MaxWorkerKangs;
+	u64 RamBytes;
+	EPlanStore Store;
+};
+
+struct TDPPlan
+{
+	int dp; //result, 0 if there is no valid DP
+	int dp_ram; //min DP for RAM budget
+	int dp_gpu_buf; //min DP for GPU DP buffer
+	int dp_host_buf; //min DP for host DP queue
+	int dp_overhead; //max DP without big DP overhead
+	double budget_ops;
+	double exp_dps;
+	double max_dps;
+	double ram_gb; //or disk for spill
+	double dps_per_kang;
+};
+
+//herd for solving with preloaded tames: default herd walks ExpOps / 3 as tames, tames from file give TameOps (tames count * 2^DP),
+//so they replace tame walking: tames part is (1 - 3 * TameOps / ExpOps) / 3, wilds share the rest equally,
+//herd is wild-only if file has at least ExpOps / 3 of tames
+#define HERD_PARTS			10000 //weights of planned herd are in 1/HERD_PARTS
+
+//wild restart after DP (-wildrestart): every wild starts from new random point after its DP, so every step hits a path
+//of preloaded tames with probability tames_cnt * 2^DP / 2^Range, and 2^DP more steps are needed to reach DP of that path.
+//Only wilds walk this way, so ops of the herd are scaled by its part of wilds. Returns 0 if there are no tames
+double CalcWildRestartOps(int Range, int DP, u64 tames_cnt, THerd* herd);
+
+bool PlanDP(TDPPlanIn* in, TDPPlan* plan);
+void PlanHerd(double ExpOps, double TameOps, THerd* herd);
+void PrintDPPlan(TDPPlanIn* in, TDPPlan* plan);
@@ -0,0 +1,212 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <stdlib.h>
+#include "DPRing.h"
+
+#ifndef _WIN32
+	#include <poll.h>
+	#include <sys/eventfd.h>
+#endif
+
+TDPRing::TDPRing()
+{
+	slots = NULL;
+	size = 0;
+#ifdef _WIN32
+	evt = NULL;
+#else
+	evt = -1;
+#endif
+}
+
+TDPRing::~TDPRing()
+{
+	Release();
+}
+
+bool TDPRing::Init(u32 _size)
+{
+	Release();
+	size = _size;
+	slots = (TDPSlot*)malloc(size * sizeof(TDPSlot));
+	if (!slots)
+		return false;
+#ifdef _WIN32
+	evt = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (!evt)
+		return false;
+#else
+	evt = eventfd(0, EFD_NONBLOCK);
+	if (evt < 0)
+		return false;
+#endif
+	Reset();
+	return true;
+}
+
+void TDPRing::Release()
+{
+	free(slots);
+	slots = NULL;
+#ifdef _WIN32
+	if (evt)
+		CloseHandle(evt);
+	evt = NULL;
+#else
+	if (evt >= 0)
+		close(evt);
+	evt = -1;
+#endif
+}
+
+void TDPRing::Reset()
+{
+	for (u64 i = 0; i < size; i++)
+		slots[i].seq.store(0, std::memory_order_relaxed);
+	head.store(0);
+	tail.store(0);
+	aborted = false;
+	sleeping = false;
+	stall_cnt = 0;
+	stall_ms = 0;
+	max_occupancy = 0;
+	popped = 0;
+	lat_sum = 0;
+	lat_max = 0;
+}
+
+void TDPRing::Abort()
+{
+	aborted = true;
+}
+
+void TDPRing::Signal()
+{
+#ifdef _WIN32
+	SetEvent(evt);
+#else
+	u64 val = 1;
+	if (write(evt, &val, 8) != 8)
+		return; //counter is already non-zero, consumer will wake up anyway
+#endif
+}
+
+void TDPRing::Push(u8* data, int cnt)
+{
+	//large batches are split so that every part fits into the queue
+	u64 max_part = size / 4;
+	while (cnt)
+	{
+		u64 part = ((u64)cnt > max_part) ? max_part : cnt;
+		u64 pos = head.load(std::memory_order_relaxed);
+		bool stalled = false;
+		u64 tm_stall = 0;
+		while (1)
+		{
+			if (pos + part - tail.load(std::memory_order_acquire) <= size)
+			{
+				if (head.compare_exchange_weak(pos, pos + part, std::memory_order_relaxed))
+					break;
+				continue; //pos is updated by CAS
+			}
+			//queue is full, wait for consumer
+			if (aborted)
+				return;
+			if (!stalled)
+			{
+				stalled = true;
+				tm_stall = GetTickCount64();
+				stall_cnt++;
+			}
+			Sleep(1);
+			pos = head.load(std::memory_order_relaxed);
+		}
+		if (stalled)
+			stall_ms += GetTickCount64() - tm_stall;
+
+		u64 tm = GetTimeUs();
+		for (u64 i = 0; i < part; i++)
+		{
+			TDPSlot* slot = &slots[(pos + i) & (size - 1)];
+			memcpy(slot->data, data + i * GPU_DP_SIZE, GPU_DP_SIZE);
+			slot->push_tm = tm;
+			slot->seq.store(pos + i + 1, std::memory_order_release);
+		}
+		u32 occ = (u32)(pos + part - tail.load(std::memory_order_relaxed));
+		u32 max_occ = max_occupancy.load(std::memory_order_relaxed);
+		while ((occ > max_occ) && !max_occupancy.compare_exchange_weak(max_occ, occ, std::memory_order_relaxed));
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (sleeping.exchange(false))
+			Signal();
+		data += part * GPU_DP_SIZE;
+		cnt -= (int)part;
+	}
+}
+
+//stops at first slot that is reserved but not filled yet
+int TDPRing::Pop(u8* out, int max_cnt)
+{
+	u64 pos = tail.load(std::memory_order_relaxed);
+	u64 tm = GetTimeUs();
+	int cnt = 0;
+	while (cnt < max_cnt)
+	{
+		TDPSlot* slot = &slots[pos & (size - 1)];
+		if (slot->seq.load(std::memory_order_acquire) != pos + 1)
+			break;
+		memcpy(out + cnt * GPU_DP_SIZE, slot->data, GPU_DP_SIZE);
+		u64 lat = (tm > slot->push_tm) ? tm - slot->push_tm : 0;
+		lat_sum += lat;
+		lat_hist.Add(lat);
+		if (lat > lat_max)
+			lat_max = lat;
+		pos++;
+		cnt++;
+	}
+	popped += cnt;
+	tail.store(pos, std::memory_order_release);
+	return cnt;
+}
+
+bool TDPRing::Wait(int timeout_ms)
+{
+	sleeping = true;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	//check again after setting the flag, producer could publish DPs before it
+	u64 pos = tail.load(std::memory_order_relaxed);
+	if (slots[pos & (size - 1)].seq.load(std::memory_order_acquire) == pos + 1)
+	{
+		sleeping = false;
+		return true;
+	}
+#ifdef _WIN32
+	bool res = WaitForSingleObject(evt, timeout_ms) == WAIT_OBJECT_0;
+#else
+	pollfd pfd;
+	pfd.fd = evt;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	bool res = poll(&pfd, 1, timeout_ms) > 0;
+	u64 val;
+	if (res && (read(evt, &val, 8) != 8))
+		res = false;
+#endif
+	sleeping = false;
+	return res;
+}
+
+void TDPRing::GetStats(TDPRingStats* stats)
+{
+	stats->pushed = head.load();
+	stats->size = (u32)size;
+	stats->occupancy = (u32)(head.load() - tail.load());
+	stats->max_occupancy = max_occupancy;
+	stats->lat_avg_us = popped ? lat_sum / popped : 0;
+	stats->lat_max_us = lat_max;
+	stats->stall_cnt = stall_cnt;
+	stats->stall_ms = stall_ms;
+}
@@ -0,0 +1,78 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include <atomic>
+#include "utils.h"
+#include "Metrics.h"
+
+//bounded lock-free multi-producer single-consumer queue of DPs
+//producers reserve a range of slots by CAS on head, fill them and publish every slot by its seq
+//consumer reads slots in order, slot is ready when its seq is pos + 1
+//when queue is full producers wait (backpressure), so DPs are never lost
+
+//64 bytes, one cache line
+struct TDPSlot
+{
+	u8 data[GPU_DP_SIZE];
+	u64 push_tm; //us
+	std::atomic<u64> seq;
+};
+
+struct TDPRingStats
+{
+	u64 pushed;
+	u32 size;
+	u32 occupancy;
+	u32 max_occupancy;
+	u64 lat_avg_us;
+	u64 lat_max_us;
+	u64 stall_cnt;
+	u64 stall_ms;
+};
+
+class TDPRing
+{
+private:
+	TDPSlot* slots;
+	u64 size;
+	alignas(64) std::atomic<u64> head;
+	alignas(64) std::atomic<u64> tail;
+	std::atomic<bool> aborted;
+	std::atomic<bool> sleeping;
+	std::atomic<u64> stall_cnt;
+	std::atomic<u64> stall_ms;
+	std::atomic<u32> max_occupancy;
+	u64 popped;
+	u64 lat_sum;
+	u64 lat_max;
+	THistogram lat_hist; //not cleared by Reset, it's for the whole run
+#ifdef _WIN32
+	HANDLE evt;
+#else
+	int evt;
+#endif
+	void Signal();
+public:
+	TDPRing();
+	~TDPRing();
+	//size must be power of 2
+	bool Init(u32 _size);
+	void Release();
+	//must be called when there are no producers
+	void Reset();
+	//waiting producers drop their DPs and return, Reset clears this state
+	void Abort();
+	//executes in worker threads, waits if queue is full
+	void Push(u8* data, int cnt);
+	//executes in main thread only
+	int Pop(u8* out, int max_cnt);
+	//waits for new DPs, returns false on timeout
+	bool Wait(int timeout_ms);
+	void GetStats(TDPRingStats* stats);
+	THistogram* GetLatHist() { return &lat_hist; }
+};
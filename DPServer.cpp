@@ -0,0 +1,231 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include "DPServer.h"
+
+
+THR_PROC(session_thr_proc)
+{
+	TNetSession* sess = (TNetSession*)data;
+	sess->server->ExecuteSession(sess);
+	sess->done = true;
+	return 0;
+}
+
+RCDPServer::RCDPServer(char* _addr)
+{
+	strcpy(addr, _addr);
+	listen_sock = NET_INVALID_SOCKET;
+	CudaIndex = 0;
+	KangCnt = 0;
+	Failed = false;
+	StopFlag = false;
+	solved_mask = 0;
+	ops_total = 0;
+	memset(dbg, 0, sizeof(dbg));
+}
+
+RCDPServer::~RCDPServer()
+{
+	Release();
+}
+
+void RCDPServer::Release()
+{
+	NetClose(listen_sock);
+	listen_sock = NET_INVALID_SOCKET;
+}
+
+//kangaroos are on clients and we don't know how many
+int RCDPServer::CalcKangCnt()
+{
+	return 0;
+}
+
+//executes in main thread
+bool RCDPServer::Prepare(EcPoint* _PntsToSolve, int _PntCnt, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3)
+{
+	NetMakeHello(&hello, _PntsToSolve, _PntCnt, _Range, _DP);
+	StopFlag = false;
+	Failed = false;
+	solved_mask = 0;
+	memset(SpeedStats, 0, sizeof(SpeedStats));
+	cur_stats_ind = 0;
+	if (listen_sock == NET_INVALID_SOCKET)
+	{
+		listen_sock = NetListen(addr, false);
+		if (listen_sock == NET_INVALID_SOCKET)
+		{
+			printf("DP server: cannot listen on %s\r\n", addr);
+			return false;
+		}
+	}
+	printf("DP server: listening on %s\r\n", addr);
+	return true;
+}
+
+void RCDPServer::Stop()
+{
+	StopFlag = true;
+}
+
+int RCDPServer::GetClientCnt()
+{
+	cs.Enter();
+	int res = 0;
+	for (size_t i = 0; i < sessions.size(); i++)
+		if (!sessions[i]->done)
+			res++;
+	cs.Leave();
+	return res;
+}
+
+//executes in worker thread, all - wait for all sessions
+void RCDPServer::CloseSessions(bool all)
+{
+	cs.Enter();
+	for (size_t i = 0; i < sessions.size(); )
+	{
+		TNetSession* sess = sessions[i];
+		if (!all && !sess->done)
+		{
+			i++;
+			continue;
+		}
+		cs.Leave();
+		WaitThread(sess->thr);
+		cs.Enter();
+		NetClose(sess->sock);
+		delete sess;
+		sessions.erase(sessions.begin() + i);
+	}
+	cs.Leave();
+}
+
+//executes in separate thread
+void RCDPServer::Execute()
+{
+	if (Failed)
+		return;
+	u64 tm_stats = GetTickCount64();
+	u64 last_ops = ops_total;
+	while (!StopFlag)
+	{
+		u64 sock = NetAccept(listen_sock, 100);
+		if (sock != NET_INVALID_SOCKET)
+		{
+			TNetSession* sess = new TNetSession();
+			sess->server = this;
+			sess->sock = sock;
+			sess->done = false;
+			cs.Enter();
+			if (StartThread(&sess->thr, session_thr_proc, sess))
+				sessions.push_back(sess);
+			else
+			{
+				NetClose(sock);
+				delete sess;
+			}
+			cs.Leave();
+		}
+		CloseSessions(false);
+
+		u64 tm = GetTickCount64();
+		if (tm - tm_stats >= 1000)
+		{
+			u64 ops = ops_total;
+			SpeedStats[cur_stats_ind] = (int)((ops - last_ops) / ((tm - tm_stats) * 1000));
+			cur_stats_ind = (cur_stats_ind + 1) % STATS_WND_SIZE;
+			last_ops = ops;
+			tm_stats = tm;
+		}
+	}
+	CloseSessions(true);
+}
+
+//executes in session thread
+void RCDPServer::ExecuteSession(TNetSession* sess)
+{
+	TNetHello client_hello;
+	TNetMsgHdr hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	if (!NetRecv(sess->sock, &client_hello, sizeof(client_hello)))
+		return;
+	if (memcmp(&client_hello, &hello, sizeof(hello)))
+	{
+		printf("\r\nDP server: client with different task or version rejected\r\n");
+		hdr.type = NET_MSG_HELLO_BAD;
+		NetSend(sess->sock, &hdr, sizeof(hdr));
+		return;
+	}
+	u64 sent_mask = solved_mask;
+	hdr.type = NET_MSG_HELLO_OK;
+	hdr.val = sent_mask;
+	if (!NetSend(sess->sock, &hdr, sizeof(hdr)))
+		return;
+	printf("\r\nDP server: client connected\r\n");
+
+	int max_size = 1 + NET_MAX_BATCH * (13 + 22);
+	u8* packed = (u8*)malloc(max_size);
+	u8* dps = (u8*)malloc(NET_MAX_BATCH * GPU_DP_SIZE);
+	bool ok = true;
+	while (!StopFlag)
+	{
+		u64 mask = solved_mask;
+		if (mask != sent_mask)
+		{
+			hdr.type = NET_MSG_SOLVED;
+			hdr.cnt = 0;
+			hdr.val = mask;
+			hdr.size = 0;
+			if (!NetSend(sess->sock, &hdr, sizeof(hdr)))
+			{
+				ok = false;
+				break;
+			}
+			sent_mask = mask;
+		}
+		int res = NetWait(sess->sock, 100);
+		if (res < 0)
+		{
+			ok = false;
+			break;
+		}
+		if (!res)
+			continue;
+		if (!NetRecv(sess->sock, &hdr, sizeof(hdr)) || (hdr.type != NET_MSG_DPS) || (hdr.cnt > NET_MAX_BATCH) || ((int)hdr.size > max_size) ||
+			!NetRecv(sess->sock, packed, hdr.size) || !UnpackDPs(packed, hdr.size, hdr.cnt, hello.target_cnt, dps))
+		{
+			//whole batch is dropped, DPs with wrong kind or target would be checked against points that are not set
+			ok = false;
+			break;
+		}
+		Host->AddPoints((u32*)dps, hdr.cnt, hdr.val);
+		DPsCnt += hdr.cnt;
+		ops_total += hdr.val;
+	}
+	if (ok)
+	{
+		//final state, clients stop when all points are solved
+		hdr.type = NET_MSG_SOLVED;
+		hdr.cnt = 0;
+		hdr.val = solved_mask;
+		hdr.size = 0;
+		NetSend(sess->sock, &hdr, sizeof(hdr));
+	}
+	else
+		printf("\r\nDP server: client disconnected\r\n");
+	free(packed);
+	free(dps);
+}
+
+int RCDPServer::GetStatsSpeed()
+{
+	int res = SpeedStats[0];
+	for (int i = 1; i < STATS_WND_SIZE; i++)
+		res += SpeedStats[i];
+	return res / STATS_WND_SIZE;
+}
@@ -0,0 +1,56 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include <atomic>
+#include "KangWorker.h"
+#include "Net.h"
+
+//DP server is a worker that receives DPs from remote clients instead of GPU
+//every client has its own thread, DPs go to the same DP queue as DPs from local GPUs
+
+class RCDPServer;
+
+struct TNetSession
+{
+	RCDPServer* server;
+	u64 sock;
+	HHANDLER thr;
+	volatile bool done;
+};
+
+class RCDPServer : public RCKangWorker
+{
+private:
+	char addr[256];
+	u64 listen_sock;
+	volatile bool StopFlag;
+	TNetHello hello;
+	CriticalSection cs;
+	std::vector <TNetSession*> sessions;
+	std::atomic<u64> solved_mask;
+	std::atomic<u64> ops_total;
+	int cur_stats_ind;
+	int SpeedStats[STATS_WND_SIZE];
+
+	void CloseSessions(bool all);
+public:
+	RCDPServer(char* _addr);
+	~RCDPServer();
+	int CalcKangCnt();
+	bool Prepare(EcPoint* _PntsToSolve, int _PntCnt, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3);
+	void Stop();
+	void Execute();
+	void Release();
+	int GetStatsSpeed();
+	const char* GetKind() { return "dpserver"; }
+
+	//executes in main thread, clients get new mask
+	void SetSolvedMask(u64 mask) { solved_mask = mask; }
+	int GetClientCnt();
+	void ExecuteSession(TNetSession* sess);
+};
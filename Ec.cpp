@@ -6,7 +6,6 @@
 
 #include "defs.h"
 #include "Ec.h"
-#include <random>
 #include "utils.h"
 
 // https://en.bitcoin.it/wiki/Secp256k1
@@ -15,6 +14,9 @@ EcInt g_N; //FFFFFFFF FFFFFFFF FFFFFFFF FFFFFFFE BAAEDCE6 AF48A03B BFD25E8C D036
 EcPoint g_G; //Generator point
 
 #define P_REV	0x00000001000003D1
+//2^256 - N, 129 bits
+#define N_REV0	0x402DA1732FC9BEBF
+#define N_REV1	0x4551231950B75FC4
 
 #ifdef DEBUG_MODE
 u8* GTable = NULL; //16x16-bit table
@@ -200,9 +202,15 @@ EcPoint Ec::DoublePoint(EcPoint& pnt)
 
 //k up to 256 bits
 EcPoint Ec::MultiplyG(EcInt& k)
+{
+	return MultiplyPoint(g_G, k);
+}
+
+//k up to 256 bits, simple double-and-add, it's for a few multiplications only
+EcPoint Ec::MultiplyPoint(EcPoint& pnt, EcInt& k)
 {
 	EcPoint res;
-	EcPoint t = g_G;
+	EcPoint t = pnt;
 	bool first = true;
 	int n = 3;
 	while ((n >= 0) && !k.data[n])
@@ -229,6 +237,94 @@ EcPoint Ec::MultiplyG(EcInt& k)
 	return res;
 }
 
+//same double-and-add as MultiplyG for many k at once: 2^i*G is shared and all additions of one step use one inversion (Montgomery trick)
+//k must be less than N, rare additions of equal x are calculated by MultiplyG
+void Ec::MultiplyG_Batch(EcInt* k, EcPoint* res, int cnt)
+{
+	int bits = 0;
+	for (int j = 0; j < cnt; j++)
+		for (int n = 3; n >= 0; n--)
+			if (k[j].data[n])
+			{
+				int index;
+				_BitScanReverse64((DWORD*)&index, k[j].data[n]);
+				if (64 * n + index + 1 > bits)
+					bits = 64 * n + index + 1;
+				break;
+			}
+	u8* state = (u8*)malloc(cnt); //0 - no point yet, 1 - point, 2 - use MultiplyG
+	EcInt* dx = (EcInt*)malloc(cnt * sizeof(EcInt));
+	EcInt* acc = (EcInt*)malloc(cnt * sizeof(EcInt));
+	int* inds = (int*)malloc(cnt * sizeof(int));
+	memset(state, 0, cnt);
+	EcPoint t = g_G;
+	for (int i = 0; i < bits; i++)
+	{
+		int add_cnt = 0;
+		for (int j = 0; j < cnt; j++)
+		{
+			if (!((k[j].data[i / 64] >> (i % 64)) & 1) || (state[j] == 2))
+				continue;
+			if (!state[j])
+			{
+				state[j] = 1;
+				res[j] = t;
+				continue;
+			}
+			EcInt d = t.x;
+			d.SubModP(res[j].x);
+			if (d.IsZero())
+			{
+				state[j] = 2;
+				continue;
+			}
+			dx[add_cnt] = d;
+			acc[add_cnt] = (add_cnt) ? acc[add_cnt - 1] : d;
+			if (add_cnt)
+				acc[add_cnt].MulModP(d);
+			inds[add_cnt++] = j;
+		}
+		if (add_cnt)
+		{
+			EcInt inv = acc[add_cnt - 1];
+			inv.InvModP();
+			for (int a = add_cnt - 1; a >= 0; a--)
+			{
+				EcInt dx_inv = inv;
+				if (a)
+				{
+					dx_inv.MulModP(acc[a - 1]);
+					inv.MulModP(dx[a]);
+				}
+				//same formulas as AddPoints
+				EcPoint& pnt1 = res[inds[a]];
+				EcInt lambda = t.y;
+				lambda.SubModP(pnt1.y);
+				lambda.MulModP(dx_inv);
+				EcInt lambda2 = lambda;
+				lambda2.MulModP(lambda);
+				EcPoint r;
+				r.x = lambda2;
+				r.x.SubModP(pnt1.x);
+				r.x.SubModP(t.x);
+				r.y = t.x;
+				r.y.SubModP(r.x);
+				r.y.MulModP(lambda);
+				r.y.SubModP(t.y);
+				pnt1 = r;
+			}
+		}
+		t = Ec::DoublePoint(t);
+	}
+	for (int j = 0; j < cnt; j++)
+		if (state[j] != 1)
+			res[j] = MultiplyG(k[j]);
+	free(state);
+	free(dx);
+	free(acc);
+	free(inds);
+}
+
 #ifdef DEBUG_MODE
 //uses gTable (16x16-bit) to speedup calculation
 EcPoint Ec::MultiplyG_Fast(EcInt& k)
@@ -557,6 +653,74 @@ void EcInt::MulModP(EcInt& val)
 	data[4] = _addcarry_u64(c, buff[3], 0, data + 3);
 }
 
+//both values < N
+void EcInt::AddModN(EcInt& val)
+{
+	Add(val);
+	if (!IsLessThanU(g_N))
+		Sub(g_N);
+}
+
+//adds val to in_out, carry goes to upper limbs of in_out
+void AddLimbs(u64* in_out, int len, u64* val, int val_len)
+{
+	u8 c = 0;
+	for (int i = 0; i < len; i++)
+		c = _addcarry_u64(c, in_out[i], (i < val_len) ? val[i] : 0, in_out + i);
+}
+
+//not fast, for a few operations only, not for kangaroo walking
+void EcInt::MulModN(EcInt& val)
+{
+	u64 buff[8], acc[8], tmp[5];
+	//calc 512 bits
+	Mul256_by_64(val.data, data[0], buff);
+	Mul256_by_64(val.data, data[1], tmp);
+	Add320_to_256(buff + 1, tmp);
+	Mul256_by_64(val.data, data[2], tmp);
+	Add320_to_256(buff + 2, tmp);
+	Mul256_by_64(val.data, data[3], tmp);
+	Add320_to_256(buff + 3, tmp);
+	//hi * 2^256 = hi * N_REV mod N, every step reduces hi by 127 bits
+	while (buff[4] || buff[5] || buff[6] || buff[7])
+	{
+		memcpy(acc, buff, 4 * 8);
+		memset(acc + 4, 0, 4 * 8);
+		Mul256_by_64(buff + 4, N_REV0, tmp);
+		AddLimbs(acc, 8, tmp, 5);
+		Mul256_by_64(buff + 4, N_REV1, tmp);
+		AddLimbs(acc + 1, 7, tmp, 5);
+		AddLimbs(acc + 2, 6, buff + 4, 4);
+		memcpy(buff, acc, 8 * 8);
+	}
+	memcpy(data, buff, 4 * 8);
+	data[4] = 0;
+	if (!IsLessThanU(g_N))
+		Sub(g_N);
+}
+
+// x = a^(n - 2) mod n
+void EcInt::InvModN()
+{
+	EcInt exp = g_N;
+	EcInt two;
+	two.Set(2);
+	exp.Sub(two);
+	EcInt res;
+	res.Set(1);
+	EcInt cur = *this;
+	while (!exp.IsZero())
+	{
+		if (exp.data[0] & 1)
+			res.MulModN(cur);
+		EcInt tmp = cur;
+		tmp.MulModN(cur);
+		cur = tmp;
+		exp.ShiftRight(1);
+	}
+	*this = res;
+}
+
 void EcInt::Mul_u64(EcInt& val, u64 multiplier)
 {
 	Assign(val);
@@ -716,28 +880,32 @@ void EcInt::SqrtModP()
 	*this = res;
 }
 
-std::mt19937_64 rng;
-CriticalSection cs_rnd;
-
-void SetRndSeed(u64 seed)
+void TRndGen::SetSeed(u64 seed)
 {
+	cs.Enter();
 	rng.seed(seed);
+	cs.Leave();
+}
+
+void TRndGen::Fill(u64* data, int cnt)
+{
+	cs.Enter();
+	for (int i = 0; i < cnt; i++)
+		data[i] = rng();
+	cs.Leave();
 }
 
-void EcInt::RndBits(int nbits)
+void EcInt::RndBits(int nbits, TRndGen* gen)
 {
 	SetZero();
 	if (nbits > 256)
 		nbits = 256;
-	cs_rnd.Enter();
-	for (int i = 0; i < (nbits + 63) / 64; i++)
-		data[i] = rng();
-	cs_rnd.Leave();
+	gen->Fill(data, (nbits + 63) / 64);
 	data[nbits / 64] &= (1ull << (nbits % 64)) - 1;
 }
 
 //up to 256 bits only
-void EcInt::RndMax(EcInt& max)
+void EcInt::RndMax(EcInt& max, TRndGen* gen)
 {
 	SetZero();
 	int n = 3;
@@ -753,9 +921,9 @@ void EcInt::RndMax(EcInt& max)
 		k++;
 	}
 	int bits = 64 * n + (64 - k);
-	RndBits(bits);
+	RndBits(bits, gen);
 	while (!IsLessThanU(max)) // :)
-		RndBits(bits);
+		RndBits(bits, gen);
 }
 
 
@@ -6,9 +6,21 @@
 
 #pragma once
 
+#include <random>
 #include "defs.h"
 #include "utils.h"
 
+//random generator, every worker has its own one so workers and solves don't depend on each other
+class TRndGen
+{
+private:
+	std::mt19937_64 rng;
+	CriticalSection cs;
+public:
+	void SetSeed(u64 seed);
+	void Fill(u64* data, int cnt);
+};
+
 class EcInt
 {
 public:
@@ -42,9 +54,13 @@ public:
 	void MulModP(EcInt& val);
 	void InvModP();
 	void SqrtModP();
+	//mod N (order of G) for keys
+	void AddModN(EcInt& val);
+	void MulModN(EcInt& val);
+	void InvModN();
 
-	void RndBits(int nbits);
-	void RndMax(EcInt& max);
+	void RndBits(int nbits, TRndGen* gen);
+	void RndMax(EcInt& max, TRndGen* gen);
 
 	u64 data[4 + 1];
 };
@@ -66,6 +82,8 @@ public:
 	static EcPoint AddPoints(EcPoint& pnt1, EcPoint& pnt2);
 	static EcPoint DoublePoint(EcPoint& pnt);
 	static EcPoint MultiplyG(EcInt& k);
+	static EcPoint MultiplyPoint(EcPoint& pnt, EcInt& k);
+	static void MultiplyG_Batch(EcInt* k, EcPoint* res, int cnt);
 #ifdef DEBUG_MODE
 	static EcPoint MultiplyG_Fast(EcInt& k);
 #endif
@@ -73,6 +91,7 @@ public:
 	static bool IsValidPoint(EcPoint& pnt);
 };
 
+extern EcInt g_N; //order of G
+
 void InitEc();
 void DeInitEc();
-void SetRndSeed(u64 seed);
\ No newline at end of file
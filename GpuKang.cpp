@@ -5,6 +5,7 @@
 
 
 #include <iostream>
+#include <algorithm>
 #include "cuda_runtime.h"
 #include "cuda.h"
 
@@ -13,8 +14,21 @@
 cudaError_t cuSetGpuParams(TKparams Kparams, u64* _jmp2_table);
 void CallGpuKernelGen(TKparams Kparams);
 void CallGpuKernelABC(TKparams Kparams);
-void AddPointsToList(u32* data, int cnt, u64 ops_cnt);
-extern bool gGenMode; //tames generation mode
+void CallGpuKernelGenList(TKparams Kparams);
+
+RCGpuKang::RCGpuKang()
+{
+	Allocated = false;
+	JmpRange = 0;
+	RndPnts = NULL;
+	DPs_out = NULL;
+	memset(&Kparams, 0, sizeof(Kparams));
+}
+
+RCGpuKang::~RCGpuKang()
+{
+	Release();
+}
 
 int RCGpuKang::CalcKangCnt()
 {
@@ -24,37 +38,19 @@ int RCGpuKang::CalcKangCnt()
 	return Kparams.BlockSize* Kparams.GroupCnt* Kparams.BlockCnt;
 }
 
-//executes in main thread
-bool RCGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3)
+//sizes depend on gpu only, so buffers are allocated once for all points
+bool RCGpuKang::Allocate()
 {
-	PntToSolve = _PntToSolve;
-	Range = _Range;
-	DP = _DP;
-	EcJumps1 = _EcJumps1;
-	EcJumps2 = _EcJumps2;
-	EcJumps3 = _EcJumps3;
-	StopFlag = false;
-	Failed = false;
-	u64 total_mem = 0;
-	memset(dbg, 0, sizeof(dbg));
-	memset(SpeedStats, 0, sizeof(SpeedStats));
-	cur_stats_ind = 0;
-
 	cudaError_t err;
-	err = cudaSetDevice(CudaIndex);
-	if (err != cudaSuccess)
-		return false;
-
+	u64 total_mem = 0;
 	Kparams.BlockCnt = mpCnt;
 	Kparams.BlockSize = IsOldGpu ? 512 : 256;
 	Kparams.GroupCnt = IsOldGpu ? 64 : 24;
 	KangCnt = Kparams.BlockSize * Kparams.GroupCnt * Kparams.BlockCnt;
 	Kparams.KangCnt = KangCnt;
-	Kparams.DP = DP;
 	Kparams.KernelA_LDS_Size = 64 * JMP_CNT + 16 * Kparams.BlockSize;
 	Kparams.KernelB_LDS_Size = 64 * JMP_CNT;
 	Kparams.KernelC_LDS_Size = 96 * JMP_CNT;
-	Kparams.IsGenMode = gGenMode;
 
 //allocate gpu mem
 	u64 size;
@@ -70,7 +66,7 @@ bool RCGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJump
 			return false;
 		}
 		size = L2size;
-		if (size > persistingL2CacheMaxSize)
+		if (size > (u64)persistingL2CacheMaxSize)
 			size = persistingL2CacheMaxSize;
 		err = cudaDeviceSetLimit(cudaLimitPersistingL2CacheSize, size); // set max allowed size for L2
 		//persisting for L2
@@ -191,8 +187,36 @@ bool RCGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJump
 		return false;
 	}
 
+	GenCap = (KangCnt < MAX_DP_CNT) ? KangCnt : MAX_DP_CNT;
+	size = sizeof(u32) * (GenCap + 1);
+	total_mem += size;
+	err = cudaMalloc((void**)&Kparams.GenList, size);
+	if (err != cudaSuccess)
+	{
+		printf("GPU %d Allocate GenList memory failed: %s\n", CudaIndex, cudaGetErrorString(err));
+		return false;
+	}
+
+	size = (u64)GenCap * 96;
+	total_mem += size;
+	err = cudaMalloc((void**)&Kparams.GenPnts, size);
+	if (err != cudaSuccess)
+	{
+		printf("GPU %d Allocate GenPnts memory failed: %s\n", CudaIndex, cudaGetErrorString(err));
+		return false;
+	}
+
 	DPs_out = (u32*)malloc(MAX_DP_CNT * GPU_DP_SIZE);
+	RndPnts = (TPointPriv*)malloc(KangCnt * 96);
+	Allocated = true;
+	printf("GPU %d: allocated %llu MB, %d kangaroos. OldGpuMode: %s\r\n", CudaIndex, total_mem / (1024 * 1024), KangCnt, IsOldGpu ? "Yes" : "No");
+	return true;
+}
 
+//jumps depend on range only, jmp2 table is in constant memory
+bool RCGpuKang::UploadJumps()
+{
+	cudaError_t err;
 //jmp1
 	u64* buf = (u64*)malloc(JMP_CNT * 96);
 	for (int i = 0; i < JMP_CNT; i++)
@@ -250,15 +274,64 @@ bool RCGpuKang::Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJump
 		return false;
 	}
 	free(buf);
+	JmpRange = Range;
+	return true;
+}
 
-	printf("GPU %d: allocated %llu MB, %d kangaroos. OldGpuMode: %s\r\n", CudaIndex, total_mem / (1024 * 1024), KangCnt, IsOldGpu ? "Yes" : "No");
+//executes in main thread
+//buffers and jumps are kept from previous point if possible
+bool RCGpuKang::Prepare(EcPoint* _PntsToSolve, int _PntCnt, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3)
+{
+	PntCnt = _PntCnt;
+	for (int i = 0; i < PntCnt; i++)
+		PntsToSolve[i] = _PntsToSolve[i];
+	Range = _Range;
+	DP = _DP;
+	EcJumps1 = _EcJumps1;
+	EcJumps2 = _EcJumps2;
+	EcJumps3 = _EcJumps3;
+	StopFlag = false;
+	Failed = false;
+	memset(dbg, 0, sizeof(dbg));
+	memset(SpeedStats, 0, sizeof(SpeedStats));
+	cur_stats_ind = 0;
+	rnd.SetSeed(Seed + CudaIndex);
+
+	cudaError_t err;
+	err = cudaSetDevice(CudaIndex);
+	if (err != cudaSuccess)
+		return false;
+
+	if (!Allocated && !Allocate())
+	{
+		Release();
+		return false;
+	}
+	if ((JmpRange != Range) && !UploadJumps())
+	{
+		Release();
+		return false;
+	}
+
+	//kernels get Kparams by value, so per-point params are just set here
+	Kparams.DP = DP;
+	Kparams.IsGenMode = GenMode;
+	Kparams.TargetCnt = PntCnt;
+	Kparams.WorkerInd = WorkerInd;
+	CalcHerd();
+	Kparams.TameCnt = TameCnt;
+	Kparams.Wild1Cnt = Wild1Cnt;
 	return true;
 }
 
+//pointers are cleared, so it can be called for partially allocated buffers too
 void RCGpuKang::Release()
 {
+	cudaSetDevice(CudaIndex);
 	free(RndPnts);
 	free(DPs_out);
+	cudaFree(Kparams.GenPnts);
+	cudaFree(Kparams.GenList);
 	cudaFree(Kparams.LoopedKangs);
 	cudaFree(Kparams.dbg_buf);
 	cudaFree(Kparams.LoopTable);
@@ -273,6 +346,26 @@ void RCGpuKang::Release()
 	cudaFree(Kparams.DPs_out);
 	if (!IsOldGpu)
 		cudaFree(Kparams.L2);
+	RndPnts = NULL;
+	DPs_out = NULL;
+	//only pointers, launch params are set by Allocate
+	Kparams.GenPnts = NULL;
+	Kparams.GenList = NULL;
+	Kparams.LoopedKangs = NULL;
+	Kparams.dbg_buf = NULL;
+	Kparams.LoopTable = NULL;
+	Kparams.LastPnts = NULL;
+	Kparams.L1S2 = NULL;
+	Kparams.DPTable = NULL;
+	Kparams.JumpsList = NULL;
+	Kparams.Jumps3 = NULL;
+	Kparams.Jumps2 = NULL;
+	Kparams.Jumps1 = NULL;
+	Kparams.Kangs = NULL;
+	Kparams.DPs_out = NULL;
+	Kparams.L2 = NULL;
+	Allocated = false;
+	JmpRange = 0;
 }
 
 void RCGpuKang::Stop()
@@ -280,20 +373,166 @@ void RCGpuKang::Stop()
 	StopFlag = true;
 }
 
+void RCGpuKang::GenRndDistance(int kang_ind, EcInt* d)
+{
+	if ((u32)kang_ind < TameCnt)
+		d->RndBits(Range - 4, &rnd); //TAME kangs
+	else
+	{
+		d->RndBits(Range - 1, &rnd);
+		d->data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+	}
+}
+
 void RCGpuKang::GenerateRndDistances()
 {
 	for (int i = 0; i < KangCnt; i++)
 	{
 		EcInt d;
-		if (i < KangCnt / 3)
-			d.RndBits(Range - 4); //TAME kangs
-		else
+		GenRndDistance(i, &d);
+		memcpy(RndPnts[i].priv, d.data, 24);
+	}
+}
+
+//executes in worker thread between kernel calls, kangaroos are in global memory at this time
+//new distances are generated like in GenerateRndDistances, start points are calculated by KernelGenList like by KernelGen
+//kang must be listed once, so list is sorted and duplicates are removed
+bool RCGpuKang::RestartKangs(std::vector <u32>& list)
+{
+	std::sort(list.begin(), list.end());
+	list.erase(std::unique(list.begin(), list.end()), list.end());
+	u32* gen_list = (u32*)DPs_out; //DPs are already sent
+	for (size_t first = 0; first < list.size(); first += GenCap)
+	{
+		u32 cnt = (u32)((list.size() - first < (size_t)GenCap) ? list.size() - first : GenCap);
+		gen_list[0] = cnt;
+		for (u32 i = 0; i < cnt; i++)
 		{
-			d.RndBits(Range - 1);
-			d.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+			u32 kang_ind = list[first + i];
+			int type = GetKangType(kang_ind);
+			if (type == TAME)
+				memset(RndPnts[i].x, 0, 64);
+			else
+				if (type == WILD1)
+					PntA[kang_ind % PntCnt].SaveToBuffer64((u8*)RndPnts[i].x);
+				else
+					PntB[kang_ind % PntCnt].SaveToBuffer64((u8*)RndPnts[i].x);
+			EcInt d;
+			GenRndDistance(kang_ind, &d);
+			memcpy(RndPnts[i].priv, d.data, 24);
+			gen_list[1 + i] = kang_ind;
 		}
-		memcpy(RndPnts[i].priv, d.data, 24);
+		if (cudaMemcpy(Kparams.GenList, gen_list, (cnt + 1) * sizeof(u32), cudaMemcpyHostToDevice) != cudaSuccess)
+			return false;
+		if (cudaMemcpy(Kparams.GenPnts, RndPnts, cnt * 96, cudaMemcpyHostToDevice) != cudaSuccess)
+			return false;
+		CallGpuKernelGenList(Kparams);
+		cudaError_t err = cudaGetLastError();
+		if (err != cudaSuccess)
+		{
+			printf("GPU %d, KernelGenList failed: %s\r\n", CudaIndex, cudaGetErrorString(err));
+			return false;
+		}
+	}
+	return true;
+}
+
+bool RCGpuKang::ReseedKangs(std::vector <u32>& list)
+{
+	if (!RestartKangs(list))
+		return false;
+	ReseedCnt += list.size();
+	return true;
+}
+
+//wilds that sent DPs start again from new random points, tames are kept
+bool RCGpuKang::RestartWilds(u32* dps, int cnt)
+{
+	std::vector <u32> list;
+	for (int i = 0; i < cnt; i++)
+	{
+		u32* rec = dps + i * GPU_DP_SIZE / 4;
+		if ((rec[10] & 0xFFFF) != TAME)
+			list.push_back(rec[11] & ((1 << DP_KANG_BITS) - 1));
 	}
+	if (list.empty())
+		return true;
+	if (!RestartKangs(list))
+		return false;
+	RestartCnt += list.size();
+	return true;
+}
+
+//L1S2 flags are bits in one word per thread: u32 for new gpus, u64 for old gpus
+//executes in worker thread between kernel calls
+bool RCGpuKang::ReadKangs(u32 first, u32 cnt, TKangState* buf)
+{
+	if (cudaMemcpy(buf, Kparams.Kangs + first * 12, cnt * sizeof(TKangState), cudaMemcpyDeviceToHost) != cudaSuccess)
+		return false;
+	int wsize = IsOldGpu ? 8 : 4;
+	u32 w_first = first / Kparams.GroupCnt;
+	u32 w_cnt = (first + cnt - 1) / Kparams.GroupCnt - w_first + 1;
+	u8* words = (u8*)malloc(w_cnt * wsize);
+	bool res = cudaMemcpy(words, (u8*)Kparams.L1S2 + w_first * wsize, w_cnt * wsize, cudaMemcpyDeviceToHost) == cudaSuccess;
+	for (u32 i = 0; res && (i < cnt); i++)
+	{
+		u32 kang = first + i;
+		u8* w = words + (kang / Kparams.GroupCnt - w_first) * wsize;
+		u64 val = IsOldGpu ? *(u64*)w : *(u32*)w;
+		buf[i].flags = ((val >> (kang % Kparams.GroupCnt)) & 1) ? KS_JMP2 : 0;
+	}
+	free(words);
+	return res;
+}
+
+static bool FixLess(const TKangFix& f1, const TKangFix& f2)
+{
+	return f1.kang < f2.kang;
+}
+
+//fixes are sorted (later fix of the same kang wins), consecutive kangs are written by one copy, it's important for restored checkpoint
+bool RCGpuKang::WriteKangs(std::vector <TKangFix>& list)
+{
+	std::stable_sort(list.begin(), list.end(), FixLess);
+	int wsize = IsOldGpu ? 8 : 4;
+	std::vector <TKangState> states;
+	std::vector <u8> words;
+	size_t i = 0;
+	while (i < list.size())
+	{
+		size_t n = 1;
+		while ((i + n < list.size()) && (list[i + n].kang == list[i].kang + n))
+			n++;
+		u32 first = list[i].kang;
+		states.resize(n);
+		for (size_t k = 0; k < n; k++)
+			states[k] = list[i + k].st;
+		//last u64 of kang record is not used by kernels, but keep it
+		if (cudaMemcpy2D(Kparams.Kangs + first * 12, 96, states.data(), sizeof(TKangState), 88, n, cudaMemcpyHostToDevice) != cudaSuccess)
+			return false;
+		u32 w_first = first / Kparams.GroupCnt;
+		u32 w_cnt = (u32)((first + n - 1) / Kparams.GroupCnt - w_first + 1);
+		words.resize(w_cnt * wsize);
+		u8* w_gpu = (u8*)Kparams.L1S2 + w_first * wsize;
+		if (cudaMemcpy(words.data(), w_gpu, w_cnt * wsize, cudaMemcpyDeviceToHost) != cudaSuccess)
+			return false;
+		for (size_t k = 0; k < n; k++)
+		{
+			u32 kang = first + (u32)k;
+			u8* w = words.data() + (kang / Kparams.GroupCnt - w_first) * wsize;
+			u64 val = IsOldGpu ? *(u64*)w : *(u32*)w;
+			u64 bit = 1ull << (kang % Kparams.GroupCnt);
+			val = (states[k].flags & KS_JMP2) ? (val | bit) : (val & ~bit);
+			if (IsOldGpu)
+				*(u64*)w = val;
+			else
+				*(u32*)w = (u32)val;
+		}
+		if (cudaMemcpy(w_gpu, words.data(), w_cnt * wsize, cudaMemcpyHostToDevice) != cudaSuccess)
+			return false;
+		i += n;
+	}
+	return true;
 }
 
 bool RCGpuKang::Start()
@@ -312,11 +551,13 @@ bool RCGpuKang::Start()
 	NegPntHalfRange = PntHalfRange;
 	NegPntHalfRange.y.NegModP();
 
-	PntA = ec.AddPoints(PntToSolve, NegPntHalfRange);
-	PntB = PntA;
-	PntB.y.NegModP();
+	for (int i = 0; i < PntCnt; i++)
+	{
+		PntA[i] = ec.AddPoints(PntsToSolve[i], NegPntHalfRange);
+		PntB[i] = PntA[i];
+		PntB[i].y.NegModP();
+	}
 
-	RndPnts = (TPointPriv*)malloc(KangCnt * 96);
 	GenerateRndDistances();
 /* 
 	//we can calc start points on CPU
@@ -330,18 +571,18 @@ bool RCGpuKang::Start()
 		memcpy(RndPnts[i].x, p.x.data, 32);
 		memcpy(RndPnts[i].y, p.y.data, 32);
 	}
-	for (int i = KangCnt / 3; i < 2 * KangCnt / 3; i++)
+	for (int i = (int)TameCnt; i < (int)(TameCnt + Wild1Cnt); i++)
 	{
 		EcPoint p;
 		p.LoadFromBuffer64((u8*)RndPnts[i].x);
-		p = ec.AddPoints(p, PntA);
+		p = ec.AddPoints(p, PntA[i % PntCnt]);
 		p.SaveToBuffer64((u8*)RndPnts[i].x);
 	}
-	for (int i = 2 * KangCnt / 3; i < KangCnt; i++)
+	for (int i = (int)(TameCnt + Wild1Cnt); i < KangCnt; i++)
 	{
 		EcPoint p;
 		p.LoadFromBuffer64((u8*)RndPnts[i].x);
-		p = ec.AddPoints(p, PntB);
+		p = ec.AddPoints(p, PntB[i % PntCnt]);
 		p.SaveToBuffer64((u8*)RndPnts[i].x);
 	}
 	//copy to gpu
@@ -351,20 +592,19 @@ bool RCGpuKang::Start()
 		printf("GPU %d, cudaMemcpy failed: %s\n", CudaIndex, cudaGetErrorString(err));
 		return false;
 	}
-/**/
+*/
 	//but it's faster to calc then on GPU
-	u8 buf_PntA[64], buf_PntB[64];
-	PntA.SaveToBuffer64(buf_PntA);
-	PntB.SaveToBuffer64(buf_PntB);
+	//wild kang solves target (kang_ind % PntCnt), same rule is used by GPU to mark DPs
 	for (int i = 0; i < KangCnt; i++)
 	{
-		if (i < KangCnt / 3)
+		int type = GetKangType(i);
+		if (type == TAME)
 			memset(RndPnts[i].x, 0, 64);
 		else
-			if (i < 2 * KangCnt / 3)
-				memcpy(RndPnts[i].x, buf_PntA, 64);
+			if (type == WILD1)
+				PntA[i % PntCnt].SaveToBuffer64((u8*)RndPnts[i].x);
 			else
-				memcpy(RndPnts[i].x, buf_PntB, 64);
+				PntB[i % PntCnt].SaveToBuffer64((u8*)RndPnts[i].x);
 	}
 	//copy to gpu
 	err = cudaMemcpy(Kparams.Kangs, RndPnts, KangCnt * 96, cudaMemcpyHostToDevice);
@@ -407,13 +647,14 @@ int RCGpuKang::Dbg_CheckKangs()
 		p = ec.MultiplyG_Fast(dist);
 		if (neg)
 			p.y.NegModP();
-		if (i < KangCnt / 3)
+		int type = GetKangType(i);
+		if (type == TAME)
 			p = p;
 		else
-			if (i < 2 * KangCnt / 3)
-				p = ec.AddPoints(PntA, p);
+			if (type == WILD1)
+				p = ec.AddPoints(PntA[i % PntCnt], p);
 			else
-				p = ec.AddPoints(PntB, p);
+				p = ec.AddPoints(PntB[i % PntCnt], p);
 		if (!p.IsEqual(Pnt))
 			res++;
 	}
@@ -422,7 +663,6 @@ int RCGpuKang::Dbg_CheckKangs()
 }
 #endif
 
-extern u32 gTotalErrors;
 
 //executes in separate thread
 void RCGpuKang::Execute()
@@ -431,15 +671,32 @@ void RCGpuKang::Execute()
 
 	if (!Start())
 	{
-		gTotalErrors++;
+		Host->AddError();
+		Release();
 		return;
 	}
 #ifdef DEBUG_MODE
 	u64 iter = 1;
 #endif
 	cudaError_t err;	
+	bool failed = false;
+	std::vector <u32> reseed;
 	while (!StopFlag)
 	{
+		if (!ServeStates())
+		{
+			printf("GPU %d, kangaroos audit failed\r\n", CudaIndex);
+			Host->AddError();
+			failed = true;
+			break;
+		}
+		if (PopReseed(&reseed) && !ReseedKangs(reseed))
+		{
+			printf("GPU %d, kangaroos restart failed\r\n", CudaIndex);
+			Host->AddError();
+			failed = true;
+			break;
+		}
 		u64 t1 = GetTickCount64();
 		cudaMemset(Kparams.DPs_out, 0, 4);
 		cudaMemset(Kparams.DPTable, 0, KangCnt * sizeof(u32));
@@ -450,13 +707,15 @@ void RCGpuKang::Execute()
 		if (err != cudaSuccess)
 		{
 			printf("GPU %d, CallGpuKernel failed: %s\r\n", CudaIndex, cudaGetErrorString(err));
-			gTotalErrors++;
+			Host->AddError();
+			failed = true;
 			break;
 		}
 		
 		if (cnt >= MAX_DP_CNT)
 		{
 			cnt = MAX_DP_CNT;
+			OverflowCnt++;
 			printf("GPU %d, gpu DP buffer overflow, some points lost, increase DP value!\r\n", CudaIndex);
 		}
 		u64 pnt_cnt = (u64)KangCnt * STEP_CNT;
@@ -466,10 +725,19 @@ void RCGpuKang::Execute()
 			err = cudaMemcpy(DPs_out, Kparams.DPs_out + 4, cnt * GPU_DP_SIZE, cudaMemcpyDeviceToHost);
 			if (err != cudaSuccess)
 			{
-				gTotalErrors++;
+				Host->AddError();
+				failed = true;
+				break;
+			}
+			Host->AddPoints(DPs_out, cnt, (u64)KangCnt * STEP_CNT);
+			DPsCnt += cnt;
+			if (WildRestart && !GenMode && !RestartWilds(DPs_out, cnt))
+			{
+				printf("GPU %d, wild kangaroos restart failed\r\n", CudaIndex);
+				Host->AddError();
+				failed = true;
 				break;
 			}
-			AddPointsToList(DPs_out, cnt, (u64)KangCnt * STEP_CNT);
 		}
 
 		//dbg
@@ -496,7 +764,7 @@ void RCGpuKang::Execute()
 			if (corr_cnt)
 			{
 				printf("DBG: GPU %d, KANGS CORRUPTED: %d\r\n", CudaIndex, corr_cnt);
-				gTotalErrors++;
+				Host->AddError();
 			}
 			else
 				printf("DBG: GPU %d, ALL KANGS OK!\r\n", CudaIndex);
@@ -505,7 +773,9 @@ void RCGpuKang::Execute()
 #endif
 	}
 
-	Release();
+	//buffers are kept for next point, after errors they are allocated again
+	if (failed)
+		Release();
 }
 
 int RCGpuKang::GetStatsSpeed()
@@ -6,15 +6,7 @@
 
 #pragma once
 
-#include "Ec.h"
-
-#define STATS_WND_SIZE	16
-
-struct EcJMP
-{
-	EcPoint p;
-	EcInt dist;
-};
+#include "KangWorker.h"
 
 //96bytes size
 struct TPointPriv
@@ -24,11 +16,12 @@ struct TPointPriv
 	u64 priv[4];
 };
 
-class RCGpuKang
+class RCGpuKang : public RCKangWorker
 {
 private:
 	bool StopFlag;
-	EcPoint PntToSolve;
+	EcPoint PntsToSolve[MAX_TARGET_CNT];
+	int PntCnt;
 	int Range; //in bits
 	int DP; //in bits
 	Ec ec;
@@ -40,36 +33,47 @@ private:
 	EcPoint PntHalfRange;
 	EcPoint NegPntHalfRange;
 	TPointPriv* RndPnts;
+	TRndGen rnd; //for random start positions, seeded by Seed and CudaIndex
 	EcJMP* EcJumps1;
 	EcJMP* EcJumps2;
 	EcJMP* EcJumps3;
 
-	EcPoint PntA;
-	EcPoint PntB;
+	EcPoint PntA[MAX_TARGET_CNT];
+	EcPoint PntB[MAX_TARGET_CNT];
 
 	int cur_stats_ind;
 	int SpeedStats[STATS_WND_SIZE];
+	bool Allocated;
+	int JmpRange; //range of jumps in gpu memory, 0 - not uploaded
+	u32 GenCap; //max kangs for one KernelGenList call
 
+	void GenRndDistance(int kang_ind, EcInt* d);
 	void GenerateRndDistances();
+	bool RestartKangs(std::vector <u32>& list);
+	bool ReseedKangs(std::vector <u32>& list);
+	bool RestartWilds(u32* dps, int cnt);
+	bool ReadKangs(u32 first, u32 cnt, TKangState* buf);
+	bool WriteKangs(std::vector <TKangFix>& list);
+	bool Allocate();
+	bool UploadJumps();
 	bool Start();
-	void Release();
 #ifdef DEBUG_MODE
 	int Dbg_CheckKangs();
 #endif
 public:
 	int persistingL2CacheMaxSize;
-	int CudaIndex; //gpu index in cuda
 	int mpCnt;
-	int KangCnt;
-	bool Failed;
 	bool IsOldGpu;
 
+	RCGpuKang();
+	~RCGpuKang();
 	int CalcKangCnt();
-	bool Prepare(EcPoint _PntToSolve, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3);
+	bool Prepare(EcPoint* _PntsToSolve, int _PntCnt, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3);
 	void Stop();
 	void Execute();
-
-	u32 dbg[256];
+	void Release();
 
 	int GetStatsSpeed();
+	const char* GetKind() { return "gpu"; }
+	bool HasKangStates() { return true; }
 };
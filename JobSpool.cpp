@@ -0,0 +1,160 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <stdlib.h>
+#include "JobSpool.h"
+
+TJobSpool::TJobSpool()
+{
+	dir[0] = 0;
+}
+
+void TJobSpool::GetFileName(char* name, const char* ext, char* fn)
+{
+	int len = (int)strlen(dir);
+	bool slash = len && ((dir[len - 1] == '/') || (dir[len - 1] == '\\'));
+	sprintf(fn, "%s%s%s%s", dir, slash ? "" : "/", name, ext);
+}
+
+bool TJobSpool::Move(char* name, const char* from_ext, const char* to_ext)
+{
+	char src[1300], dst[1300];
+	GetFileName(name, from_ext, src);
+	GetFileName(name, to_ext, dst);
+	if (RenameFile(src, dst))
+		return true;
+	printf("job spool: cannot rename %s to %s\r\n", src, dst);
+	return false;
+}
+
+bool TJobSpool::Init(char* _dir)
+{
+	strcpy(dir, _dir);
+	std::vector <std::string> names;
+	if (!ListFiles(dir, JOB_RUN_EXT, names))
+	{
+		printf("job spool: cannot read directory %s\r\n", dir);
+		return false;
+	}
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		printf("job spool: job %s was not finished, it's queued again\r\n", names[i].c_str());
+		if (!Move((char*)names[i].c_str(), JOB_RUN_EXT, JOB_EXT))
+			return false;
+	}
+	return true;
+}
+
+//returns false with message if job file is not valid
+bool TJobSpool::Load(char* name, TJob* job)
+{
+	char fn[1300];
+	GetFileName(name, JOB_EXT, fn);
+	FILE* fp = fopen(fn, "rt");
+	if (!fp)
+		return false;
+	*job = TJob();
+	strcpy(job->name, name);
+	char line[1024], key[32], val[1024];
+	int line_num = 0;
+	bool res = true;
+	while (res && fgets(line, sizeof(line), fp))
+	{
+		line_num++;
+		int cnt = sscanf(line, "%31s %1023s", key, val);
+		if ((cnt <= 0) || (key[0] == '#'))
+			continue;
+		if (cnt != 2)
+			res = false;
+		else
+			if (!strcmp(key, "pubkey"))
+			{
+				res = (job->PubKeyCnt < MAX_TARGET_CNT) && job->PubKeys[job->PubKeyCnt].SetHexStr(val);
+				job->PubKeyCnt++;
+			}
+			else
+				if (!strcmp(key, "range"))
+				{
+					char* colon = strchr(val, ':');
+					EcInt end;
+					res = colon != NULL;
+					if (res)
+					{
+						*colon = 0;
+						res = job->Start.SetHexStr(val) && end.SetHexStr(colon + 1) && !end.Sub(job->Start);
+					}
+					job->Range = 0;
+					for (int i = 3; res && (i >= 0); i--)
+						if (end.data[i])
+						{
+							u32 bit;
+							_BitScanReverse64(&bit, end.data[i]);
+							job->Range = i * 64 + bit + 1;
+							break;
+						}
+					res = res && (job->Range >= 32) && (job->Range <= 180);
+				}
+				else
+					if (!strcmp(key, "dp"))
+					{
+						job->DP = atoi(val);
+						res = (job->DP >= 14) && (job->DP <= 60);
+					}
+					else
+						if (!strcmp(key, "max"))
+						{
+							job->Max = atof(val);
+							res = job->Max >= 0.001;
+						}
+						else
+							res = false;
+		if (!res)
+			printf("job spool: invalid line %d in %s\r\n", line_num, fn);
+	}
+	fclose(fp);
+	if (res && (!job->PubKeyCnt || !job->Range))
+	{
+		printf("job spool: %s must have pubkey and range\r\n", fn);
+		res = false;
+	}
+	return res;
+}
+
+bool TJobSpool::Take(TJob* job)
+{
+	std::vector <std::string> names;
+	if (!ListFiles(dir, JOB_EXT, names))
+		return false;
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		char* name = (char*)names[i].c_str();
+		if (Load(name, job))
+			return Move(name, JOB_EXT, JOB_RUN_EXT);
+		Move(name, JOB_EXT, JOB_FAIL_EXT);
+	}
+	return false;
+}
+
+bool TJobSpool::Peek(TJob* job)
+{
+	std::vector <std::string> names;
+	if (!ListFiles(dir, JOB_EXT, names))
+		return false;
+	for (size_t i = 0; i < names.size(); i++)
+		if (Load((char*)names[i].c_str(), job))
+			return true;
+	return false;
+}
+
+void TJobSpool::Finish(TJob* job, bool ok)
+{
+	Move(job->name, JOB_RUN_EXT, ok ? JOB_DONE_EXT : JOB_FAIL_EXT);
+}
+
+void TJobSpool::Requeue(TJob* job)
+{
+	Move(job->name, JOB_RUN_EXT, JOB_EXT);
+}
@@ -0,0 +1,51 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+#include "Ec.h"
+
+//jobs for daemon mode are files in spool directory, they are taken in order of names.
+//Job file "<name>.job" has one option per line: "pubkey <key>" (repeat it to solve several points at once), "range <start>:<end>" in hex,
+//optional "dp <bits>" and "max <value>". Empty lines and lines starting with '#' are skipped.
+//Taken job is renamed to "<name>.run", finished one to "<name>.done" or "<name>.fail", so state of the queue is visible in directory
+
+#define JOB_EXT				".job"
+#define JOB_RUN_EXT			".run"
+#define JOB_DONE_EXT		".done"
+#define JOB_FAIL_EXT		".fail"
+
+struct TJob
+{
+	char name[256]; //file name without extension
+	EcPoint PubKeys[MAX_TARGET_CNT];
+	int PubKeyCnt;
+	EcInt Start;
+	int Range;
+	int DP; //0 - not set
+	double Max; //0 - not set
+};
+
+class TJobSpool
+{
+private:
+	char dir[1024];
+	void GetFileName(char* name, const char* ext, char* fn);
+	bool Load(char* name, TJob* job);
+	bool Move(char* name, const char* from_ext, const char* to_ext);
+public:
+	TJobSpool();
+	//jobs that were running when previous daemon was stopped are queued again
+	bool Init(char* _dir);
+	//first valid job, it's marked as running. Invalid jobs are marked as failed
+	bool Take(TJob* job);
+	//first valid job without marking, for preparation while current job works
+	bool Peek(TJob* job);
+	void Finish(TJob* job, bool ok);
+	//stopped job is queued again, it will be started from the beginning
+	void Requeue(TJob* job);
+};
@@ -0,0 +1,211 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include "JumpCache.h"
+
+struct TJmpThrData
+{
+	EcJMP* jmps;
+	int cnt;
+};
+
+THR_PROC(jmp_thr_proc)
+{
+	TJmpThrData* jd = (TJmpThrData*)data;
+	EcInt* k = (EcInt*)malloc(jd->cnt * sizeof(EcInt));
+	EcPoint* pnts = (EcPoint*)malloc(jd->cnt * sizeof(EcPoint));
+	for (int i = 0; i < jd->cnt; i++)
+		k[i] = jd->jmps[i].dist;
+	Ec::MultiplyG_Batch(k, pnts, jd->cnt);
+	for (int i = 0; i < jd->cnt; i++)
+		jd->jmps[i].p = pnts[i];
+	free(k);
+	free(pnts);
+	return 0;
+}
+
+static u64 CalcChecksum(u8* data, size_t size)
+{
+	u64 res = 0xCBF29CE484222325ull; //FNV-1a
+	for (size_t i = 0; i < size; i++)
+	{
+		res ^= data[i];
+		res *= 0x100000001B3ull;
+	}
+	return res;
+}
+
+TJumpCache::TJumpCache()
+{
+	for (int i = 0; i < JCACHE_RAM_CNT; i++)
+	{
+		range[i] = 0;
+		seed[i] = 0;
+		used[i] = 0;
+	}
+	cur = 0;
+	use_cnt = 0;
+	dir[0] = 0;
+}
+
+void TJumpCache::SetDir(char* _dir)
+{
+	strcpy(dir, _dir);
+}
+
+void TJumpCache::GetFileName(int Range, char* fn)
+{
+	int len = (int)strlen(dir);
+	bool slash = len && ((dir[len - 1] == '/') || (dir[len - 1] == '\\'));
+	sprintf(fn, "%s%sjumps_%d.dat", dir, slash ? "" : "/", Range);
+}
+
+bool TJumpCache::IsSameDists(EcJMP* tbl[JCACHE_TBL_CNT])
+{
+	for (int t = 0; t < JCACHE_TBL_CNT; t++)
+		for (int i = 0; i < JMP_CNT; i++)
+			if (!jmps[cur][t * JMP_CNT + i].dist.IsEqual(tbl[t][i].dist))
+				return false;
+	return true;
+}
+
+//one multiplication takes about 2 * 256 inversions, so split all jumps between threads and use batch multiplication
+void TJumpCache::CalcPoints()
+{
+	HHANDLER thrs[JCACHE_THR_CNT];
+	TJmpThrData jd[JCACHE_THR_CNT];
+	bool started[JCACHE_THR_CNT];
+	int cnt = JCACHE_TBL_CNT * JMP_CNT;
+	int per_thr = (cnt + JCACHE_THR_CNT - 1) / JCACHE_THR_CNT;
+	for (int i = 0; i < JCACHE_THR_CNT; i++)
+	{
+		int first = i * per_thr;
+		jd[i].jmps = jmps[cur] + first;
+		jd[i].cnt = (first < cnt) ? ((cnt - first < per_thr) ? cnt - first : per_thr) : 0;
+		started[i] = jd[i].cnt && StartThread(&thrs[i], jmp_thr_proc, &jd[i]);
+		if (!started[i] && jd[i].cnt)
+			jmp_thr_proc(&jd[i]);
+	}
+	for (int i = 0; i < JCACHE_THR_CNT; i++)
+		if (started[i])
+			WaitThread(thrs[i]);
+}
+
+bool TJumpCache::LoadFromFile(int Range, EcJMP* tbl[JCACHE_TBL_CNT])
+{
+	char fn[1100];
+	GetFileName(Range, fn);
+	FILE* fp = fopen(fn, "rb");
+	if (!fp)
+		return false;
+	TJumpCacheHeader hdr;
+	size_t size = JCACHE_TBL_CNT * JMP_CNT * JCACHE_REC_LEN;
+	u8* buf = (u8*)malloc(size);
+	bool ok = (fread(&hdr, 1, sizeof(hdr), fp) == sizeof(hdr)) && (fread(buf, 1, size, fp) == size);
+	fclose(fp);
+	ok = ok && (hdr.magic == JCACHE_MAGIC) && (hdr.version == JCACHE_VERSION) && (hdr.range == (u32)Range) && (hdr.jmp_cnt == JMP_CNT) && (hdr.seed == seed[cur]);
+	ok = ok && (hdr.checksum == CalcChecksum(buf, size));
+	if (ok)
+		for (int i = 0; i < JCACHE_TBL_CNT * JMP_CNT; i++)
+		{
+			u8* p = buf + i * JCACHE_REC_LEN;
+			jmps[cur][i].p.LoadFromBuffer64(p);
+			jmps[cur][i].dist.SetZero();
+			memcpy(jmps[cur][i].dist.data, p + 64, 24);
+		}
+	free(buf);
+	if (!ok)
+	{
+		printf("jump cache file %s is not valid, ignored\r\n", fn);
+		return false;
+	}
+	if (!IsSameDists(tbl))
+	{
+		printf("jump cache file %s has different jumps, ignored\r\n", fn);
+		return false;
+	}
+	return true;
+}
+
+//saved to temp file first, so other instances never read incomplete file
+bool TJumpCache::SaveToFile()
+{
+	char fn[1100], tmp_fn[1200];
+	GetFileName(range[cur], fn);
+	sprintf(tmp_fn, "%s.tmp", fn);
+	size_t size = JCACHE_TBL_CNT * JMP_CNT * JCACHE_REC_LEN;
+	u8* buf = (u8*)malloc(size);
+	for (int i = 0; i < JCACHE_TBL_CNT * JMP_CNT; i++)
+	{
+		u8* p = buf + i * JCACHE_REC_LEN;
+		jmps[cur][i].p.SaveToBuffer64(p);
+		memcpy(p + 64, jmps[cur][i].dist.data, 24);
+	}
+	TJumpCacheHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = JCACHE_MAGIC;
+	hdr.version = JCACHE_VERSION;
+	hdr.range = range[cur];
+	hdr.jmp_cnt = JMP_CNT;
+	hdr.seed = seed[cur];
+	hdr.checksum = CalcChecksum(buf, size);
+	bool ok = false;
+	FILE* fp = fopen(tmp_fn, "wb");
+	if (fp)
+	{
+		ok = (fwrite(&hdr, 1, sizeof(hdr), fp) == sizeof(hdr)) && (fwrite(buf, 1, size, fp) == size) && FlushFileToDisk(fp);
+		fclose(fp);
+		ok = ok && RenameFile(tmp_fn, fn);
+		if (!ok)
+			remove(tmp_fn);
+	}
+	free(buf);
+	if (!ok)
+		printf("jump cache file %s cannot be saved\r\n", fn);
+	return ok;
+}
+
+void TJumpCache::SetPoints(int Range, u64 Seed, EcJMP* EcJumps1, EcJMP* EcJumps2, EcJMP* EcJumps3)
+{
+	EcJMP* tbl[JCACHE_TBL_CNT] = { EcJumps1, EcJumps2, EcJumps3 };
+	cs.Enter();
+	bool found = false;
+	for (cur = 0; cur < JCACHE_RAM_CNT; cur++)
+		if ((range[cur] == Range) && (seed[cur] == Seed) && IsSameDists(tbl))
+		{
+			found = true;
+			break;
+		}
+	if (!found)
+	{
+		//least recently used slot is replaced
+		cur = 0;
+		for (int i = 1; i < JCACHE_RAM_CNT; i++)
+			if (used[i] < used[cur])
+				cur = i;
+		seed[cur] = Seed;
+		found = dir[0] && LoadFromFile(Range, tbl);
+		if (found)
+			printf("jumps loaded from cache\r\n");
+		else
+		{
+			u64 tm = GetTickCount64();
+			for (int t = 0; t < JCACHE_TBL_CNT; t++)
+				for (int i = 0; i < JMP_CNT; i++)
+					jmps[cur][t * JMP_CNT + i].dist = tbl[t][i].dist;
+			CalcPoints();
+			printf("jumps calculated in %llu ms\r\n", GetTickCount64() - tm);
+		}
+		range[cur] = Range;
+		if (!found && dir[0])
+			SaveToFile();
+	}
+	used[cur] = ++use_cnt;
+	for (int t = 0; t < JCACHE_TBL_CNT; t++)
+		for (int i = 0; i < JMP_CNT; i++)
+			tbl[t][i].p = jmps[cur][t * JMP_CNT + i].p;
+	cs.Leave();
+}
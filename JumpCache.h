@@ -0,0 +1,60 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+#include "Ec.h"
+#include "KangWorker.h"
+
+//jump distances are generated from fixed seed, only their points are expensive (3 * JMP_CNT point multiplications)
+//points of last tables are kept in RAM and, if cache dir is set, in file for every range:
+//TJumpCacheHeader, then for every jump: x(32), y(32), dist(24)
+//cached points are used only if header matches and cached distances are equal to the new ones
+
+#define JCACHE_MAGIC		0x544A4352 //"RCJT"
+#define JCACHE_VERSION		1
+#define JCACHE_TBL_CNT		3
+#define JCACHE_REC_LEN		88
+#define JCACHE_THR_CNT		16
+#define JCACHE_RAM_CNT		2 //tables of current range and tables prepared for next point
+
+#pragma pack(push, 1)
+struct TJumpCacheHeader
+{
+	u32 magic;
+	u32 version;
+	u32 range;
+	u32 jmp_cnt;
+	u64 seed;
+	u64 checksum; //of all records
+	u8 reserved[32];
+};
+#pragma pack(pop)
+
+class TJumpCache
+{
+private:
+	int range[JCACHE_RAM_CNT]; //of tables in RAM, 0 - no tables
+	u64 seed[JCACHE_RAM_CNT];
+	u64 used[JCACHE_RAM_CNT]; //last SetPoints for this slot
+	EcJMP jmps[JCACHE_RAM_CNT][JCACHE_TBL_CNT * JMP_CNT];
+	int cur; //slot for helpers below
+	u64 use_cnt;
+	CriticalSection cs;
+	char dir[1024];
+	void GetFileName(int Range, char* fn);
+	bool IsSameDists(EcJMP* tbl[JCACHE_TBL_CNT]);
+	bool LoadFromFile(int Range, EcJMP* tbl[JCACHE_TBL_CNT]);
+	bool SaveToFile();
+	void CalcPoints();
+public:
+	TJumpCache();
+	void SetDir(char* _dir);
+	//distances must be set in all tables, points are calculated or taken from cache
+	//it can be called from other thread to prepare tables for next point, calls are serialized
+	void SetPoints(int Range, u64 Seed, EcJMP* EcJumps1, EcJMP* EcJumps2, EcJMP* EcJumps3);
+};
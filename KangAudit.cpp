@@ -0,0 +1,376 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include "KangAudit.h"
+
+#define KA_ACTIVE		0
+#define KA_LOOPED		1
+#define KA_DROPPED		2 //jump cannot be calculated (same x as jump point), kangaroo is not checked
+
+struct TAuditThrData
+{
+	TKangAudit* audit;
+	TKangState* kangs;
+	int cnt;
+	u32* loops;
+	u64 short_loops;
+	int res;
+};
+
+//signed 192bit distance
+static void AddDist(u64* d, EcInt& dist, bool sub)
+{
+	EcInt t;
+	t.data[0] = d[0];
+	t.data[1] = d[1];
+	t.data[2] = d[2];
+	t.data[3] = t.data[4] = (d[2] >> 63) ? 0xFFFFFFFFFFFFFFFFull : 0;
+	if (sub)
+		t.Sub(dist);
+	else
+		t.Add(dist);
+	memcpy(d, t.data, 24);
+}
+
+static bool IsSameState(TKangState* s1, TKangState* s2)
+{
+	return !memcmp(s1->x, s2->x, 32) && ((s1->y[0] & 1) == (s2->y[0] & 1)) && (s1->flags == s2->flags);
+}
+
+TKangAudit::TKangAudit()
+{
+	interval_ms = 0;
+	workers = NULL;
+	worker_cnt = 0;
+	memset(jumps, 0, sizeof(jumps));
+	last_tm = 0;
+	has_states = false;
+	thr_active = false;
+	running = false;
+	abort = false;
+	memset(&stats, 0, sizeof(stats));
+}
+
+void TKangAudit::SetInterval(int minutes)
+{
+	interval_ms = (u64)minutes * 60 * 1000;
+}
+
+void TKangAudit::Start(RCKangWorker** _workers, int _worker_cnt, EcJMP* EcJumps1, EcJMP* EcJumps2, EcJMP* EcJumps3)
+{
+	workers = _workers;
+	worker_cnt = _worker_cnt;
+	jumps[0] = EcJumps1;
+	jumps[1] = EcJumps2;
+	jumps[2] = EcJumps3;
+	last_tm = GetTickCount64();
+	abort = false;
+	cs.Enter();
+	memset(&stats, 0, sizeof(stats));
+	cs.Leave();
+	has_states = false;
+	for (int i = 0; i < worker_cnt; i++)
+		has_states = has_states || workers[i]->HasKangStates();
+	if (interval_ms && !has_states)
+		printf("AUDIT: workers don't have kangaroo states, audit is skipped\r\n");
+}
+
+THR_PROC(audit_thr_proc)
+{
+	((TKangAudit*)data)->Run();
+	return 0;
+}
+
+void TKangAudit::Check()
+{
+	if (!interval_ms || !has_states || running)
+		return;
+	if (thr_active)
+	{
+		WaitThread(thr);
+		thr_active = false;
+	}
+	if (GetTickCount64() - last_tm < interval_ms)
+		return;
+	last_tm = GetTickCount64();
+	running = true;
+	thr_active = StartThread(&thr, audit_thr_proc, this);
+	if (!thr_active)
+	{
+		running = false;
+		printf("AUDIT: cannot start thread\r\n");
+	}
+}
+
+void TKangAudit::Stop()
+{
+	abort = true;
+	if (thr_active)
+		WaitThread(thr);
+	thr_active = false;
+	running = false;
+}
+
+void TKangAudit::GetStats(TKangAuditStats* st)
+{
+	cs.Enter();
+	*st = stats;
+	cs.Leave();
+}
+
+//one jump for every kangaroo in list, same formulas as KernelA (or KernelC if escape is set), inversions are batched like in MultiplyG_Batch
+void TKangAudit::Jump(TKangState* kangs, int* inds, int cnt, EcInt* dx, EcInt* acc, u8* state, bool escape)
+{
+	int add_cnt = 0;
+	for (int i = 0; i < cnt; i++)
+	{
+		TKangState* k = &kangs[inds[i]];
+		EcJMP* tbl = escape ? jumps[2] : ((k->flags & KS_JMP2) ? jumps[1] : jumps[0]);
+		EcInt d;
+		memcpy(d.data, k->x, 32);
+		d.data[4] = 0;
+		d.SubModP(tbl[k->x[0] % JMP_CNT].p.x);
+		if (d.IsZero())
+		{
+			state[inds[i]] = KA_DROPPED;
+			continue;
+		}
+		dx[add_cnt] = d;
+		acc[add_cnt] = (add_cnt) ? acc[add_cnt - 1] : d;
+		if (add_cnt)
+			acc[add_cnt].MulModP(d);
+		inds[add_cnt++] = inds[i];
+	}
+	if (!add_cnt)
+		return;
+	EcInt inv = acc[add_cnt - 1];
+	inv.InvModP();
+	for (int a = add_cnt - 1; a >= 0; a--)
+	{
+		EcInt dx_inv = inv;
+		if (a)
+		{
+			dx_inv.MulModP(acc[a - 1]);
+			inv.MulModP(dx[a]);
+		}
+		TKangState* k = &kangs[inds[a]];
+		u32 jmp_ind = k->x[0] % JMP_CNT;
+		EcJMP* jmp = escape ? &jumps[2][jmp_ind] : ((k->flags & KS_JMP2) ? &jumps[1][jmp_ind] : &jumps[0][jmp_ind]);
+		bool inv_flag = (k->y[0] & 1) != 0;
+		EcPoint p;
+		memcpy(p.x.data, k->x, 32);
+		memcpy(p.y.data, k->y, 32);
+		p.x.data[4] = p.y.data[4] = 0;
+		EcInt jy = jmp->p.y;
+		if (inv_flag)
+			jy.NegModP();
+		EcInt lambda = p.y;
+		lambda.SubModP(jy);
+		lambda.MulModP(dx_inv);
+		EcInt x = lambda;
+		x.MulModP(lambda);
+		x.SubModP(jmp->p.x);
+		x.SubModP(p.x);
+		EcInt y = p.x;
+		y.SubModP(x);
+		y.MulModP(lambda);
+		y.SubModP(p.y);
+		memcpy(k->x, x.data, 32);
+		memcpy(k->y, y.data, 32);
+		AddDist(k->d, jmp->dist, inv_flag);
+
+		if (escape || (k->flags & KS_JMP2))
+			k->flags &= ~KS_JMP2;
+		else
+		{
+			//L1S2 loop: next jump is the same jump back
+			u32 jmp_cur = jmp_ind | (inv_flag ? INV_FLAG : 0);
+			u32 jmp_next = (k->x[0] % JMP_CNT) | ((k->y[0] & 1) ? 0 : INV_FLAG);
+			if (jmp_cur == jmp_next)
+				k->flags |= KS_JMP2;
+		}
+	}
+}
+
+//Brent's method for every kangaroo, all kangaroos jump together to batch inversions
+int TKangAudit::WalkKangs(TKangState* kangs, int cnt, u32* loops, u64* short_loops)
+{
+	TKangState* tort = (TKangState*)malloc(cnt * sizeof(TKangState));
+	u32* power = (u32*)malloc(cnt * sizeof(u32));
+	u32* lam = (u32*)malloc(cnt * sizeof(u32));
+	u8* state = (u8*)malloc(cnt);
+	int* inds = (int*)malloc(cnt * sizeof(int));
+	int* esc_inds = (int*)malloc(cnt * sizeof(int));
+	EcInt* dx = (EcInt*)malloc(cnt * sizeof(EcInt));
+	EcInt* acc = (EcInt*)malloc(cnt * sizeof(EcInt));
+	memcpy(tort, kangs, cnt * sizeof(TKangState));
+	memset(state, KA_ACTIVE, cnt);
+	memset(loops, 0, cnt * sizeof(u32));
+	for (int i = 0; i < cnt; i++)
+	{
+		power[i] = 1;
+		lam[i] = 0;
+	}
+	int res = 0;
+	for (int step = 0; step < AUDIT_STEPS; step++)
+	{
+		int act_cnt = 0;
+		for (int i = 0; i < cnt; i++)
+			if (state[i] == KA_ACTIVE)
+				inds[act_cnt++] = i;
+		if (!act_cnt)
+			break;
+		Jump(kangs, inds, act_cnt, dx, acc, state, false);
+		int esc_cnt = 0;
+		for (int i = 0; i < cnt; i++)
+		{
+			if (state[i] != KA_ACTIVE)
+				continue;
+			lam[i]++;
+			if (IsSameState(&kangs[i], &tort[i]))
+			{
+				if (lam[i] > MD_LEN)
+				{
+					state[i] = KA_LOOPED;
+					loops[i] = lam[i];
+					res++;
+				}
+				else
+					(*short_loops)++;
+				esc_inds[esc_cnt++] = i;
+				continue;
+			}
+			if (lam[i] == power[i])
+			{
+				tort[i] = kangs[i];
+				power[i] *= 2;
+				lam[i] = 0;
+			}
+		}
+		//gpu escapes short loops itself, walk continues after escape like on gpu
+		if (esc_cnt)
+			Jump(kangs, esc_inds, esc_cnt, dx, acc, state, true);
+		for (int i = 0; i < esc_cnt; i++)
+		{
+			int k = esc_inds[i];
+			tort[k] = kangs[k];
+			power[k] = 1;
+			lam[k] = 0;
+		}
+	}
+	//escape can fail too, rare case, such kangaroo is not fixed
+	for (int i = 0; i < cnt; i++)
+		if (loops[i] && (state[i] == KA_DROPPED))
+		{
+			loops[i] = 0;
+			res--;
+		}
+	free(tort);
+	free(power);
+	free(lam);
+	free(state);
+	free(inds);
+	free(esc_inds);
+	free(dx);
+	free(acc);
+	return res;
+}
+
+THR_PROC(audit_walk_thr_proc)
+{
+	TAuditThrData* td = (TAuditThrData*)data;
+	td->res = td->audit->WalkKangs(td->kangs, td->cnt, td->loops, &td->short_loops);
+	return 0;
+}
+
+int TKangAudit::CheckKangs(TKangState* kangs, int cnt, u32* loops, u64* short_loops)
+{
+	HHANDLER thrs[AUDIT_THR_CNT];
+	TAuditThrData td[AUDIT_THR_CNT];
+	bool started[AUDIT_THR_CNT];
+	int per_thr = (cnt + AUDIT_THR_CNT - 1) / AUDIT_THR_CNT;
+	for (int i = 0; i < AUDIT_THR_CNT; i++)
+	{
+		int first = i * per_thr;
+		td[i].audit = this;
+		td[i].kangs = kangs + first;
+		td[i].loops = loops + first;
+		td[i].cnt = (first < cnt) ? ((cnt - first < per_thr) ? cnt - first : per_thr) : 0;
+		td[i].short_loops = 0;
+		td[i].res = 0;
+		started[i] = td[i].cnt && StartThread(&thrs[i], audit_walk_thr_proc, &td[i]);
+		if (!started[i] && td[i].cnt)
+			audit_walk_thr_proc(&td[i]);
+	}
+	int res = 0;
+	for (int i = 0; i < AUDIT_THR_CNT; i++)
+	{
+		if (started[i])
+			WaitThread(thrs[i]);
+		res += td[i].res;
+		*short_loops += td[i].short_loops;
+	}
+	return res;
+}
+
+void TKangAudit::Run()
+{
+	u64 tm = GetTickCount64();
+	TKangState* buf = (TKangState*)malloc(AUDIT_CHUNK * sizeof(TKangState));
+	u32* loops = (u32*)malloc(AUDIT_CHUNK * sizeof(u32));
+	u64 checked = 0;
+	u64 short_loops = 0;
+	u64 looped = 0;
+	u32 max_loop = 0;
+	for (int w = 0; (w < worker_cnt) && !abort; w++)
+	{
+		RCKangWorker* worker = workers[w];
+		if (!worker->HasKangStates())
+			continue;
+		for (u32 first = 0; (first < (u32)worker->KangCnt) && !abort; first += AUDIT_CHUNK)
+		{
+			u32 cnt = ((u32)worker->KangCnt - first < AUDIT_CHUNK) ? (u32)worker->KangCnt - first : AUDIT_CHUNK;
+			if (!worker->GetKangStates(first, cnt, buf, &abort))
+			{
+				if (!abort)
+					printf("\r\nAUDIT: cannot get kangaroos of worker %d\r\n", worker->CudaIndex);
+				break;
+			}
+			checked += cnt;
+			if (!CheckKangs(buf, cnt, loops, &short_loops))
+				continue;
+			for (u32 i = 0; i < cnt; i++)
+				if (loops[i])
+				{
+					worker->AddKangFix(first + i, &buf[i]);
+					looped++;
+					if (loops[i] > max_loop)
+						max_loop = loops[i];
+				}
+		}
+	}
+	free(buf);
+	free(loops);
+	if (!abort)
+	{
+		tm = GetTickCount64() - tm;
+		cs.Enter();
+		stats.runs++;
+		stats.checked = checked;
+		stats.short_loops = short_loops;
+		stats.looped = looped;
+		stats.looped_total += looped;
+		if (max_loop > stats.max_loop)
+			stats.max_loop = max_loop;
+		stats.last_ms = tm;
+		cs.Leave();
+		printf("\r\nAUDIT: %llu kangaroos checked in %llu sec, short loops: %llu, kangaroos in long loops: %llu", checked, tm / 1000, short_loops, looped);
+		if (looped)
+			printf(" (max loop size %u), they are escaped", max_loop);
+		printf("\r\n");
+	}
+	running = false;
+}
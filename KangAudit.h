@@ -0,0 +1,67 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+#include "Ec.h"
+#include "KangWorker.h"
+
+//gpu kernels escape loops up to MD_LEN only, longer loops (L1S12 and more) trap kangaroos forever
+//audit runs in its own thread every few minutes/hours: it takes states of all kangaroos from workers part by part,
+//walks every kangaroo on CPU by the same rules as KernelA (jump tables 1 and 2, L1S2 flag) and detects cycles by Brent's method.
+//Short loops are escaped like KernelC does and walk continues, kangaroos in loops longer than MD_LEN are escaped by jump table 3
+//and new states are sent back to worker. Kangaroo in a loop never leaves it, so state can be written some kernel calls later.
+
+#define AUDIT_MAX_LOOP		64 //longer loops are too rare
+#define AUDIT_STEPS			(3 * AUDIT_MAX_LOOP) //enough for Brent's method to find any loop up to AUDIT_MAX_LOOP
+#define AUDIT_CHUNK			(64 * 1024) //kangaroos per request to worker
+#define AUDIT_THR_CNT		8
+
+struct TKangAuditStats
+{
+	u32 runs; //finished audits for current point
+	u64 checked; //kangaroos in last audit
+	u64 short_loops; //loops up to MD_LEN in last audit, gpu escapes them itself
+	u64 looped; //kangaroos in long loops in last audit
+	u64 looped_total; //for current point
+	u32 max_loop; //for current point
+	u64 last_ms; //duration of last audit
+};
+
+class TKangAudit
+{
+private:
+	u64 interval_ms; //0 - disabled
+	RCKangWorker** workers;
+	int worker_cnt;
+	EcJMP* jumps[3];
+	u64 last_tm;
+	bool has_states; //false if no worker can give kangaroo states
+	HHANDLER thr;
+	bool thr_active;
+	volatile bool running;
+	volatile bool abort;
+	CriticalSection cs;
+	TKangAuditStats stats;
+	void Jump(TKangState* kangs, int* inds, int cnt, EcInt* dx, EcInt* acc, u8* state, bool escape);
+public:
+	TKangAudit();
+	void SetInterval(int minutes);
+	bool IsEnabled() { return interval_ms != 0; }
+	//for every point, after workers are started
+	void Start(RCKangWorker** _workers, int _worker_cnt, EcJMP* EcJumps1, EcJMP* EcJumps2, EcJMP* EcJumps3);
+	//executes in main thread, starts audit if it's time
+	void Check();
+	//must be called before workers are stopped
+	void Stop();
+	//walks kangaroos on CPU, kangaroos in long loops are escaped in place and their loop sizes are set, 0 for others
+	//returns number of looped kangaroos
+	int CheckKangs(TKangState* kangs, int cnt, u32* loops, u64* short_loops);
+	int WalkKangs(TKangState* kangs, int cnt, u32* loops, u64* short_loops); //same in current thread
+	void Run(); //audit thread
+	void GetStats(TKangAuditStats* st);
+};
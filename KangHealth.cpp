@@ -0,0 +1,208 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include "KangHealth.h"
+
+TKangHealth::TKangHealth()
+{
+	memset(workers, 0, sizeof(workers));
+	worker_cnt = 0;
+	unknown_dps = 0;
+}
+
+TKangHealth::~TKangHealth()
+{
+	Release();
+}
+
+void TKangHealth::Release()
+{
+	for (int i = 0; i < MAX_GPU_CNT; i++)
+	{
+		free(workers[i].last);
+		free(workers[i].cnt);
+		free(workers[i].state);
+	}
+	memset(workers, 0, sizeof(workers));
+	worker_cnt = 0;
+}
+
+bool TKangHealth::Init(int _worker_cnt, int* kang_cnts)
+{
+	worker_cnt = _worker_cnt;
+	unknown_dps = 0;
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		TWorkerHealth* wh = &workers[i];
+		u32 cnt = kang_cnts[i];
+		if (cnt > wh->capacity)
+		{
+			free(wh->last);
+			free(wh->cnt);
+			free(wh->state);
+			wh->last = (u32*)malloc(cnt * sizeof(u32));
+			wh->cnt = (u32*)malloc(cnt * sizeof(u32));
+			wh->state = (u8*)malloc(cnt);
+			wh->capacity = cnt;
+			if (!wh->last || !wh->cnt || !wh->state)
+			{
+				Release();
+				return false;
+			}
+		}
+		wh->kang_cnt = cnt;
+		wh->dps = 0;
+		wh->stalled = 0;
+		wh->merged = 0;
+		wh->stalled_total = 0;
+		wh->reseeded = 0;
+		if (cnt)
+		{
+			memset(wh->last, 0, cnt * sizeof(u32));
+			memset(wh->cnt, 0, cnt * sizeof(u32));
+			memset(wh->state, 0, cnt);
+		}
+	}
+	return true;
+}
+
+bool TKangHealth::GetKang(u32 id, TWorkerHealth** wh, u32* kang)
+{
+	if (id == DP_KANG_UNKNOWN)
+		return false;
+	int worker = id >> DP_KANG_BITS;
+	*kang = id & ((1 << DP_KANG_BITS) - 1);
+	if ((worker >= worker_cnt) || (*kang >= workers[worker].kang_cnt))
+		return false;
+	*wh = &workers[worker];
+	return true;
+}
+
+void TKangHealth::AddDP(u32 id)
+{
+	TWorkerHealth* wh;
+	u32 kang;
+	if (!GetKang(id, &wh, &kang))
+	{
+		unknown_dps++;
+		return;
+	}
+	wh->dps++;
+	wh->cnt[kang]++;
+	wh->last[kang] = (u32)(wh->dps * KH_SCALE / wh->kang_cnt);
+	if (wh->state[kang] == KH_STALLED)
+	{
+		wh->state[kang] = KH_OK;
+		wh->stalled--;
+	}
+}
+
+bool TKangHealth::SetMerged(u32 id)
+{
+	TWorkerHealth* wh;
+	u32 kang;
+	if (!GetKang(id, &wh, &kang) || (wh->state[kang] == KH_MERGED))
+		return false;
+	if (wh->state[kang] == KH_STALLED)
+		wh->stalled--;
+	wh->state[kang] = KH_MERGED;
+	wh->merged++;
+	return true;
+}
+
+u64 TKangHealth::CheckStalled(std::vector <u32>* ids)
+{
+	u64 res = 0;
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		TWorkerHealth* wh = &workers[i];
+		if (!wh->kang_cnt)
+			continue;
+		u32 cur = (u32)(wh->dps * KH_SCALE / wh->kang_cnt);
+		if (cur < KH_STALL_DPS * KH_SCALE)
+			continue;
+		u32 max_last = cur - KH_STALL_DPS * KH_SCALE;
+		for (u32 k = 0; k < wh->kang_cnt; k++)
+			if ((wh->state[k] == KH_OK) && (wh->last[k] < max_last))
+			{
+				wh->state[k] = KH_STALLED;
+				wh->stalled++;
+				wh->stalled_total++;
+				res++;
+				if (ids)
+					ids->push_back(k | (i << DP_KANG_BITS));
+			}
+	}
+	return res;
+}
+
+u8 TKangHealth::GetState(int worker, u32 kang)
+{
+	if ((worker >= worker_cnt) || (kang >= workers[worker].kang_cnt))
+		return KH_OK;
+	return workers[worker].state[kang];
+}
+
+//kangaroo starts again, so it's like it sent DP now
+void TKangHealth::ResetKang(int worker, u32 kang)
+{
+	if ((worker >= worker_cnt) || (kang >= workers[worker].kang_cnt))
+		return;
+	TWorkerHealth* wh = &workers[worker];
+	if (wh->state[kang] == KH_STALLED)
+		wh->stalled--;
+	if (wh->state[kang] == KH_MERGED)
+		wh->merged--;
+	wh->state[kang] = KH_OK;
+	wh->last[kang] = (u32)(wh->dps * KH_SCALE / wh->kang_cnt);
+	wh->reseeded++;
+}
+
+void TKangHealth::GetStats(TKangHealthStats* st)
+{
+	memset(st, 0, sizeof(TKangHealthStats));
+	st->unknown_dps = unknown_dps;
+	double sum_sq_dev = 0.0;
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		TWorkerHealth* wh = &workers[i];
+		if (!wh->kang_cnt)
+			continue;
+		double mean = (double)wh->dps / wh->kang_cnt;
+		for (u32 k = 0; k < wh->kang_cnt; k++)
+		{
+			u32 cnt = wh->cnt[k];
+			if (!cnt)
+				st->zero_kangs++;
+			if (cnt > st->max_dps)
+				st->max_dps = cnt;
+			sum_sq_dev += (cnt - mean) * (cnt - mean);
+		}
+		st->kangs += wh->kang_cnt;
+		st->dps += wh->dps;
+		st->exp_zero_kangs += wh->kang_cnt * exp(-mean);
+		st->stalled += wh->stalled;
+		st->merged += wh->merged;
+		st->stalled_total += wh->stalled_total;
+		st->reseeded += wh->reseeded;
+	}
+	if (st->kangs)
+		st->exp_dps = (double)st->dps / st->kangs;
+	if (st->exp_dps > 0)
+		st->dispersion = sum_sq_dev / st->kangs / st->exp_dps;
+}
+
+void TKangHealth::PrintStats()
+{
+	TKangHealthStats st;
+	GetStats(&st);
+	if (!st.kangs)
+		return;
+	printf("Kangaroos: %llu, DPs per kangaroo: %.2f (max %u), without DPs: %llu (expected %.0f), dispersion: %.2f\r\n",
+		st.kangs, st.exp_dps, st.max_dps, st.zero_kangs, st.exp_zero_kangs, st.dispersion);
+	if (st.stalled || st.merged || st.stalled_total || st.reseeded)
+		printf("Kangaroos stalled: %llu (%llu for point), merged: %llu, re-seeded: %llu\r\n", st.stalled, st.stalled_total, st.merged, st.reseeded);
+}
@@ -0,0 +1,76 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+
+//per-kangaroo DP arrival table, kangaroo is identified by worker index and kang index from DP record
+//all kangaroos of a worker jump at the same rate, so DPs of every kangaroo are a Poisson process with the same rate:
+//- stalled: no DPs for KH_STALL_DPS expected DPs (trapped in a loop longer than MD_LEN or broken), chance for healthy kangaroo is exp(-KH_STALL_DPS)
+//- merged: DP is already in DB with same kind (and same distance for wilds), so kangaroo walks the path of other kangaroo
+//executes in main thread only
+
+#define KH_STALL_DPS		20
+#define KH_SCALE			16 //"last" values are in 1/KH_SCALE of expected DPs per kangaroo
+
+#define KH_OK				0
+#define KH_STALLED			1
+#define KH_MERGED			2
+
+struct TKangHealthStats
+{
+	u64 kangs;
+	u64 dps; //with known kangaroo
+	u64 unknown_dps;
+	double exp_dps; //per kangaroo
+	u64 zero_kangs; //kangaroos without DPs
+	double exp_zero_kangs;
+	u32 max_dps; //per kangaroo
+	double dispersion; //variance / mean of DPs per kangaroo, about 1 for healthy herd
+	u64 stalled; //now
+	u64 merged; //now
+	u64 stalled_total; //for current point, including recovered
+	u64 reseeded; //for current point
+};
+
+class TKangHealth
+{
+private:
+	struct TWorkerHealth
+	{
+		u32 kang_cnt;
+		u32 capacity;
+		u64 dps;
+		u32* last; //DPs of worker when kangaroo sent last DP, in 1/KH_SCALE expected DPs per kangaroo
+		u32* cnt;
+		u8* state;
+		u64 stalled;
+		u64 merged;
+		u64 stalled_total;
+		u64 reseeded;
+	};
+	TWorkerHealth workers[MAX_GPU_CNT];
+	int worker_cnt;
+	u64 unknown_dps;
+	bool GetKang(u32 id, TWorkerHealth** wh, u32* kang);
+public:
+	TKangHealth();
+	~TKangHealth();
+	//for every point, buffers are kept if kangaroos count is the same
+	bool Init(int _worker_cnt, int* kang_cnts);
+	void Release();
+	void AddDP(u32 id);
+	//returns true if kangaroo is merged now
+	bool SetMerged(u32 id);
+	//returns number of new stalled kangaroos, their ids are added to list if it's set
+	u64 CheckStalled(std::vector <u32>* ids = NULL);
+	u8 GetState(int worker, u32 kang);
+	//clears kangaroo state and statistics, for re-seeded kangaroos
+	void ResetKang(int worker, u32 kang);
+	void GetStats(TKangHealthStats* st);
+	void PrintStats();
+};
@@ -0,0 +1,196 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include "Ec.h"
+
+#define STATS_WND_SIZE	16
+
+struct EcJMP
+{
+	EcPoint p;
+	EcInt dist;
+};
+
+#define KS_JMP2			1 //next jump uses second jump table, like L1S2 flag in gpu code
+
+//kangaroo state for audit, same layout as gpu kangaroo record: x, y, distance (signed 192bit), flags
+struct TKangState
+{
+	u64 x[4];
+	u64 y[4];
+	u64 d[3];
+	u64 flags;
+};
+
+struct TKangFix
+{
+	u32 kang;
+	TKangState st;
+};
+
+//solver side of workers: DPs and errors of workers are sent here
+class TWorkerHost
+{
+public:
+	virtual void AddPoints(u32* data, int cnt, u64 ops_cnt) = 0; //ops are added after DPs are published
+	virtual void AddError() = 0;
+};
+
+//base class for DP producers, every worker runs Execute in its own thread and sends DPs to Host
+//worker is a session: buffers allocated by first Prepare are kept after Execute and reused by next points,
+//Prepare only resets targets, start positions and counters; Release frees everything, next Prepare allocates again
+class RCKangWorker
+{
+protected:
+	//kangaroos to restart from new random positions, main thread adds them, worker restarts them between kernel calls
+	CriticalSection reseed_cs;
+	std::vector <u32> reseed_list;
+	//returns false if there are no kangaroos to restart
+	bool PopReseed(std::vector <u32>* list)
+	{
+		reseed_cs.Enter();
+		list->swap(reseed_list);
+		reseed_list.clear();
+		reseed_cs.Leave();
+		return !list->empty();
+	}
+	//kangaroo states for audit and checkpoint threads: they request a range and wait, worker reads states between kernel calls
+	//fixed states from audit and restored states from checkpoint are written by worker too, before re-seeded kangaroos
+	CriticalSection state_cs;
+	CriticalSection state_user_cs; //one request at a time
+	volatile int state_req; //0 - no request, 1 - requested, 2 - done, 3 - failed
+	volatile bool state_closed; //worker thread is not running, requests fail
+	u32 state_first;
+	u32 state_cnt;
+	TKangState* state_buf;
+	std::vector <TKangFix> fix_list;
+	virtual bool ReadKangs(u32 first, u32 cnt, TKangState* buf) { return false; }
+	virtual bool WriteKangs(std::vector <TKangFix>& list) { return false; }
+	//returns false if states cannot be written
+	bool ServeStates()
+	{
+		std::vector <TKangFix> fixes;
+		state_cs.Enter();
+		if (state_req == 1)
+			state_req = ReadKangs(state_first, state_cnt, state_buf) ? 2 : 3;
+		fixes.swap(fix_list);
+		state_cs.Leave();
+		return fixes.empty() || WriteKangs(fixes);
+	}
+public:
+	int CudaIndex; //worker index for messages, gpu index in cuda for gpu workers
+	int WorkerInd; //index in workers list, it's stored in DP records to identify kangaroos
+	int KangCnt;
+	//set by solver before Prepare
+	TWorkerHost* Host;
+	u64 Seed; //every worker has its own generator for start positions, it's seeded by Seed and worker index
+	bool GenMode; //tames generation mode
+	bool WildRestart; //restart wild kangs after DP
+	THerd Herd;
+	u32 TameCnt; //by Herd, set in Prepare by CalcHerd
+	u32 Wild1Cnt;
+	bool Failed;
+	u32 dbg[256];
+	//for metrics, they are not cleared between points
+	std::atomic<u64> DPsCnt;
+	std::atomic<u64> OverflowCnt;
+	std::atomic<u64> ReseedCnt; //restarted kangaroos, for current point
+	std::atomic<u64> RestartCnt; //wild kangaroos restarted after DP (-wildrestart), for current point
+
+	RCKangWorker() { Host = NULL; Seed = 0; GenMode = WildRestart = false; DPsCnt = 0; OverflowCnt = 0; ReseedCnt = 0; RestartCnt = 0; state_req = 0; state_closed = true; Herd.tame = Herd.wild1 = Herd.wild2 = 1; TameCnt = Wild1Cnt = 0; }
+	virtual ~RCKangWorker() {}
+	virtual int CalcKangCnt() = 0;
+	virtual bool Prepare(EcPoint* _PntsToSolve, int _PntCnt, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3) = 0;
+	virtual void Stop() = 0;
+	virtual void Execute() = 0;
+	virtual void Release() {}
+	void CalcHerd()
+	{
+		u64 sum = (u64)Herd.tame + Herd.wild1 + Herd.wild2;
+		TameCnt = (u32)((u64)KangCnt * Herd.tame / sum);
+		Wild1Cnt = (u32)((u64)KangCnt * (Herd.tame + Herd.wild1) / sum) - TameCnt;
+	}
+	int GetKangType(u32 kang_ind)
+	{
+		if (kang_ind < TameCnt)
+			return TAME;
+		return (kang_ind < TameCnt + Wild1Cnt) ? WILD1 : WILD2;
+	}
+	void ClearReseed()
+	{
+		reseed_cs.Enter();
+		reseed_list.clear();
+		reseed_cs.Leave();
+		state_cs.Enter();
+		fix_list.clear();
+		state_cs.Leave();
+		ReseedCnt = 0;
+		RestartCnt = 0;
+	}
+	void AddReseed(u32 kang)
+	{
+		reseed_cs.Enter();
+		reseed_list.push_back(kang);
+		reseed_cs.Leave();
+	}
+	//true if worker runs real kangaroos and can give their states for audit
+	virtual bool HasKangStates() { return false; }
+	//executes in audit or checkpoint thread, waits until worker reads states or abort is set
+	bool GetKangStates(u32 first, u32 cnt, TKangState* buf, volatile bool* abort)
+	{
+		state_user_cs.Enter();
+		state_cs.Enter();
+		if (state_closed)
+		{
+			state_cs.Leave();
+			state_user_cs.Leave();
+			return false;
+		}
+		state_first = first;
+		state_cnt = cnt;
+		state_buf = buf;
+		state_req = 1;
+		state_cs.Leave();
+		while ((state_req == 1) && !*abort)
+			Sleep(10);
+		state_cs.Enter();
+		bool res = (state_req == 2);
+		state_req = 0;
+		state_cs.Leave();
+		state_user_cs.Leave();
+		return res;
+	}
+	//worker thread calls Execute between them
+	void OpenStates()
+	{
+		state_cs.Enter();
+		state_closed = false;
+		state_cs.Leave();
+	}
+	void CloseStates()
+	{
+		state_cs.Enter();
+		state_closed = true;
+		if (state_req == 1)
+			state_req = 3;
+		state_cs.Leave();
+	}
+	void AddKangFix(u32 kang, TKangState* st)
+	{
+		TKangFix fix;
+		fix.kang = kang;
+		fix.st = *st;
+		state_cs.Enter();
+		fix_list.push_back(fix);
+		state_cs.Leave();
+	}
+	virtual int GetStatsSpeed() = 0;
+	virtual const char* GetKind() = 0; //for metrics
+};
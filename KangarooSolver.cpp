@@ -0,0 +1,1239 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <math.h>
+#include "KangarooSolver.h"
+#include "TamesFile.h"
+#include "DPPlanner.h"
+#include "Metrics.h"
+
+TKangarooSolver::TKangarooSolver()
+{
+	worker_cnt = 0;
+	dp_server = NULL;
+	db = NULL;
+	pPntList = NULL;
+	PntCnt = 0;
+	Range = 0;
+	DP = 0;
+	Solved = false;
+	StopReq = false;
+	start_time = time(NULL);
+	last_stall_cnt = 0;
+	TamesThrActive = false;
+	TamesLoading = false;
+	memset(&Config, 0, sizeof(Config));
+	Config.Herd.tame = Config.Herd.wild1 = Config.Herd.wild2 = 1;
+	memset(&Callbacks, 0, sizeof(Callbacks));
+	PntTotalOps = 0;
+	PntTotalDPs = 0;
+	PntSolveMs = 0;
+	IsOpsLimit = false;
+	WildRelCnt = 0;
+	TotalDPs = 0;
+	TotalPntSolved = 0;
+	TotalErrors = 0;
+}
+
+TKangarooSolver::~TKangarooSolver()
+{
+	Release();
+}
+
+bool TKangarooSolver::Init(RCKangWorker** _workers, int _worker_cnt, RCDPServer* _dp_server)
+{
+	worker_cnt = _worker_cnt;
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		workers[i] = _workers[i];
+		workers[i]->Host = this;
+	}
+	dp_server = _dp_server;
+	start_time = time(NULL);
+	db = new TFastBase();
+	pPntList = (u8*)malloc(MAX_CNT_LIST * GPU_DP_SIZE);
+	if (!pPntList || !DPRing.Init(MAX_CNT_LIST))
+	{
+		printf("DP queue init failed\r\n");
+		return false;
+	}
+	return true;
+}
+
+void TKangarooSolver::Release()
+{
+	DPRing.Release();
+	free(pPntList);
+	pPntList = NULL;
+	delete db;
+	db = NULL;
+	worker_cnt = 0;
+}
+
+//ops are added after DPs are published, so ops read before Pop never count DPs that are not popped yet
+void TKangarooSolver::AddPoints(u32* data, int cnt, u64 ops_cnt)
+{
+	DPRing.Push((u8*)data, cnt);
+	PntTotalOps += ops_cnt;
+}
+
+void TKangarooSolver::AddError()
+{
+	TotalErrors++;
+}
+
+bool TKangarooSolver::Collision_SOTA(EcPoint& pnt, EcInt t, int TameType, EcInt w, int WildType, bool IsNeg, EcInt* pk)
+{
+	if (IsNeg)
+		t.Neg();
+	if (TameType == TAME)
+	{
+		*pk = t;
+		pk->Sub(w);
+		EcInt sv = *pk;
+		pk->Add(Int_HalfRange);
+		EcPoint P = ec.MultiplyG(*pk);
+		if (P.IsEqual(pnt))
+			return true;
+		*pk = sv;
+		pk->Neg();
+		pk->Add(Int_HalfRange);
+		P = ec.MultiplyG(*pk);
+		return P.IsEqual(pnt);
+	}
+	else
+	{
+		*pk = t;
+		pk->Sub(w);
+		if (pk->data[4] >> 63)
+			pk->Neg();
+		pk->ShiftRight(1);
+		EcInt sv = *pk;
+		pk->Add(Int_HalfRange);
+		EcPoint P = ec.MultiplyG(*pk);
+		if (P.IsEqual(pnt))
+			return true;
+		*pk = sv;
+		pk->Neg();
+		pk->Add(Int_HalfRange);
+		P = ec.MultiplyG(*pk);
+		return P.IsEqual(pnt);
+	}
+}
+
+//executes in collision pool threads
+bool TKangarooSolver::VerifyCollision(TCollCand* cand, EcInt* pk)
+{
+	EcPoint& pnt = PntsToSolve[cand->target];
+	return Collision_SOTA(pnt, cand->t, cand->TameType, cand->w, cand->WildType, false, pk) || Collision_SOTA(pnt, cand->t, cand->TameType, cand->w, cand->WildType, true, pk);
+}
+
+bool verify_coll_proc(void* ctx, TCollCand* cand, EcInt* pk)
+{
+	return ((TKangarooSolver*)ctx)->VerifyCollision(cand, pk);
+}
+
+//distance is stored in 22 bytes, restore sign
+void GetDPDist(u8* d, EcInt* dist)
+{
+	dist->SetZero();
+	memcpy(dist->data, d, 22);
+	if (d[21] == 0xFF)
+		memset(((u8*)dist->data) + 22, 0xFF, 18);
+}
+
+//key is checked for all signs, wrong ones just don't give the point
+bool TKangarooSolver::SolveByWildRel(TWildRel* rel, int solved_target, EcInt& key, EcInt* res)
+{
+	int other = (rel->target1 == solved_target) ? rel->target2 : rel->target1;
+	EcInt& dist_solved = (rel->target1 == solved_target) ? rel->dist1 : rel->dist2;
+	EcInt& dist_other = (rel->target1 == solved_target) ? rel->dist2 : rel->dist1;
+	EcInt a = key;
+	a.Sub(Int_HalfRange);
+	for (int i = 0; i < 8; i++)
+	{
+		EcInt k = a;
+		if (i & 1)
+			k.Neg();
+		EcInt t = dist_solved;
+		if (i & 2)
+			t.Neg();
+		k.Add(t);
+		t = dist_other;
+		if (i & 4)
+			t.Neg();
+		k.Add(t);
+		k.Add(Int_HalfRange);
+		if (k.data[4] || k.IsZero()) //negative or too large
+			continue;
+		EcPoint P = ec.MultiplyG(k);
+		if (P.IsEqual(PntsToSolve[other]))
+		{
+			*res = k;
+			return true;
+		}
+	}
+	return false;
+}
+
+//found keys are added to collision pool results, so they are reported like other keys
+void TKangarooSolver::CheckWildRels(bool* solved, EcInt* pk_res)
+{
+	for (size_t i = 0; i < WildRels.size(); )
+	{
+		TWildRel* rel = &WildRels[i];
+		bool s1 = solved[rel->target1];
+		bool s2 = solved[rel->target2];
+		if (!s1 && !s2)
+		{
+			i++;
+			continue;
+		}
+		if (s1 != s2)
+		{
+			int solved_target = s1 ? rel->target1 : rel->target2;
+			int other = s1 ? rel->target2 : rel->target1;
+			EcInt key;
+			if (SolveByWildRel(rel, solved_target, pk_res[solved_target], &key))
+			{
+				printf("\r\nPoint %d is solved by relation to point %d\r\n", other, solved_target);
+				CollPool.AddResult(other, key);
+			}
+			else
+				printf("\r\nRelation of points %d and %d is wrong\r\n", rel->target1, rel->target2);
+		}
+		WildRels[i] = WildRels.back();
+		WildRels.pop_back();
+	}
+}
+
+//merged or stalled kangaroo is useless, worker restarts it from new random position
+void TKangarooSolver::ReseedKang(u32 kang_id)
+{
+	int worker = kang_id >> DP_KANG_BITS;
+	u32 kang = kang_id & ((1 << DP_KANG_BITS) - 1);
+	if ((worker >= worker_cnt) || workers[worker]->Failed)
+		return;
+	workers[worker]->AddReseed(kang);
+	KangHealth.ResetKang(worker, kang);
+}
+
+void TKangarooSolver::ProcessDPs(u8* list, int cnt)
+{
+	for (int i = 0; i < cnt; i++)
+	{
+		DBRec nrec;
+		u8* p = list + i * GPU_DP_SIZE;
+		memcpy(nrec.x, p, 12);
+		memcpy(nrec.d, p + 16, 22);
+		int kind = p[40];
+		int target = p[42];
+		u32 kang_id = *(u32*)(p + 44);
+		KangHealth.AddDP(kang_id);
+		if (Config.GenMode)
+			nrec.type = TAME;
+		else
+			if (kind == TAME)
+				nrec.type = TAME; //tames are shared by all targets
+			else
+			{
+				if (CollPool.IsSolved(target))
+					continue; //DPs of solved targets are useless
+				nrec.type = (u8)(kind | (target << 2));
+			}
+
+		if (Spill.IsActive())
+		{
+			Spill.Add(&nrec);
+			continue;
+		}
+		//DB and collisions are on DP server
+		if (DPClient.IsActive())
+		{
+			DPClient.Add(&nrec);
+			continue;
+		}
+		DBRec* pref = (DBRec*)db->FindOrAddDataBlock((u8*)&nrec);
+		if (Config.GenMode)
+		{
+			//tame is reached again, count it to select most useful tames when saving
+			if (pref)
+			{
+				u8* hits = (u8*)pref + DB_REC_LEN - 1;
+				if (*hits < TAMES_MAX_HITS)
+					(*hits)++;
+				if (KangHealth.SetMerged(kang_id))
+					ReseedKang(kang_id);
+			}
+			if (Journal.IsOpened())
+				Journal.Append(&nrec);
+			continue;
+		}
+		if (!pref && Journal.IsOpened())
+			Journal.Append(&nrec);
+		if (pref)
+		{
+			//in db we dont store first 3 bytes so restore them
+			DBRec tmp_pref;
+			memcpy(&tmp_pref, &nrec, 3);
+			memcpy(((u8*)&tmp_pref) + 3, pref, sizeof(DBRec) - 3);
+			pref = &tmp_pref;
+
+			int pref_kind = pref->type & 3;
+			int pref_target = pref->type >> 2;
+			if (pref_kind == TAME)
+			{
+				if (kind == TAME)
+				{
+					if (KangHealth.SetMerged(kang_id))
+						ReseedKang(kang_id);
+					continue;
+				}
+			}
+			else
+			{
+				//two wilds of different targets give relation of their keys, it's used when one of them is solved
+				if ((kind != TAME) && (pref_target != target))
+				{
+					if (CollPool.IsSolved(pref_target) && CollPool.IsSolved(target))
+						continue;
+					TWildRel rel;
+					rel.target1 = pref_target;
+					rel.target2 = target;
+					GetDPDist(pref->d, &rel.dist1);
+					GetDPDist(nrec.d, &rel.dist2);
+					WildRels.push_back(rel);
+					WildRelCnt++;
+					continue;
+				}
+				if (CollPool.IsSolved(pref_target))
+					continue;
+				//if it's wild, we can find the key from the same type if distances are different
+				if ((pref_kind == kind) && (*(u64*)pref->d == *(u64*)nrec.d))
+				{
+					if (KangHealth.SetMerged(kang_id))
+						ReseedKang(kang_id);
+					continue;
+				}
+				//else
+				//	ToLog("key found by same wild");
+			}
+
+			TCollCand cand;
+			if (pref_kind != TAME)
+			{
+				GetDPDist(pref->d, &cand.w);
+				GetDPDist(nrec.d, &cand.t);
+				cand.TameType = kind;
+				cand.WildType = pref_kind;
+				cand.target = pref_target;
+			}
+			else
+			{
+				GetDPDist(nrec.d, &cand.w);
+				GetDPDist(pref->d, &cand.t);
+				cand.TameType = TAME;
+				cand.WildType = kind;
+				cand.target = target;
+			}
+			cand.w12 = ((pref_kind == WILD1) && (kind == WILD2)) || ((pref_kind == WILD2) && (kind == WILD1));
+			CollPool.Add(&cand);
+		}
+	}
+}
+
+struct TTamesThrData
+{
+	TFastBase* db;
+	char* fn;
+	int Range;
+	volatile bool* loading;
+};
+
+THR_PROC(tames_thr_proc)
+{
+	TTamesThrData* td = (TTamesThrData*)data;
+	u64 tm = GetTickCount64();
+	if (td->db->LoadFromFile(td->fn))
+	{
+		if (td->db->Header[0] != td->Range)
+		{
+			printf("\r\nloaded tames have different range, they cannot be used, clear\r\n");
+			td->db->Clear();
+		}
+		else
+			printf("\r\ntames loaded: %lluK in %llu ms\r\n", td->db->GetBlockCnt() / 1000, GetTickCount64() - tm);
+	}
+	else
+	{
+		printf("\r\ntames loading failed\r\n");
+		td->db->Clear();
+	}
+	*td->loading = false;
+	delete td;
+	return 0;
+}
+
+//tames are needed for the first collision check only, so jumps, workers and kangaroos are prepared while they are loaded
+void TKangarooSolver::StartTamesLoading()
+{
+	printf("load tames in background...\r\n");
+	TamesLoading = true;
+	TTamesThrData* td = new TTamesThrData;
+	td->db = db;
+	td->fn = Config.TamesFileName;
+	td->Range = Range;
+	td->loading = &TamesLoading;
+	TamesThrActive = StartThread(&TamesThr, tames_thr_proc, td);
+	if (!TamesThrActive)
+		tames_thr_proc(td);
+}
+
+//waits for loading thread, DPs received during loading are processed if process_pending is set
+void TKangarooSolver::FinishTamesLoading(bool process_pending)
+{
+	if (!TamesThrActive)
+		return;
+	WaitThread(TamesThr);
+	TamesThrActive = false;
+	if (process_pending && !PendingDPs.empty())
+	{
+		int cnt = (int)(PendingDPs.size() / GPU_DP_SIZE);
+		printf("processing %d DPs received during tames loading\r\n", cnt);
+		ProcessDPs(PendingDPs.data(), cnt);
+	}
+	std::vector <u8>().swap(PendingDPs);
+}
+
+//executes in Solve thread only, like all DB changes after tames are loaded
+void TKangarooSolver::CheckNewPoints()
+{
+	u64 ops = PntTotalOps;
+	int cnt = DPRing.Pop(pPntList, MAX_CNT_LIST);
+	if (!cnt)
+		return;
+	TotalDPs += cnt;
+
+	//DB is not ready yet, keep DPs in RAM so workers don't wait for tames
+	if (TamesThrActive)
+	{
+		if (TamesLoading)
+		{
+			PendingDPs.insert(PendingDPs.end(), pPntList, pPntList + cnt * GPU_DP_SIZE);
+			return;
+		}
+		FinishTamesLoading(true);
+	}
+
+	if (Journal.IsOpened())
+		Journal.SetOps(ops);
+	if (Spill.IsActive())
+		Spill.SetOps(ops);
+	if (DPClient.IsActive())
+		DPClient.SetOps(ops);
+
+	ProcessDPs(pPntList, cnt);
+}
+
+struct TPrepareThrData
+{
+	RCKangWorker* Kang;
+	EcPoint* PntsToSolve;
+	int PntCnt;
+	int Range;
+	int DP;
+	EcJMP* EcJumps1;
+	EcJMP* EcJumps2;
+	EcJMP* EcJumps3;
+	bool res;
+};
+
+THR_PROC(prepare_thr_proc)
+{
+	TPrepareThrData* pd = (TPrepareThrData*)data;
+	pd->res = pd->Kang->Prepare(pd->PntsToSolve, pd->PntCnt, pd->Range, pd->DP, pd->EcJumps1, pd->EcJumps2, pd->EcJumps3);
+	return 0;
+}
+
+//allocations and copying for every GPU take time, do it for all workers at once
+void TKangarooSolver::PrepareWorkers()
+{
+	HHANDLER thrs[MAX_GPU_CNT];
+	TPrepareThrData pd[MAX_GPU_CNT];
+	bool started[MAX_GPU_CNT];
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		pd[i].Kang = workers[i];
+		pd[i].PntsToSolve = PntsToSolve;
+		pd[i].PntCnt = PntCnt;
+		pd[i].Range = Range;
+		pd[i].DP = DP;
+		pd[i].EcJumps1 = EcJumps1;
+		pd[i].EcJumps2 = EcJumps2;
+		pd[i].EcJumps3 = EcJumps3;
+		pd[i].res = false;
+		workers[i]->ClearReseed();
+		started[i] = StartThread(&thrs[i], prepare_thr_proc, &pd[i]);
+		if (!started[i])
+			prepare_thr_proc(&pd[i]);
+	}
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		if (started[i])
+			WaitThread(thrs[i]);
+		if (!pd[i].res)
+		{
+			workers[i]->Failed = true;
+			printf("GPU %d Prepare failed\r\n", workers[i]->CudaIndex);
+		}
+	}
+}
+
+//DB is filled by loading thread, don't touch it until tames are loaded
+u64 TKangarooSolver::GetStoredDPsCnt()
+{
+	if (TamesLoading)
+		return PendingDPs.size() / GPU_DP_SIZE;
+	return Spill.IsActive() ? Spill.GetCnt() : db->GetBlockCnt();
+}
+
+void TKangarooSolver::ShowStats(u64 tm_start, double exp_ops, double dp_val)
+{
+#ifdef DEBUG_MODE
+	for (int i = 0; i <= MD_LEN; i++)
+	{
+		u64 val = 0;
+		for (int j = 0; j < worker_cnt; j++)
+		{
+			val += workers[j]->dbg[i];
+		}
+		if (val)
+			printf("Loop size %d: %llu\r\n", i, val);
+	}
+#endif
+
+	int speed = workers[0]->GetStatsSpeed();
+	for (int i = 1; i < worker_cnt; i++)
+		speed += workers[i]->GetStatsSpeed();
+
+	TDPRingStats rs;
+	DPRing.GetStats(&rs);
+	if (rs.stall_cnt < last_stall_cnt) //new point
+		last_stall_cnt = 0;
+	if (rs.stall_cnt > last_stall_cnt)
+		printf("DP queue is full, GPUs wait for DPs processing, increase DP value!\r\n");
+	last_stall_cnt = rs.stall_cnt;
+
+	u64 est_dps_cnt = (u64)(exp_ops / dp_val);
+	u64 exp_sec = 0xFFFFFFFFFFFFFFFFull;
+
+	if (speed)
+		exp_sec = (u64)((exp_ops / 1000000) / speed);  // Expected time in seconds
+
+	// Expected Time Breakdown
+	u64 exp_days = exp_sec / (3600 * 24);
+	int exp_hours = (int)(exp_sec % (3600 * 24)) / 3600;
+	int exp_min = (int)(exp_sec % 3600) / 60;
+	int exp_remaining_sec = (int)(exp_sec % 60);  // Expected seconds
+
+	// Elapsed Time Calculation
+	u64 sec = (GetTickCount64() - tm_start) / 1000;  // Elapsed time in seconds
+	u64 days = sec / (3600 * 24);
+	int hours = (int)(sec % (3600 * 24)) / 3600;
+	int min = (int)(sec % 3600) / 60;
+	int remaining_sec = (int)(sec % 60);  // Elapsed seconds
+
+	u64 reseeded = 0;
+	for (int i = 0; i < worker_cnt; i++)
+		reseeded += workers[i]->ReseedCnt;
+
+	// Updated printf to include seconds in both elapsed and expected times
+	printf("%sSpeed: %d MKeys/s, Err: %d, Reseeded: %llu, DPs: %lluK/%lluK, Time: %llud:%02dh:%02dm:%02ds/%llud:%02dh:%02dm:%02ds\r",
+		Config.GenMode ? "GEN: " : (Config.IsBench ? "BENCH: " : "MAIN: "),
+		speed, TotalErrors + CollPool.GetErrorCnt(), reseeded,
+		GetStoredDPsCnt() / 1000, est_dps_cnt / 1000,
+		days, hours, min, remaining_sec,        // Elapsed Time with seconds
+		exp_days, exp_hours, exp_min, exp_remaining_sec  // Expected Time with seconds
+	);
+
+
+	fflush(stdout);  // Force the console to update the line
+
+}
+
+void TKangarooSolver::Stats()
+{
+	if (Callbacks.OnStats)
+		Callbacks.OnStats(Callbacks.ctx, this);
+}
+
+void TKangarooSolver::ExportMetrics(std::string& s)
+{
+	char labels[100];
+
+	TMetrics::AddHeader(s, "rck_worker_speed_mkeys", "gauge", "Average worker speed, MKeys/s.");
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		sprintf(labels, "worker=\"%d\",kind=\"%s\"", workers[i]->CudaIndex, workers[i]->GetKind());
+		TMetrics::AddValue(s, "rck_worker_speed_mkeys", labels, workers[i]->GetStatsSpeed());
+	}
+	TMetrics::AddHeader(s, "rck_worker_dps_total", "counter", "DPs sent by worker.");
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		sprintf(labels, "worker=\"%d\",kind=\"%s\"", workers[i]->CudaIndex, workers[i]->GetKind());
+		TMetrics::AddValue(s, "rck_worker_dps_total", labels, (double)workers[i]->DPsCnt);
+	}
+	TMetrics::AddHeader(s, "rck_worker_dp_overflows_total", "counter", "DP buffer overflows of worker, some DPs were lost.");
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		sprintf(labels, "worker=\"%d\",kind=\"%s\"", workers[i]->CudaIndex, workers[i]->GetKind());
+		TMetrics::AddValue(s, "rck_worker_dp_overflows_total", labels, (double)workers[i]->OverflowCnt);
+	}
+
+	TMetrics::AddHeader(s, "rck_dps_total", "counter", "DPs processed by host.");
+	TMetrics::AddValue(s, "rck_dps_total", NULL, (double)TotalDPs);
+	TMetrics::AddHeader(s, "rck_point_ops", "gauge", "Operations for current point.");
+	TMetrics::AddValue(s, "rck_point_ops", NULL, (double)PntTotalOps);
+	TMetrics::AddHeader(s, "rck_points_solved_total", "counter", "Solved points.");
+	TMetrics::AddValue(s, "rck_points_solved_total", NULL, (double)TotalPntSolved);
+	TMetrics::AddHeader(s, "rck_wild_relations", "gauge", "Collisions of wilds of different targets, current point.");
+	TMetrics::AddValue(s, "rck_wild_relations", NULL, (double)WildRelCnt);
+	TMetrics::AddHeader(s, "rck_errors_total", "counter", "Errors, including collision errors.");
+	TMetrics::AddValue(s, "rck_errors_total", NULL, TotalErrors + CollPool.GetErrorCnt());
+
+	TKangHealthStats hs;
+	KangHealth.GetStats(&hs);
+	TMetrics::AddHeader(s, "rck_kangs_stalled", "gauge", "Kangaroos without DPs for a long time, current point.");
+	TMetrics::AddValue(s, "rck_kangs_stalled", NULL, (double)hs.stalled);
+	TMetrics::AddHeader(s, "rck_kangs_merged", "gauge", "Kangaroos that walk the path of other kangaroos, current point.");
+	TMetrics::AddValue(s, "rck_kangs_merged", NULL, (double)hs.merged);
+	TMetrics::AddHeader(s, "rck_kangs_reseeded", "gauge", "Merged and stalled kangaroos restarted from new random positions, current point.");
+	TMetrics::AddValue(s, "rck_kangs_reseeded", NULL, (double)hs.reseeded);
+	TMetrics::AddHeader(s, "rck_kangs_dispersion", "gauge", "Variance to mean ratio of DPs per kangaroo, about 1 for healthy kangaroos.");
+	TMetrics::AddValue(s, "rck_kangs_dispersion", NULL, hs.dispersion);
+	u64 restarted = 0;
+	for (int i = 0; i < worker_cnt; i++)
+		restarted += workers[i]->RestartCnt;
+	TMetrics::AddHeader(s, "rck_wild_restarts", "gauge", "Wild kangaroos restarted after DP (-wildrestart), current point.");
+	TMetrics::AddValue(s, "rck_wild_restarts", NULL, (double)restarted);
+
+	TKangAuditStats as;
+	Audit.GetStats(&as);
+	TMetrics::AddHeader(s, "rck_audit_runs", "gauge", "Finished kangaroos audits, current point.");
+	TMetrics::AddValue(s, "rck_audit_runs", NULL, as.runs);
+	TMetrics::AddHeader(s, "rck_audit_looped", "gauge", "Kangaroos found in loops longer than MD_LEN and escaped by audit, current point.");
+	TMetrics::AddValue(s, "rck_audit_looped", NULL, (double)as.looped_total);
+
+	TMetrics::AddHeader(s, "rck_db_records", "gauge", "DPs in DB, or in tames runs if -spill is used.");
+	TMetrics::AddValue(s, "rck_db_records", NULL, (double)GetStoredDPsCnt());
+	TMetrics::AddHeader(s, "rck_db_bytes", "gauge", "RAM used by DB.");
+	TMetrics::AddValue(s, "rck_db_bytes", NULL, TamesLoading ? 0.0 : (double)db->GetMemSize());
+
+	TDPRingStats rs;
+	DPRing.GetStats(&rs);
+	TMetrics::AddHeader(s, "rck_dp_queue_size", "gauge", "DP queue capacity.");
+	TMetrics::AddValue(s, "rck_dp_queue_size", NULL, rs.size);
+	TMetrics::AddHeader(s, "rck_dp_queue_occupancy", "gauge", "DPs waiting in queue.");
+	TMetrics::AddValue(s, "rck_dp_queue_occupancy", NULL, rs.occupancy);
+	TMetrics::AddHeader(s, "rck_dp_queue_stalls", "gauge", "Times workers waited for free space in queue, current point.");
+	TMetrics::AddValue(s, "rck_dp_queue_stalls", NULL, (double)rs.stall_cnt);
+	DPRing.GetLatHist()->Export(s, "rck_dp_queue_latency_seconds", "Time from DP push by worker to processing by host.");
+	CollPool.GetCheckHist()->Export(s, "rck_collision_check_seconds", "Verification time of one collision candidate.");
+
+	if (DPClient.IsActive())
+	{
+		TMetrics::AddHeader(s, "rck_dpclient_pending", "gauge", "DPs waiting to be sent to DP server.");
+		TMetrics::AddValue(s, "rck_dpclient_pending", NULL, (double)DPClient.GetPendingCnt());
+	}
+}
+
+//workers can change between points (failed GPUs), so plan is made for every point
+//returns planned DP or 0 if there is no valid DP, for manual DP it only warns if DP is too low and returns _DP
+//every point needs its own share of wild ops, shared tames make it a bit cheaper, so pnt_cnt * ops is an upper bound for DB size
+int TKangarooSolver::PlanPointDP(int _DP, int pnt_cnt)
+{
+	TDPPlanIn in;
+	double ops = 1.15 * pow(2.0, Range / 2.0);
+	in.Range = Range;
+	in.ExpOps = pnt_cnt * ops;
+	in.MaxOps = (Config.Max > 0) ? Config.Max * ops : 0.0; //same limit as in Solve
+	in.TotalKangs = 0;
+	in.MaxWorkerKangs = 0;
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		if (workers[i]->Failed)
+			continue;
+		u64 cnt = workers[i]->CalcKangCnt();
+		in.TotalKangs += cnt;
+		if (cnt > in.MaxWorkerKangs)
+			in.MaxWorkerKangs = cnt;
+	}
+	in.RamBytes = (Config.RamGB > 0) ? (u64)(Config.RamGB * 1024 * 1024 * 1024) : (u64)(PLAN_RAM_USAGE * GetPhysRamSize());
+	if (Config.SpillMB)
+		in.Store = PLAN_STORE_SPILL;
+	else
+		in.Store = Config.DPClientAddr[0] ? PLAN_STORE_REMOTE : PLAN_STORE_RAM;
+	TDPPlan plan;
+	bool ok = PlanDP(&in, &plan);
+	PrintDPPlan(&in, &plan);
+	if (Config.AutoDP)
+		return ok ? plan.dp : 0;
+	if (!ok || (_DP < plan.dp))
+		printf("WARNING: DP %d is lower than planned, DB may not fit into RAM or DPs may be lost\r\n", _DP);
+	return _DP;
+}
+
+//workers must run while their kangaroos are saved, so DPs are processed here to keep DP queue free
+bool TKangarooSolver::SaveCheckpoint(u64 total_ops, u64 solve_ms)
+{
+	printf("saving checkpoint...\r\n");
+	while (Checkpoint.IsRunning()) //periodic one
+	{
+		CheckNewPoints();
+		DPRing.Wait(100);
+	}
+	if (!Checkpoint.Begin(total_ops, solve_ms))
+		return false;
+	while (Checkpoint.IsRunning())
+	{
+		CheckNewPoints();
+		DPRing.Wait(100);
+	}
+	if (!Checkpoint.GetResult())
+		printf("checkpoint saving failed\r\n");
+	return Checkpoint.GetResult();
+}
+
+//jump distances are from fixed seed to make tames from file compatible, points are taken from JumpCache
+void TKangarooSolver::GenJumps(int _Range, EcJMP* Jumps1, EcJMP* Jumps2, EcJMP* Jumps3)
+{
+	TRndGen gen;
+	gen.SetSeed(0);
+	EcInt minjump, t;
+	minjump.Set(1);
+	minjump.ShiftLeft(_Range / 2 + 3);
+	for (int i = 0; i < JMP_CNT; i++)
+	{
+		Jumps1[i].dist = minjump;
+		t.RndMax(minjump, &gen);
+		Jumps1[i].dist.Add(t);
+		Jumps1[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+	}
+
+	minjump.Set(1);
+	minjump.ShiftLeft(_Range - 10); //large jumps for L1S2 loops. Must be almost RANGE_BITS
+	for (int i = 0; i < JMP_CNT; i++)
+	{
+		Jumps2[i].dist = minjump;
+		t.RndMax(minjump, &gen);
+		Jumps2[i].dist.Add(t);
+		Jumps2[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+	}
+
+	minjump.Set(1);
+	minjump.ShiftLeft(_Range - 10 - 2); //large jumps for loops >2
+	for (int i = 0; i < JMP_CNT; i++)
+	{
+		Jumps3[i].dist = minjump;
+		t.RndMax(minjump, &gen);
+		Jumps3[i].dist.Add(t);
+		Jumps3[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
+	}
+	JumpCache.SetPoints(_Range, 0, Jumps1, Jumps2, Jumps3);
+}
+
+void TKangarooSolver::PrepareNext(int _Range, char* tames_fn)
+{
+	u64 tm = GetTickCount64();
+	EcJMP* jmps = new EcJMP[3 * JMP_CNT];
+	GenJumps(_Range, jmps, jmps + JMP_CNT, jmps + 2 * JMP_CNT);
+	delete[] jmps;
+	//DB is in RAM already, file is read to OS cache only if it's much smaller than RAM
+	if (tames_fn && tames_fn[0] && ReadFileToCache(tames_fn, GetPhysRamSize() / 4))
+		printf("\r\ntames file is read to cache\r\n");
+	printf("\r\nnext point is prepared in %llu ms\r\n", GetTickCount64() - tm);
+}
+
+//every exit of Solve after tames loading is started goes here, so next Solve starts from clean state
+void TKangarooSolver::EndSolve()
+{
+	FinishTamesLoading(false);
+	Journal.Close();
+	Checkpoint.Stop();
+	DPClient.Stop();
+	Spill.Release();
+	db->Clear();
+}
+
+THR_PROC(kang_thr_proc)
+{
+	RCKangWorker* Kang = (RCKangWorker*)data;
+	Kang->OpenStates();
+	Kang->Execute();
+	Kang->CloseStates();
+	return 0;
+}
+
+bool TKangarooSolver::Solve(EcPoint* _PntsToSolve, int _PntCnt, int _Range, int _DP, EcInt* pk_res, bool* solved)
+{
+	Range = _Range;
+	DP = _DP;
+	if ((Range < 32) || (Range > 180))
+	{
+		printf("Unsupported Range value (%d)!\r\n", Range);
+		return false;
+	}
+	if (Config.AutoDP || (Config.RamGB > 0))
+	{
+		DP = PlanPointDP(DP, _PntCnt);
+		if (!DP)
+			return false;
+	}
+	if ((DP < 14) || (DP > 60))
+	{
+		printf("Unsupported DP value (%d)!\r\n", DP);
+		return false;
+	}
+
+	if (_PntCnt > 1)
+		printf("\r\nSolving %d points: Range %d bits, DP %d, start...\r\n", _PntCnt, Range, DP);
+	else
+		printf("\r\nSolving point: Range %d bits, DP %d, start...\r\n", Range, DP);
+	double ops = 1.15 * pow(2.0, Range / 2.0);
+	double dp_val = (double)(1ull << DP);
+	double ram = (32 + 4 + 4) * ops / dp_val; //+4 for grow allocation and memory fragmentation
+	ram += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
+	ram /= (1024 * 1024 * 1024); //GB
+	printf("SOTA method, estimated ops: 2^%.3f, RAM for DPs: %.3f GB. DP and GPU overheads not included!\r\n", log2(ops), ram);
+	IsOpsLimit = false;
+	double MaxTotalOps = 0.0;
+	if (Config.Max > 0)
+	{
+		MaxTotalOps = Config.Max * ops;
+		double ram_max = (32 + 4 + 4) * MaxTotalOps / dp_val; //+4 for grow allocation and memory fragmentation
+		ram_max += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
+		ram_max /= (1024 * 1024 * 1024); //GB
+		printf("Max allowed number of ops: 2^%.3f, max RAM for DPs: %.3f GB\r\n", log2(MaxTotalOps), ram_max);
+	}
+
+	u64 total_kangs = workers[0]->CalcKangCnt();
+	for (int i = 1; i < worker_cnt; i++)
+		total_kangs += workers[i]->CalcKangCnt();
+	if (total_kangs) //only DP server without GPUs has no kangs
+	{
+		double path_single_kang = ops / total_kangs;
+		double DPs_per_kang = path_single_kang / dp_val;
+		printf("Estimated DPs per kangaroo: %.3f.%s\r\n", DPs_per_kang, (DPs_per_kang < 5) ? " DP overhead is big, use less DP value if possible!" : "");
+	}
+
+	//herd is the same for all workers, default is 1:1:1, in tames generation mode it's not used
+	THerd herd = Config.Herd;
+	u64 tames_cnt = 0;
+	if (!Config.GenMode && Config.TamesFileName[0] && !GetTamesFileCnt(Config.TamesFileName, &tames_cnt))
+		tames_cnt = 0;
+	if (!Config.GenMode)
+	{
+		if (!Config.HerdSet && (Config.HerdAuto || Config.TamesFileName[0]))
+		{
+			PlanHerd(ops, (double)tames_cnt * dp_val, &herd);
+			printf("Herd for %lluK preloaded tames: ", tames_cnt / 1000);
+		}
+		else
+			printf("Herd: ");
+		double herd_sum = (double)herd.tame + herd.wild1 + herd.wild2;
+		printf("tames %.1f%%, wild1 %.1f%%, wild2 %.1f%%\r\n", 100.0 * herd.tame / herd_sum, 100.0 * herd.wild1 / herd_sum, 100.0 * herd.wild2 / herd_sum);
+	}
+	u64 kang_seed = Config.KangSeedSet ? Config.KangSeed : GetTickCount64();
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		workers[i]->Herd = herd;
+		workers[i]->GenMode = Config.GenMode;
+		workers[i]->WildRestart = Config.WildRestart;
+		workers[i]->Seed = kang_seed;
+	}
+	//ETA is by restart model, SOTA estimation is still used for -max and RAM
+	double exp_ops = ops;
+	if (Config.WildRestart)
+	{
+		exp_ops = CalcWildRestartOps(Range, DP, tames_cnt, &herd);
+		if (exp_ops > 0.0)
+			printf("Wild restart after DP, estimated ops: 2^%.3f%s\r\n", log2(exp_ops), (exp_ops > ops) ? ", it's more than SOTA method, tames file is too small!" : "");
+		else
+		{
+			printf("Wild restart after DP: there are no wilds or preloaded tames, SOTA estimation is used\r\n");
+			exp_ops = ops;
+		}
+	}
+
+	if (!Config.GenMode && Config.TamesFileName[0])
+		StartTamesLoading();
+	//in extend mode with spilling existing tames are merged with runs at the end, otherwise load them to dedup new tames
+	if (Config.ExtendMode && !Config.SpillMB)
+	{
+		printf("load tames to extend...\r\n");
+		if (!db->LoadFromFile(Config.TamesFileName))
+		{
+			printf("tames loading failed\r\n");
+			EndSolve();
+			return false;
+		}
+		printf("tames loaded: %lluK\r\n", db->GetBlockCnt() / 1000);
+	}
+
+	PntTotalOps = 0;
+	WildRelCnt = 0;
+	WildRels.clear();
+	DPRing.Reset();
+	GenJumps(Range, EcJumps1, EcJumps2, EcJumps3);
+
+	Int_HalfRange.Set(1);
+	Int_HalfRange.ShiftLeft(Range - 1);
+	Pnt_HalfRange = ec.MultiplyG(Int_HalfRange);
+	Pnt_NegHalfRange = Pnt_HalfRange;
+	Pnt_NegHalfRange.y.NegModP();
+	Int_TameOffset.Set(1);
+	Int_TameOffset.ShiftLeft(Range - 1);
+	EcInt tt;
+	tt.Set(1);
+	tt.ShiftLeft(Range - 5); //half of tame range width
+	Int_TameOffset.Sub(tt);
+	PntCnt = _PntCnt;
+	for (int i = 0; i < PntCnt; i++)
+	{
+		PntsToSolve[i] = _PntsToSolve[i];
+		solved[i] = false;
+	}
+
+	PrepareWorkers();
+	int kang_cnts[MAX_GPU_CNT];
+	for (int i = 0; i < worker_cnt; i++)
+		kang_cnts[i] = workers[i]->Failed ? 0 : workers[i]->KangCnt;
+	if (!KangHealth.Init(worker_cnt, kang_cnts))
+		printf("WARNING: not enough RAM for kangaroos health table\r\n");
+
+	//for many points journal and checkpoint store xor of them, it's enough to detect another task
+	u8 task_pnt[64];
+	memset(task_pnt, 0, sizeof(task_pnt));
+	for (int i = 0; (i < PntCnt) && !Config.GenMode; i++)
+	{
+		u8 buf[64];
+		PntsToSolve[i].SaveToBuffer64(buf);
+		for (int j = 0; j < 64; j++)
+			task_pnt[j] ^= buf[j];
+	}
+	if (Config.JournalFileName[0])
+	{
+		FinishTamesLoading(false); //journal is replayed to DB after tames
+		TJournalHeader hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.range = Range;
+		hdr.dp = DP;
+		hdr.gen_mode = Config.GenMode;
+		if (!Config.GenMode)
+		{
+			memcpy(hdr.pnt, task_pnt, 64);
+			hdr.target_cnt = (PntCnt > 1) ? PntCnt : 0;
+		}
+		u64 replay_ops, replay_cnt;
+		u64 tm = GetTickCount64();
+		if (!Journal.Open(Config.JournalFileName, &hdr, db, &replay_ops, &replay_cnt))
+		{
+			printf("DP journal cannot be opened\r\n");
+			EndSolve();
+			return false;
+		}
+		PntTotalOps = replay_ops;
+		if (replay_cnt)
+			printf("DP journal: %llu DPs replayed in %llu ms, ops: 2^%.3f\r\n", replay_cnt, GetTickCount64() - tm, log2((double)replay_ops + 1));
+	}
+
+	u64 resumed_ms = 0;
+	if (Checkpoint.IsEnabled())
+	{
+		TChkHeader chk;
+		memset(&chk, 0, sizeof(chk));
+		chk.range = Range;
+		chk.dp = DP;
+		chk.target_cnt = (PntCnt > 1) ? PntCnt : 0;
+		memcpy(chk.pnt, task_pnt, 64);
+		chk.jumps_hash = TCheckpoint::CalcJumpsHash(EcJumps1, EcJumps2, EcJumps3);
+		Checkpoint.Start(workers, worker_cnt, &chk);
+		u64 chk_ops;
+		if (Config.Resume)
+		{
+			if (!Checkpoint.Load(&chk_ops, &resumed_ms))
+			{
+				EndSolve();
+				return false;
+			}
+			//journal has DPs found after checkpoint too
+			if (chk_ops > PntTotalOps)
+				PntTotalOps = chk_ops;
+		}
+	}
+
+	if (Config.GenMode && Config.SpillMB)
+	{
+		u64 resumed_ops;
+		if (!Spill.Init(Config.TamesFileName, (u64)Config.SpillMB * 1024 * 1024, Range, DP, &resumed_ops))
+		{
+			EndSolve();
+			return false;
+		}
+		PntTotalOps = resumed_ops;
+		if (Spill.GetCnt())
+			printf("tames runs found: %lluK DPs, ops: 2^%.3f\r\n", Spill.GetCnt() / 1000, log2((double)resumed_ops + 1));
+	}
+
+	if (dp_server && dp_server->Failed)
+	{
+		EndSolve();
+		return false;
+	}
+	if (Config.DPClientAddr[0] && !DPClient.Start(Config.DPClientAddr, PntsToSolve, PntCnt, Range, DP))
+	{
+		printf("DP client cannot be started\r\n");
+		EndSolve();
+		return false;
+	}
+
+	u64 tm0 = GetTickCount64() - resumed_ms;
+	printf("GPUs started...\r\n");
+
+	HHANDLER thr_handles[MAX_GPU_CNT];
+	bool thr_started[MAX_GPU_CNT];
+	Solved = false;
+	if (!CollPool.Start(verify_coll_proc, this))
+	{
+		printf("collision verification threads cannot be started\r\n");
+		EndSolve();
+		return false;
+	}
+	for (int i = 0; i < worker_cnt; i++)
+	{
+		thr_started[i] = StartThread(&thr_handles[i], kang_thr_proc, workers[i]);
+		if (!thr_started[i])
+		{
+			printf("GPU %d thread cannot be started\r\n", workers[i]->CudaIndex);
+			workers[i]->Failed = true;
+		}
+	}
+
+	Audit.Start(workers, worker_cnt, EcJumps1, EcJumps2, EcJumps3);
+	if (Callbacks.OnStarted)
+		Callbacks.OnStarted(Callbacks.ctx, this);
+	u64 tm_stats = GetTickCount64();
+	int solved_cnt = 0;
+	bool failed = false; //solving cannot continue, for example DP server rejected our task
+	while (!Solved)
+	{
+		CheckNewPoints();
+		TCollResult res;
+		while (CollPool.PopResult(&res))
+		{
+			solved[res.target] = true;
+			pk_res[res.target] = res.key;
+			solved_cnt++;
+			TotalPntSolved++;
+			if (PntCnt > 1)
+				printf("\r\nPoint %d solved, %d of %d points solved\r\n", res.target, solved_cnt, PntCnt);
+			if (Callbacks.OnKey && !Callbacks.OnKey(Callbacks.ctx, res.target, res.key))
+				TotalErrors++;
+			if (solved_cnt == PntCnt)
+				Solved = true;
+		}
+		if (!Solved && !WildRels.empty())
+			CheckWildRels(solved, pk_res);
+		if (dp_server)
+		{
+			u64 mask = 0;
+			for (int i = 0; i < PntCnt; i++)
+				if (solved[i])
+					mask |= 1ull << i;
+			dp_server->SetSolvedMask(mask);
+		}
+		if (DPClient.IsActive())
+		{
+			//keys are saved by server
+			u64 mask = DPClient.GetSolvedMask();
+			for (int i = 0; i < PntCnt; i++)
+				if (((mask >> i) & 1) && !solved[i])
+				{
+					solved[i] = true;
+					solved_cnt++;
+					TotalPntSolved++;
+					printf("\r\nPoint %d solved by DP server, %d of %d points solved\r\n", i, solved_cnt, PntCnt);
+				}
+			if (solved_cnt == PntCnt)
+				Solved = true;
+			if (DPClient.IsRejected())
+			{
+				failed = true;
+				break;
+			}
+		}
+		if (Solved)
+			break;
+		if (TamesThrActive && !TamesLoading)
+			FinishTamesLoading(true);
+		DPRing.Wait(100);
+
+		if (GetTickCount64() - tm_stats > 5000)  // 5 sec
+		{
+			std::vector <u32> stalled;
+			if (KangHealth.CheckStalled(&stalled))
+			{
+				printf("\r\nWARNING: %llu kangaroos have no DPs for %d expected DPs, they are stalled, re-seed them\r\n", (u64)stalled.size(), KH_STALL_DPS);
+				for (size_t i = 0; i < stalled.size(); i++)
+					ReseedKang(stalled[i]);
+			}
+			Audit.Check();
+			Checkpoint.Check(PntTotalOps, GetTickCount64() - tm0);
+			ShowStats(tm0, exp_ops, dp_val);
+			Stats();
+			tm_stats = GetTickCount64();
+		}
+
+		if ((MaxTotalOps > 0.0) && (PntTotalOps > MaxTotalOps))
+		{
+			IsOpsLimit = true;
+			printf("Operations limit reached\n");
+			break;
+		}
+		if (StopReq)
+		{
+			printf("\r\nStop requested\r\n");
+			break;
+		}
+	}
+	if (Checkpoint.IsEnabled() && !Solved)
+		SaveCheckpoint(PntTotalOps, GetTickCount64() - tm0);
+
+
+	printf("\n\nStopping work ...\r\n");
+	time_t program_end_time = time(NULL);  // Capture the end time
+	// Calculate total time
+	time_t total_seconds = program_end_time - start_time;
+
+	int total_days = total_seconds / (24 * 3600);
+	int total_hours = (total_seconds % (24 * 3600)) / 3600;
+	int total_minutes = (total_seconds % 3600) / 60;
+	int remaining_seconds = total_seconds % 60;
+
+	// Dynamically build the time string
+	printf("Total Time: ");
+
+	int printed = 0;  // To track if we've printed any component yet
+
+	if (total_days > 0) {
+		printf("%d day%s", total_days, total_days == 1 ? "" : "s");
+		printed = 1;
+	}
+
+	if (total_hours > 0) {
+		if (printed) printf(", ");
+		printf("%d hour%s", total_hours, total_hours == 1 ? "" : "s");
+		printed = 1;
+	}
+
+	if (total_minutes > 0) {
+		if (printed) printf(", ");
+		printf("%d minute%s", total_minutes, total_minutes == 1 ? "" : "s");
+		printed = 1;
+	}
+
+	if (remaining_seconds > 0 || !printed) {  // Always print seconds if nothing else was printed
+		if (printed) printf(", ");
+		printf("%d second%s", remaining_seconds, remaining_seconds == 1 ? "" : "s");
+	}
+
+	printf("\n");
+
+
+	Audit.Stop(); //it waits for workers
+	Checkpoint.Stop();
+	for (int i = 0; i < worker_cnt; i++)
+		workers[i]->Stop();
+	DPRing.Abort(); //workers can wait for free space in DP queue
+	for (int i = 0; i < worker_cnt; i++)
+		if (thr_started[i])
+			WaitThread(thr_handles[i]);
+	FinishTamesLoading(false);
+	Journal.Close();
+	DPClient.Stop();
+	CollPool.Stop();
+	TotalErrors += CollPool.GetErrorCnt();
+
+	PntSolveMs = GetTickCount64() - tm0;
+	Stats();
+
+	TDPRingStats rs;
+	DPRing.GetStats(&rs);
+	PntTotalDPs = rs.pushed;
+	printf("DP queue: max occupancy %.1f%%, latency avg %llu us, max %llu us, stalls %llu (%llu ms)\r\n",
+		100.0 * rs.max_occupancy / rs.size, rs.lat_avg_us, rs.lat_max_us, rs.stall_cnt, rs.stall_ms);
+	printf("DPs processed: %llu, %.0f DPs/s\r\n", PntTotalDPs, PntSolveMs ? 1000.0 * PntTotalDPs / PntSolveMs : 0.0);
+	KangHealth.PrintStats();
+	if (PntCnt > 1)
+		printf("Collisions of wilds of different points: %llu\r\n", WildRelCnt);
+	if (Config.WildRestart)
+	{
+		u64 restarted = 0;
+		for (int i = 0; i < worker_cnt; i++)
+			restarted += workers[i]->RestartCnt;
+		printf("Wild kangaroos restarted after DP: %llu\r\n", restarted);
+	}
+
+	if (IsOpsLimit)
+	{
+		if (Config.GenMode)
+		{
+			printf("saving tames...\r\n");
+			db->Header[0] = Range;
+			db->Header[1] = DP;
+			u64 max_cnt = 0;
+			if (Config.TamesSizeMB)
+			{
+				max_cnt = GetTamesCntForFileSize((u64)Config.TamesSizeMB * 1024 * 1024, Range, Config.TamesCompress);
+				if (!max_cnt)
+				{
+					printf("-tsize value is too small, one tame is saved\r\n");
+					max_cnt = 1;
+				}
+				printf("max tames in file: %lluK\r\n", max_cnt / 1000);
+			}
+			bool saved;
+			if (Spill.IsActive())
+				saved = Spill.Merge(Config.TamesFileName, Config.ExtendMode ? Config.TamesFileName : NULL, db->Header, Config.TamesCompress, max_cnt);
+			else
+				saved = db->SaveToFile(Config.TamesFileName, Config.TamesCompress, max_cnt);
+			if (saved)
+			{
+				printf("tames saved\r\n");
+				if (Config.JournalFileName[0])
+					remove(Config.JournalFileName);
+			}
+			else
+				printf("tames saving failed\r\n");
+		}
+		EndSolve();
+		return false;
+	}
+
+	if (StopReq || failed)
+	{
+		EndSolve();
+		return false;
+	}
+
+	double K = (double)PntTotalOps / pow(2.0, Range / 2.0);
+	if (PntCnt > 1)
+		printf("%d points solved, ops per point: 2^%.3f\r\n\r\n", PntCnt, log2((double)PntTotalOps / PntCnt));
+	else
+		printf("Point solved, K: %.3f (with DP and GPU overheads)\r\n\r\n", K);
+	EndSolve();
+	return true;
+}
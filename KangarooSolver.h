@@ -0,0 +1,173 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <string>
+#include "defs.h"
+#include "utils.h"
+#include "Ec.h"
+#include "KangWorker.h"
+#include "DPRing.h"
+#include "CollisionPool.h"
+#include "DPJournal.h"
+#include "TamesSpill.h"
+#include "DPServer.h"
+#include "DPClient.h"
+#include "JumpCache.h"
+#include "KangHealth.h"
+#include "KangAudit.h"
+#include "Checkpoint.h"
+
+//solver has everything that is needed to solve points: workers, jumps, DP queue and DB, so several solvers can work in one process.
+//Solve executes in caller thread, workers and helper threads are started and stopped for every call.
+//InitEc must be called once before any solver is used, EC tables are shared and read-only.
+
+class TKangarooSolver;
+
+struct TSolverConfig
+{
+	bool AutoDP; //DP is selected by planner for every point
+	double RamGB; //RAM budget for DB, 0 - part of physical RAM
+	double Max; //ops limit as multiplier of expected ops, 0 - no limit
+	bool GenMode; //tames generation mode
+	bool ExtendMode; //tames generation mode, new tames are added to existing tames file
+	bool TamesCompress; //save tames in compressed format
+	u32 TamesSizeMB; //max size of saved tames file, most reached tames are selected, 0 - save all tames
+	u32 SpillMB; //RAM budget for tames generation with spilling to disk, 0 - keep all tames in RAM
+	char TamesFileName[1024];
+	char JournalFileName[1024];
+	char DPClientAddr[256]; //DB and collisions are on DP server
+	bool KangSeedSet; //start positions of kangaroos are generated from KangSeed instead of time
+	u64 KangSeed;
+	THerd Herd;
+	bool HerdSet;
+	bool HerdAuto;
+	bool WildRestart; //wild kangs start from new random points after every DP
+	bool Resume; //continue from checkpoint
+	bool IsBench; //for stats only
+};
+
+//callbacks are called from Solve thread
+struct TSolverCallbacks
+{
+	void* ctx;
+	//verified key of target, returns false if key is not accepted, it's counted as error
+	bool (*OnKey)(void* ctx, int target, EcInt& key);
+	//every 5 seconds and after every Solve
+	void (*OnStats)(void* ctx, TKangarooSolver* solver);
+	//workers are started, jumps of this Solve are ready
+	void (*OnStarted)(void* ctx, TKangarooSolver* solver);
+};
+
+//wilds of two targets met: wild points are +-(key - HalfRange) + dist, so when one key is found the other one is found too
+struct TWildRel
+{
+	int target1;
+	int target2;
+	EcInt dist1;
+	EcInt dist2;
+};
+
+class TKangarooSolver : public TWorkerHost
+{
+private:
+	Ec ec;
+	RCKangWorker* workers[MAX_GPU_CNT];
+	int worker_cnt;
+	RCDPServer* dp_server; //one of workers or NULL
+
+	EcJMP EcJumps1[JMP_CNT];
+	EcJMP EcJumps2[JMP_CNT];
+	EcJMP EcJumps3[JMP_CNT];
+	EcInt Int_HalfRange;
+	EcPoint Pnt_HalfRange;
+	EcPoint Pnt_NegHalfRange;
+	EcInt Int_TameOffset;
+	EcPoint PntsToSolve[MAX_TARGET_CNT];
+	int PntCnt;
+	int Range;
+	int DP;
+
+	TFastBase* db; //it's big, allocated by Init
+	TDPRing DPRing;
+	u8* pPntList;
+	TCollisionPool CollPool;
+	TDPJournal Journal;
+	TTamesSpill Spill;
+	TDPClient DPClient;
+	TKangHealth KangHealth;
+	volatile bool Solved;
+	volatile bool StopReq;
+	time_t start_time;
+	u64 last_stall_cnt;
+
+	HHANDLER TamesThr;
+	bool TamesThrActive;
+	volatile bool TamesLoading; //tames are loaded to DB in background, new DPs wait in PendingDPs
+	std::vector <u8> PendingDPs;
+	std::vector <TWildRel> WildRels; //relations of unsolved targets, current point
+
+	bool Collision_SOTA(EcPoint& pnt, EcInt t, int TameType, EcInt w, int WildType, bool IsNeg, EcInt* pk);
+	void ReseedKang(u32 kang_id);
+	void ProcessDPs(u8* list, int cnt);
+	void StartTamesLoading();
+	void FinishTamesLoading(bool process_pending);
+	void CheckNewPoints();
+	void PrepareWorkers();
+	u64 GetStoredDPsCnt();
+	void ShowStats(u64 tm_start, double exp_ops, double dp_val);
+	int PlanPointDP(int _DP, int pnt_cnt);
+	bool SaveCheckpoint(u64 total_ops, u64 solve_ms);
+	void GenJumps(int _Range, EcJMP* Jumps1, EcJMP* Jumps2, EcJMP* Jumps3);
+	void EndSolve();
+	bool SolveByWildRel(TWildRel* rel, int solved_target, EcInt& key, EcInt* res);
+	void CheckWildRels(bool* solved, EcInt* pk_res);
+	void Stats();
+public:
+	TSolverConfig Config;
+	TSolverCallbacks Callbacks;
+	//set up before Solve by their own options
+	TJumpCache JumpCache;
+	TKangAudit Audit;
+	TCheckpoint Checkpoint;
+
+	//last Solve
+	std::atomic<u64> PntTotalOps;
+	u64 PntTotalDPs;
+	u64 PntSolveMs;
+	bool IsOpsLimit;
+	u64 WildRelCnt; //collisions of wilds of different targets
+	//for all Solve calls
+	u64 TotalDPs;
+	u64 TotalPntSolved;
+	std::atomic<u32> TotalErrors; //workers add errors from their threads
+
+	TKangarooSolver();
+	~TKangarooSolver();
+	//workers are owned by caller, they must not be used by other solvers
+	bool Init(RCKangWorker** _workers, int _worker_cnt, RCDPServer* _dp_server);
+	void Release();
+	//solves PntCnt points at once, wild kangs are distributed between points and tames are shared
+	//returns true if all points are solved, solved[i] and pk_res[i] are set for every solved point
+	bool Solve(EcPoint* _PntsToSolve, int _PntCnt, int _Range, int _DP, EcInt* pk_res, bool* solved);
+	//executes in other thread while Solve works: jumps of next range are calculated and tames file is read to OS cache,
+	//so next Solve starts faster. Workers keep their buffers between points, they are not touched here
+	void PrepareNext(int _Range, char* tames_fn);
+	//can be called from any thread or signal handler, Solve saves checkpoint and returns false
+	void RequestStop() { StopReq = true; }
+	bool IsStopRequested() { return StopReq; }
+	int GetDP() { return DP; } //DP of last Solve, it can be selected by planner
+	int GetWorkerCnt() { return worker_cnt; }
+	//executes in Solve thread (OnStats), so DB and workers can be accessed safely
+	void ExportMetrics(std::string& s);
+
+	void AddPoints(u32* data, int cnt, u64 ops_cnt);
+	void AddError();
+	bool VerifyCollision(TCollCand* cand, EcInt* pk);
+};
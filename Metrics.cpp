@@ -0,0 +1,175 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include "Metrics.h"
+#include "Net.h"
+
+//upper bounds of histogram buckets, us
+static const u64 hist_bounds[HIST_BUCKET_CNT] = {
+	10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000 };
+
+THistogram::THistogram()
+{
+	for (int i = 0; i <= HIST_BUCKET_CNT; i++)
+		counts[i] = 0;
+	sum = 0;
+}
+
+void THistogram::Add(u64 val_us)
+{
+	int i = 0;
+	while ((i < HIST_BUCKET_CNT) && (val_us > hist_bounds[i]))
+		i++;
+	counts[i].fetch_add(1, std::memory_order_relaxed);
+	sum.fetch_add(val_us, std::memory_order_relaxed);
+}
+
+//prometheus buckets are cumulative
+void THistogram::Export(std::string& out, const char* name, const char* help)
+{
+	char s[256], labels[64];
+	TMetrics::AddHeader(out, name, "histogram", help);
+	u64 total = 0;
+	for (int i = 0; i <= HIST_BUCKET_CNT; i++)
+	{
+		total += counts[i].load(std::memory_order_relaxed);
+		if (i < HIST_BUCKET_CNT)
+			sprintf(labels, "le=\"%g\"", hist_bounds[i] / 1000000.0);
+		else
+			strcpy(labels, "le=\"+Inf\"");
+		sprintf(s, "%s_bucket", name);
+		TMetrics::AddValue(out, s, labels, (double)total);
+	}
+	sprintf(s, "%s_sum", name);
+	TMetrics::AddValue(out, s, NULL, sum.load(std::memory_order_relaxed) / 1000000.0);
+	sprintf(s, "%s_count", name);
+	TMetrics::AddValue(out, s, NULL, (double)total);
+}
+
+THR_PROC(metrics_thr_proc)
+{
+	((TMetrics*)data)->Execute();
+	return 0;
+}
+
+TMetrics::TMetrics()
+{
+	file_name[0] = 0;
+	port = 0;
+	sock = NET_INVALID_SOCKET;
+	thr_started = false;
+	stop = false;
+}
+
+TMetrics::~TMetrics()
+{
+	Stop();
+}
+
+bool TMetrics::Start(char* _file_name, int _port)
+{
+	strcpy(file_name, _file_name ? _file_name : "");
+	port = _port;
+	if (!port)
+		return true;
+	//localhost only, metrics are not protected
+	char addr[32];
+	sprintf(addr, "%d", port);
+	sock = NetListen(addr, true);
+	if (sock == NET_INVALID_SOCKET)
+		return false;
+	stop = false;
+	if (!StartThread(&thr, metrics_thr_proc, this))
+	{
+		NetClose(sock);
+		sock = NET_INVALID_SOCKET;
+		return false;
+	}
+	thr_started = true;
+	return true;
+}
+
+void TMetrics::Stop()
+{
+	if (!thr_started)
+		return;
+	stop = true;
+	WaitThread(thr);
+	thr_started = false;
+	NetClose(sock);
+	sock = NET_INVALID_SOCKET;
+}
+
+//file is replaced atomically so collector never reads a partial file
+void TMetrics::Publish(std::string& txt)
+{
+	cs.Enter();
+	text = txt;
+	cs.Leave();
+	if (!file_name[0])
+		return;
+	char tmp_fn[1100];
+	sprintf(tmp_fn, "%s.tmp", file_name);
+	FILE* fp = fopen(tmp_fn, "wb");
+	if (!fp)
+		return;
+	bool ok = fwrite(txt.data(), 1, txt.size(), fp) == txt.size();
+	fclose(fp);
+	if (ok)
+		RenameFile(tmp_fn, file_name);
+	else
+		remove(tmp_fn);
+}
+
+//any request gets metrics, request itself is not parsed
+void TMetrics::Serve(u64 client)
+{
+	char buf[4096];
+	NetRecvAny(client, buf, sizeof(buf));
+	cs.Enter();
+	std::string body = text;
+	cs.Leave();
+	char hdr[256];
+	sprintf(hdr, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %llu\r\nConnection: close\r\n\r\n", (u64)body.size());
+	std::string resp = hdr + body;
+	NetSend(client, (void*)resp.data(), (int)resp.size());
+	NetClose(client);
+}
+
+//executes in separate thread
+void TMetrics::Execute()
+{
+	while (!stop)
+	{
+		//wait with timeout to check stop flag
+		u64 client = NetAccept(sock, 200);
+		if (client != NET_INVALID_SOCKET)
+			Serve(client);
+	}
+}
+
+void TMetrics::AddHeader(std::string& out, const char* name, const char* type, const char* help)
+{
+	out += "# HELP ";
+	out += name;
+	out += " ";
+	out += help;
+	out += "\n# TYPE ";
+	out += name;
+	out += " ";
+	out += type;
+	out += "\n";
+}
+
+void TMetrics::AddValue(std::string& out, const char* name, const char* labels, double val)
+{
+	char s[512];
+	if (labels && labels[0])
+		sprintf(s, "%s{%s} %.17g\n", name, labels, val);
+	else
+		sprintf(s, "%s %.17g\n", name, val);
+	out += s;
+}
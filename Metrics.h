@@ -0,0 +1,55 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include "utils.h"
+
+//metrics in Prometheus text format
+//hot paths update only atomic counters and histograms, text is built by main thread every few seconds
+//text is written to a file (for node_exporter textfile collector) and/or served by a tiny HTTP server on localhost
+
+#define HIST_BUCKET_CNT		16
+
+//latency histogram in microseconds with fixed buckets, exported in seconds
+class THistogram
+{
+private:
+	std::atomic<u64> counts[HIST_BUCKET_CNT + 1]; //last one is +Inf
+	std::atomic<u64> sum;
+public:
+	THistogram();
+	void Add(u64 val_us);
+	void Export(std::string& out, const char* name, const char* help);
+};
+
+class TMetrics
+{
+private:
+	CriticalSection cs;
+	std::string text;
+	char file_name[1024];
+	int port;
+	u64 sock; //listening socket
+	HHANDLER thr;
+	bool thr_started;
+	volatile bool stop;
+	void Serve(u64 client);
+public:
+	TMetrics();
+	~TMetrics();
+	bool Start(char* _file_name, int _port);
+	void Stop();
+	bool IsActive() { return file_name[0] || thr_started; }
+	//new snapshot of all metrics
+	void Publish(std::string& txt);
+	void Execute();
+
+	static void AddHeader(std::string& out, const char* name, const char* type, const char* help);
+	static void AddValue(std::string& out, const char* name, const char* labels, double val);
+};
@@ -0,0 +1,339 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#pragma comment(lib, "ws2_32.lib")
+	#define CLOSE_SOCKET		closesocket
+	typedef int socklen_t;
+#else
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <arpa/inet.h>
+	#include <netdb.h>
+	#include <poll.h>
+	#include <stdlib.h>
+	#define CLOSE_SOCKET		close
+	#define INVALID_SOCKET		(-1)
+	typedef int SOCKET;
+#endif
+
+#include "Net.h"
+
+void NetMakeHello(TNetHello* hello, EcPoint* pnts, int cnt, int range, int dp)
+{
+	memset(hello, 0, sizeof(TNetHello));
+	memcpy(hello->magic, NET_MAGIC, 4);
+	hello->version = NET_VERSION;
+	hello->range = range;
+	hello->dp = dp;
+	hello->target_cnt = cnt;
+	u64 h = 0xCBF29CE484222325ull;
+	for (int i = 0; i < cnt; i++)
+	{
+		u8 buf[4 + 64];
+		*(u32*)buf = i;
+		pnts[i].SaveToBuffer64(buf + 4);
+		for (int j = 0; j < (int)sizeof(buf); j++)
+			h = (h ^ buf[j]) * 0x100000001B3ull;
+	}
+	hello->pnts_hash = h;
+}
+
+bool NetInit()
+{
+#ifdef _WIN32
+	WSADATA wsa;
+	return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+#else
+	return true;
+#endif
+}
+
+void NetDeInit()
+{
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+static void SetSockTimeout(SOCKET s, int ms)
+{
+#ifdef _WIN32
+	DWORD tm = ms;
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (char*)&tm, sizeof(tm));
+	setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (char*)&tm, sizeof(tm));
+#else
+	timeval tm;
+	tm.tv_sec = ms / 1000;
+	tm.tv_usec = (ms % 1000) * 1000;
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tm, sizeof(tm));
+	setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tm, sizeof(tm));
+#endif
+}
+
+//splits "host:port" or "port", host is empty for "port"
+static bool ParseAddr(char* addr, char* host, char* port)
+{
+	char* p = strrchr(addr, ':');
+	if (p)
+	{
+		if ((p - addr) >= 256)
+			return false;
+		memcpy(host, addr, p - addr);
+		host[p - addr] = 0;
+		strcpy(port, p + 1);
+	}
+	else
+	{
+		host[0] = 0;
+		strcpy(port, addr);
+	}
+	return atoi(port) > 0;
+}
+
+#ifndef _WIN32
+static bool GetUnixAddr(char* addr, sockaddr_un* un)
+{
+	if (strncmp(addr, "unix:", 5) || (strlen(addr + 5) >= sizeof(un->sun_path)))
+		return false;
+	memset(un, 0, sizeof(sockaddr_un));
+	un->sun_family = AF_UNIX;
+	strcpy(un->sun_path, addr + 5);
+	return true;
+}
+#endif
+
+u64 NetListen(char* addr, bool local_only)
+{
+	SOCKET s;
+#ifndef _WIN32
+	sockaddr_un un;
+	if (GetUnixAddr(addr, &un))
+	{
+		unlink(un.sun_path);
+		s = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (s == INVALID_SOCKET)
+			return NET_INVALID_SOCKET;
+		if (bind(s, (sockaddr*)&un, sizeof(un)) || listen(s, 16))
+		{
+			CLOSE_SOCKET(s);
+			return NET_INVALID_SOCKET;
+		}
+		return (u64)s;
+	}
+#endif
+	char host[256], port[256];
+	if (!ParseAddr(addr, host, port))
+		return NET_INVALID_SOCKET;
+	sockaddr_in sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons((u16)atoi(port));
+	sa.sin_addr.s_addr = htonl(local_only ? INADDR_LOOPBACK : INADDR_ANY);
+	if (host[0] && (inet_pton(AF_INET, host, &sa.sin_addr) != 1))
+		return NET_INVALID_SOCKET;
+	s = socket(AF_INET, SOCK_STREAM, 0);
+	if (s == INVALID_SOCKET)
+		return NET_INVALID_SOCKET;
+	int opt = 1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+	if (bind(s, (sockaddr*)&sa, sizeof(sa)) || listen(s, 16))
+	{
+		CLOSE_SOCKET(s);
+		return NET_INVALID_SOCKET;
+	}
+	return (u64)s;
+}
+
+u64 NetConnect(char* addr)
+{
+	SOCKET s;
+#ifndef _WIN32
+	sockaddr_un un;
+	if (GetUnixAddr(addr, &un))
+	{
+		s = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (s == INVALID_SOCKET)
+			return NET_INVALID_SOCKET;
+		if (connect(s, (sockaddr*)&un, sizeof(un)))
+		{
+			CLOSE_SOCKET(s);
+			return NET_INVALID_SOCKET;
+		}
+		SetSockTimeout(s, NET_TIMEOUT_MS);
+		return (u64)s;
+	}
+#endif
+	char host[256], port[256];
+	if (!ParseAddr(addr, host, port))
+		return NET_INVALID_SOCKET;
+	addrinfo hints, *res;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host[0] ? host : "127.0.0.1", port, &hints, &res))
+		return NET_INVALID_SOCKET;
+	s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if (s == INVALID_SOCKET)
+	{
+		freeaddrinfo(res);
+		return NET_INVALID_SOCKET;
+	}
+	bool ok = connect(s, res->ai_addr, (int)res->ai_addrlen) == 0;
+	freeaddrinfo(res);
+	if (!ok)
+	{
+		CLOSE_SOCKET(s);
+		return NET_INVALID_SOCKET;
+	}
+	int opt = 1;
+	setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char*)&opt, sizeof(opt));
+	SetSockTimeout(s, NET_TIMEOUT_MS);
+	return (u64)s;
+}
+
+int NetWait(u64 sock, int timeout_ms)
+{
+#ifdef _WIN32
+	fd_set fds;
+	FD_ZERO(&fds);
+	FD_SET((SOCKET)sock, &fds);
+	timeval tv;
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	int res = select(0, &fds, NULL, NULL, &tv);
+#else
+	pollfd pfd;
+	pfd.fd = (int)sock;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	int res = poll(&pfd, 1, timeout_ms);
+#endif
+	if (res < 0)
+		return -1;
+	return res ? 1 : 0;
+}
+
+u64 NetAccept(u64 sock, int timeout_ms)
+{
+	if (NetWait(sock, timeout_ms) <= 0)
+		return NET_INVALID_SOCKET;
+	SOCKET s = accept((SOCKET)sock, NULL, NULL);
+	if (s == INVALID_SOCKET)
+		return NET_INVALID_SOCKET;
+	SetSockTimeout(s, NET_TIMEOUT_MS);
+	return (u64)s;
+}
+
+bool NetSend(u64 sock, void* data, int size)
+{
+	char* p = (char*)data;
+	while (size > 0)
+	{
+#ifdef _WIN32
+		int len = send((SOCKET)sock, p, size, 0);
+#else
+		int len = (int)send((SOCKET)sock, p, size, MSG_NOSIGNAL);
+#endif
+		if (len <= 0)
+			return false;
+		p += len;
+		size -= len;
+	}
+	return true;
+}
+
+bool NetRecv(u64 sock, void* data, int size)
+{
+	char* p = (char*)data;
+	while (size > 0)
+	{
+		int len = (int)recv((SOCKET)sock, p, size, 0);
+		if (len <= 0)
+			return false;
+		p += len;
+		size -= len;
+	}
+	return true;
+}
+
+int NetRecvAny(u64 sock, void* data, int size)
+{
+	int len = (int)recv((SOCKET)sock, (char*)data, size, 0);
+	return (len < 0) ? -1 : len;
+}
+
+void NetClose(u64 sock)
+{
+	if (sock != NET_INVALID_SOCKET)
+		CLOSE_SOCKET((SOCKET)sock);
+}
+
+//number of low bytes of d that restore it with sign extension
+static int GetDistLen(u8* d)
+{
+	u8 ext = (d[21] & 0x80) ? 0xFF : 0x00;
+	int len = 22;
+	while ((len > 1) && (d[len - 1] == ext) && ((d[len - 2] & 0x80) == (ext & 0x80)))
+		len--;
+	return len;
+}
+
+//payload: dlen(1), then cnt * (x(12), d(dlen), type(1))
+int PackDPs(DBRec* recs, int cnt, u8* out)
+{
+	int dlen = 1;
+	for (int i = 0; i < cnt; i++)
+	{
+		int len = GetDistLen(recs[i].d);
+		if (len > dlen)
+			dlen = len;
+	}
+	u8* p = out;
+	*p++ = (u8)dlen;
+	for (int i = 0; i < cnt; i++)
+	{
+		memcpy(p, recs[i].x, 12);
+		p += 12;
+		memcpy(p, recs[i].d, dlen);
+		p += dlen;
+		*p++ = recs[i].type;
+	}
+	return (int)(p - out);
+}
+
+bool UnpackDPs(u8* data, int size, int cnt, int target_cnt, u8* out)
+{
+	if (size < 1)
+		return false;
+	int dlen = data[0];
+	if ((dlen < 1) || (dlen > 22) || (size != 1 + cnt * (13 + dlen)))
+		return false;
+	u8* p = data + 1;
+	for (int i = 0; i < cnt; i++)
+	{
+		u8* rec = out + i * GPU_DP_SIZE;
+		memset(rec, 0, GPU_DP_SIZE);
+		memcpy(rec, p, 12);
+		p += 12;
+		memcpy(rec + 16, p, dlen);
+		if (p[dlen - 1] & 0x80)
+			memset(rec + 16 + dlen, 0xFF, 24 - dlen);
+		p += dlen;
+		//db type byte is kind | target << 2, gpu format is kind | target << 16
+		u8 type = *p++;
+		if (((type & 3) > WILD2) || ((type >> 2) >= target_cnt))
+			return false;
+		rec[40] = type & 3;
+		rec[42] = type >> 2;
+		*(u32*)(rec + 44) = DP_KANG_UNKNOWN;
+	}
+	return true;
+}
@@ -0,0 +1,70 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+#include "Ec.h"
+
+//sockets wrapper and DP server protocol
+//address is "port", "host:port" or "unix:/path" (Linux only)
+//protocol: client sends TNetHello, server replies NET_MSG_HELLO_OK or NET_MSG_HELLO_BAD, then messages TNetMsgHdr + payload
+//client sends NET_MSG_DPS with packed DPs and ops done since previous message, server sends NET_MSG_SOLVED with mask of solved points
+
+#define NET_INVALID_SOCKET	((u64)-1)
+
+#define NET_MAGIC			"RCDP"
+#define NET_VERSION			2
+
+#define NET_MSG_HELLO_OK	1
+#define NET_MSG_HELLO_BAD	2
+#define NET_MSG_DPS			3
+#define NET_MSG_SOLVED		4
+
+#define NET_MAX_BATCH		(64 * 1024) //DPs in one message
+#define NET_TIMEOUT_MS		30000
+
+#pragma pack(push, 1)
+struct TNetHello
+{
+	char magic[4];
+	u32 version;
+	u32 range;
+	u32 dp;
+	u32 target_cnt;
+	u64 pnts_hash; //FNV-1a of ordered points to solve, target index in DPs must mean the same point on both sides
+};
+
+struct TNetMsgHdr
+{
+	u32 type;
+	u32 cnt; //NET_MSG_DPS: number of DPs
+	u64 val; //NET_MSG_DPS: ops, NET_MSG_SOLVED: solved mask
+	u32 size; //payload size
+};
+#pragma pack(pop)
+
+//both sides make hello from the task, server accepts only clients with the same task
+void NetMakeHello(TNetHello* hello, EcPoint* pnts, int cnt, int range, int dp);
+
+bool NetInit();
+void NetDeInit();
+u64 NetListen(char* addr, bool local_only);
+u64 NetConnect(char* addr);
+//returns NET_INVALID_SOCKET on timeout
+u64 NetAccept(u64 sock, int timeout_ms);
+//1 - data can be read, 0 - timeout, -1 - error
+int NetWait(u64 sock, int timeout_ms);
+bool NetSend(u64 sock, void* data, int size);
+bool NetRecv(u64 sock, void* data, int size);
+//reads what is available, returns number of bytes or -1
+int NetRecvAny(u64 sock, void* data, int size);
+void NetClose(u64 sock);
+
+//DPs are sent as DBRec fields: x, d, type. Distances are short for real ranges so only low bytes of d are sent (sign-extended)
+int PackDPs(DBRec* recs, int cnt, u8* out);
+//output is in GPU DP format, returns false if payload size, kangaroo kind or target index (must be less than target_cnt) is invalid
+bool UnpackDPs(u8* data, int size, int cnt, int target_cnt, u8* out);
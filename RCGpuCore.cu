@@ -487,7 +487,9 @@ __device__ __forceinline__ void BuildDP(const TKparams& Kparams, int kang_ind, u
 	*(int4*)&DPs[0] = rx;
 	*(int4*)&DPs[4] = ((int4*)d)[0];
 	*(u64*)&DPs[8] = d[2];
-	DPs[10] = 3 * kang_ind / Kparams.KangCnt; //kang type
+	u32 kind = (kang_ind < Kparams.TameCnt) ? TAME : ((kang_ind < Kparams.TameCnt + Kparams.Wild1Cnt) ? WILD1 : WILD2);
+	DPs[10] = kind | ((kang_ind % Kparams.TargetCnt) << 16); //kang type and target
+	DPs[11] = kang_ind | (Kparams.WorkerInd << DP_KANG_BITS);
 }
 
 __device__ __forceinline__ bool ProcessJumpDistance(u32 step_ind, u32 d_cur, u64* d, u32 kang_ind, u64* jmp1_d, u64* jmp2_d, const TKparams& Kparams, u64* table, u32* cur_ind, u8 iter)
@@ -801,6 +803,54 @@ __device__ __forceinline__ void DoublePoint(u64* res_x, u64* res_y, u64* pntx, u
 	SubModP(res_y, tmp2, pnty);
 }
 
+//calculates d * G, adds (x0, y0) if add is set, returns false for zero distance
+__device__ __forceinline__ bool GenPoint(u64* x, u64* y, u64* d, u64* x0, u64* y0, bool add)
+{
+	__align__(16) u64 tx[4], ty[4];
+	__align__(16) u64 t2x[4], t2y[4];
+
+	tx[0] = GX_0; tx[1] = GX_1; tx[2] = GX_2; tx[3] = GX_3;
+	ty[0] = GY_0; ty[1] = GY_1; ty[2] = GY_2; ty[3] = GY_3;
+
+	bool first = true;
+	int n = 2;
+	while ((n >= 0) && !d[n]) 
+		n--;
+	if (n < 0)
+		return false; //error
+	int index = __clzll(d[n]);
+	for (int i = 0; i <= 64 * n + (63 - index); i++)
+	{
+		u8 v = (d[i / 64] >> (i % 64)) & 1;
+		if (v)
+		{
+			if (first)
+			{
+				first = false;
+				Copy_u64_x4(x, tx);
+				Copy_u64_x4(y, ty);
+			}
+			else
+			{
+				AddPoints(t2x, t2y, x, y, tx, ty);
+				Copy_u64_x4(x, t2x);
+				Copy_u64_x4(y, t2y);
+			}
+		}
+		DoublePoint(t2x, t2y, tx, ty);
+		Copy_u64_x4(tx, t2x);
+		Copy_u64_x4(ty, t2y);
+	}
+
+	if (add)
+	{
+		AddPoints(t2x, t2y, x, y, x0, y0);
+		Copy_u64_x4(x, t2x);
+		Copy_u64_x4(y, t2y);
+	}
+	return true;
+}
+
 //this kernel calculates start points of kangs
 extern "C" __launch_bounds__(BLOCK_SIZE, 1)
 __global__ void KernelGen(const TKparams Kparams)
@@ -809,8 +859,6 @@ __global__ void KernelGen(const TKparams Kparams)
 	{
 		__align__(16) u64 x0[4], y0[4], d[3];
 		__align__(16) u64 x[4], y[4];
-		__align__(16) u64 tx[4], ty[4];
-		__align__(16) u64 t2x[4], t2y[4];
 
 		u32 kang_ind = PNT_GROUP_CNT * (THREAD_X + BLOCK_X * BLOCK_SIZE) + group;
 		x0[0] = Kparams.Kangs[kang_ind * 12 + 0];
@@ -824,47 +872,48 @@ __global__ void KernelGen(const TKparams Kparams)
 		d[0] = Kparams.Kangs[kang_ind * 12 + 8];
 		d[1] = Kparams.Kangs[kang_ind * 12 + 9];
 		d[2] = Kparams.Kangs[kang_ind * 12 + 10];
-		
-		tx[0] = GX_0; tx[1] = GX_1; tx[2] = GX_2; tx[3] = GX_3;
-		ty[0] = GY_0; ty[1] = GY_1; ty[2] = GY_2; ty[3] = GY_3;
-
-		bool first = true;
-		int n = 2;
-		while ((n >= 0) && !d[n]) 
-			n--;
-		if (n < 0)
+
+		if (!GenPoint(x, y, d, x0, y0, !Kparams.IsGenMode && (kang_ind >= Kparams.TameCnt)))
 			continue; //error
-		int index = __clzll(d[n]);
-		for (int i = 0; i <= 64 * n + (63 - index); i++)
-		{
-			u8 v = (d[i / 64] >> (i % 64)) & 1;
-			if (v)
-			{
-				if (first)
-				{
-					first = false;
-					Copy_u64_x4(x, tx);
-					Copy_u64_x4(y, ty);
-				}
-				else
-				{
-					AddPoints(t2x, t2y, x, y, tx, ty);
-					Copy_u64_x4(x, t2x);
-					Copy_u64_x4(y, t2y);
-				}
-			}
-			DoublePoint(t2x, t2y, tx, ty);
-			Copy_u64_x4(tx, t2x);
-			Copy_u64_x4(ty, t2y);
-		}
 
-		if (!Kparams.IsGenMode)
-			if (kang_ind >= Kparams.KangCnt / 3)
-			{
-				AddPoints(t2x, t2y, x, y, x0, y0);
-				Copy_u64_x4(x, t2x);
-				Copy_u64_x4(y, t2y);
-			}
+		Kparams.Kangs[kang_ind * 12 + 0] = x[0];
+		Kparams.Kangs[kang_ind * 12 + 1] = x[1];
+		Kparams.Kangs[kang_ind * 12 + 2] = x[2];
+		Kparams.Kangs[kang_ind * 12 + 3] = x[3];
+		Kparams.Kangs[kang_ind * 12 + 4] = y[0];
+		Kparams.Kangs[kang_ind * 12 + 5] = y[1];
+		Kparams.Kangs[kang_ind * 12 + 6] = y[2];
+		Kparams.Kangs[kang_ind * 12 + 7] = y[3];
+	}
+}
+
+//this kernel restarts listed kangs: GenList is count and kang indexes, GenPnts has x0, y0, distance for every listed kang
+//it's called between KernelABC calls, so kangs are in global memory
+extern "C" __launch_bounds__(BLOCK_SIZE, 1)
+__global__ void KernelGenList(const TKparams Kparams)
+{
+	u32 cnt = Kparams.GenList[0];
+	for (u32 i = THREAD_X + BLOCK_X * BLOCK_SIZE; i < cnt; i += BLOCK_CNT * BLOCK_SIZE)
+	{
+		__align__(16) u64 x0[4], y0[4], d[3];
+		__align__(16) u64 x[4], y[4];
+
+		u32 kang_ind = Kparams.GenList[1 + i];
+		u64* src = Kparams.GenPnts + i * 12;
+		x0[0] = src[0];
+		x0[1] = src[1];
+		x0[2] = src[2];
+		x0[3] = src[3];
+		y0[0] = src[4];
+		y0[1] = src[5];
+		y0[2] = src[6];
+		y0[3] = src[7];
+		d[0] = src[8];
+		d[1] = src[9];
+		d[2] = src[10];
+
+		if (!GenPoint(x, y, d, x0, y0, !Kparams.IsGenMode && (kang_ind >= Kparams.TameCnt)))
+			continue; //error
 
 		Kparams.Kangs[kang_ind * 12 + 0] = x[0];
 		Kparams.Kangs[kang_ind * 12 + 1] = x[1];
@@ -874,6 +923,16 @@ __global__ void KernelGen(const TKparams Kparams)
 		Kparams.Kangs[kang_ind * 12 + 5] = y[1];
 		Kparams.Kangs[kang_ind * 12 + 6] = y[2];
 		Kparams.Kangs[kang_ind * 12 + 7] = y[3];
+		Kparams.Kangs[kang_ind * 12 + 8] = d[0];
+		Kparams.Kangs[kang_ind * 12 + 9] = d[1];
+		Kparams.Kangs[kang_ind * 12 + 10] = d[2];
+
+		//new start, so L1S2 flag is cleared like in KernelC
+#ifndef OLD_GPU
+		atomicAnd(&Kparams.L1S2[kang_ind / PNT_GROUP_CNT], ~(1u << (kang_ind % PNT_GROUP_CNT)));
+#else
+		atomicAnd(&((u64*)Kparams.L1S2)[kang_ind / PNT_GROUP_CNT], ~(1ull << (kang_ind % PNT_GROUP_CNT)));
+#endif
 	}
 }
 
@@ -891,6 +950,11 @@ void CallGpuKernelGen(TKparams Kparams)
 	KernelGen << < Kparams.BlockCnt, Kparams.BlockSize, 0 >> > (Kparams);
 }
 
+void CallGpuKernelGenList(TKparams Kparams)
+{
+	KernelGenList << < Kparams.BlockCnt, Kparams.BlockSize, 0 >> > (Kparams);
+}
+
 cudaError_t cuSetGpuParams(TKparams Kparams, u64* _jmp2_table)
 {
 	cudaError_t err = cudaFuncSetAttribute(KernelA, cudaFuncAttributeMaxDynamicSharedMemorySize, Kparams.KernelA_LDS_Size);
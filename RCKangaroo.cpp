@@ -13,6 +13,7 @@
 #include <time.h> 
 #include <inttypes.h>
 #include <stdint.h>
+#include <signal.h>
 
 #include "cuda_runtime.h"
 #include "cuda.h"
@@ -20,6 +21,14 @@
 #include "defs.h"
 #include "utils.h"
 #include "GpuKang.h"
+#include "TamesFile.h"
+#include "Bench.h"
+#include "SynthKang.h"
+#include "Metrics.h"
+#include "DPServer.h"
+#include "KangarooSolver.h"
+#include "JobSpool.h"
+#include "SelfTest.h"
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -28,54 +37,58 @@
 time_t program_start_time = time(NULL);  // Capture the start time
 
 
-EcJMP EcJumps1[JMP_CNT];
-EcJMP EcJumps2[JMP_CNT];
-EcJMP EcJumps3[JMP_CNT];
-
-RCGpuKang* GpuKangs[MAX_GPU_CNT];
+RCKangWorker* GpuKangs[MAX_GPU_CNT];
 int GpuCnt;
-volatile long ThrCnt;
-volatile bool gSolved;
-
-EcInt Int_HalfRange;
-EcPoint Pnt_HalfRange;
-EcPoint Pnt_NegHalfRange;
-EcInt Int_TameOffset;
 Ec ec;
-
-CriticalSection csAddPoints;
-u8* pPntList;
-u8* pPntList2;
-volatile int PntIndex;
-TFastBase db;
-EcPoint gPntToSolve;
-EcInt gPrivKey;
+TKangarooSolver gSolver;
 
 volatile u64 TotalOps;
 u32 TotalSolved;
-u32 gTotalErrors;
-u64 PntTotalOps;
 bool IsBench;
 
 u32 gDP;
 u32 gRange;
 EcInt gStart;
 bool gStartSet;
-EcPoint gPubKey;
+EcInt gStride; //keys are start + stride * i, points are divided by stride so solver range is smaller
+bool gStrideSet;
+EcPoint gPubKeys[MAX_TARGET_CNT];
+int gPubKeyCnt;
+char gPubKeysFileName[1024];
 u8 gGPUs_Mask[MAX_GPU_CNT];
 char gTamesFileName[1024];
 double gMax;
 bool gGenMode; //tames generation mode
-bool gIsOpsLimit;
-
-#pragma pack(push, 1)
-struct DBRec
-{
-	u8 x[12];
-	u8 d[22];
-	u8 type; //0 - tame, 1 - wild1, 2 - wild2
-};
-#pragma pack(pop)
+bool gExtendMode; //tames generation mode, new tames are added to existing tames file
+bool gTamesCompress; //save tames in compressed format
+char gJournalFileName[1024];
+u32 gTamesSizeMB; //max size of saved tames file, most reached tames are selected, 0 - save all tames
+u32 gSpillMB; //RAM budget for tames generation with spilling to disk, 0 - keep all tames in RAM
+u32 gBenchCnt; //number of measured solves in benchmark mode, 0 - infinite
+u32 gBenchWarmup; //first solves are not included in benchmark results
+bool gSeedSet;
+u64 gSeed;
+TRndGen gKeyRnd; //bench keys, workers have their own generators
+char gReportFileName[1024];
+TBenchReport gBench;
+u32 gSynthCnt; //number of synthetic workers, 0 - use GPUs
+TSynthParams gSynthParams;
+char gMetricsFileName[1024];
+int gMetricsPort;
+TMetrics gMetrics;
+char gDPServerAddr[256];
+char gDPClientAddr[256];
+RCDPServer* gDPServer; //one of workers
+THerd gHerd; //from -herd option
+bool gHerdSet;
+bool gHerdAuto;
+bool gWildRestart; //wild kangs start from new random points after every DP
+bool gResume;
+bool gAutoDP; //DP is selected by planner for every point
+double gRamGB; //RAM budget for DB, 0 - part of physical RAM
+char gDaemonDir[1024]; //spool directory with jobs, daemon mode
+bool gSelfTest;
+TJobSpool gSpool;
 
 void InitGpus()
 {
@@ -121,87 +134,39 @@ void InitGpus()
 
 		cudaSetDeviceFlags(cudaDeviceScheduleBlockingSync);
 
-		GpuKangs[GpuCnt] = new RCGpuKang();
-		GpuKangs[GpuCnt]->CudaIndex = i;
-		GpuKangs[GpuCnt]->persistingL2CacheMaxSize = deviceProp.persistingL2CacheMaxSize;
-		GpuKangs[GpuCnt]->mpCnt = deviceProp.multiProcessorCount;
-		GpuKangs[GpuCnt]->IsOldGpu = deviceProp.l2CacheSize < 16 * 1024 * 1024;
-		GpuCnt++;
+		RCGpuKang* Kang = new RCGpuKang();
+		Kang->CudaIndex = i;
+		Kang->WorkerInd = GpuCnt;
+		Kang->persistingL2CacheMaxSize = deviceProp.persistingL2CacheMaxSize;
+		Kang->mpCnt = deviceProp.multiProcessorCount;
+		Kang->IsOldGpu = deviceProp.l2CacheSize < 16 * 1024 * 1024;
+		GpuKangs[GpuCnt++] = Kang;
 	}
 	printf("GPUs Found: %d\r\n", GpuCnt);
 }
-#ifdef _WIN32
-u32 __stdcall kang_thr_proc(void* data)
-{
-	RCGpuKang* Kang = (RCGpuKang*)data;
-	Kang->Execute();
-	InterlockedDecrement(&ThrCnt);
-	return 0;
-}
-#else
-void* kang_thr_proc(void* data)
-{
-	RCGpuKang* Kang = (RCGpuKang*)data;
-	Kang->Execute();
-	__sync_fetch_and_sub(&ThrCnt, 1);
-	return 0;
-}
-#endif
-void AddPointsToList(u32* data, int pnt_cnt, u64 ops_cnt)
+
+//synthetic workers are used instead of GPUs to load test DPs processing
+void InitSynth()
 {
-	csAddPoints.Enter();
-	if (PntIndex + pnt_cnt >= MAX_CNT_LIST)
+	for (GpuCnt = 0; GpuCnt < (int)gSynthCnt; GpuCnt++)
 	{
-		csAddPoints.Leave();
-		printf("DPs buffer overflow, some points lost, increase DP value!\r\n");
-		return;
+		RCSynthKang* Kang = new RCSynthKang();
+		Kang->CudaIndex = GpuCnt;
+		Kang->WorkerInd = GpuCnt;
+		Kang->Params = gSynthParams;
+		GpuKangs[GpuCnt] = Kang;
 	}
-	memcpy(pPntList + GPU_DP_SIZE * PntIndex, data, pnt_cnt * GPU_DP_SIZE);
-	PntIndex += pnt_cnt;
-	PntTotalOps += ops_cnt;
-	csAddPoints.Leave();
+	printf("Synthetic workers: %d\r\n", GpuCnt);
 }
 
-bool Collision_SOTA(EcPoint& pnt, EcInt t, int TameType, EcInt w, int WildType, bool IsNeg)
+//DP server is added to local GPUs, it works without GPUs too
+void InitDPServer()
 {
-	if (IsNeg)
-		t.Neg();
-	if (TameType == TAME)
-	{
-		gPrivKey = t;
-		gPrivKey.Sub(w);
-		EcInt sv = gPrivKey;
-		gPrivKey.Add(Int_HalfRange);
-		EcPoint P = ec.MultiplyG(gPrivKey);
-		if (P.IsEqual(pnt))
-			return true;
-		gPrivKey = sv;
-		gPrivKey.Neg();
-		gPrivKey.Add(Int_HalfRange);
-		P = ec.MultiplyG(gPrivKey);
-		return P.IsEqual(pnt);
-	}
-	else
-	{
-		gPrivKey = t;
-		gPrivKey.Sub(w);
-		if (gPrivKey.data[4] >> 63)
-			gPrivKey.Neg();
-		gPrivKey.ShiftRight(1);
-		EcInt sv = gPrivKey;
-		gPrivKey.Add(Int_HalfRange);
-		EcPoint P = ec.MultiplyG(gPrivKey);
-		if (P.IsEqual(pnt))
-			return true;
-		gPrivKey = sv;
-		gPrivKey.Neg();
-		gPrivKey.Add(Int_HalfRange);
-		P = ec.MultiplyG(gPrivKey);
-		return P.IsEqual(pnt);
-	}
+	gDPServer = new RCDPServer(gDPServerAddr);
+	gDPServer->CudaIndex = GpuCnt;
+	gDPServer->WorkerInd = GpuCnt;
+	GpuKangs[GpuCnt++] = gDPServer;
 }
-
-
 void trim_leading_zeros(char* str) {
 	char* non_zero = str;
 	while (*non_zero == '0' && *(non_zero + 1) != '\0') {
@@ -212,389 +177,123 @@ void trim_leading_zeros(char* str) {
 	}
 }
 
-void CheckNewPoints()
+//executes in solver thread, so DB and workers can be accessed safely
+void UpdateMetrics(void* ctx, TKangarooSolver* solver)
 {
-	csAddPoints.Enter();
-	if (!PntIndex)
-	{
-		csAddPoints.Leave();
+	if (!gMetrics.IsActive())
 		return;
-	}
-
-	int cnt = PntIndex;
-	memcpy(pPntList2, pPntList, GPU_DP_SIZE * cnt);
-	PntIndex = 0;
-	csAddPoints.Leave();
-
-	for (int i = 0; i < cnt; i++)
+	std::string s;
+	solver->ExportMetrics(s);
+	if (gDPServer)
 	{
-		DBRec nrec;
-		u8* p = pPntList2 + i * GPU_DP_SIZE;
-		memcpy(nrec.x, p, 12);
-		memcpy(nrec.d, p + 16, 22);
-		nrec.type = gGenMode ? TAME : p[40];
-
-		DBRec* pref = (DBRec*)db.FindOrAddDataBlock((u8*)&nrec);
-		if (gGenMode)
-			continue;
-		if (pref)
-		{
-			//in db we dont store first 3 bytes so restore them
-			DBRec tmp_pref;
-			memcpy(&tmp_pref, &nrec, 3);
-			memcpy(((u8*)&tmp_pref) + 3, pref, sizeof(DBRec) - 3);
-			pref = &tmp_pref;
-
-			if (pref->type == nrec.type)
-			{
-				if (pref->type == TAME)
-					continue;
-
-				//if it's wild, we can find the key from the same type if distances are different
-				if (*(u64*)pref->d == *(u64*)nrec.d)
-					continue;
-				//else
-				//	ToLog("key found by same wild");
-			}
-
-			EcInt w, t;
-			int TameType, WildType;
-			if (pref->type != TAME)
-			{
-				memcpy(w.data, pref->d, sizeof(pref->d));
-				if (pref->d[21] == 0xFF) memset(((u8*)w.data) + 22, 0xFF, 18);
-				memcpy(t.data, nrec.d, sizeof(nrec.d));
-				if (nrec.d[21] == 0xFF) memset(((u8*)t.data) + 22, 0xFF, 18);
-				TameType = nrec.type;
-				WildType = pref->type;
-			}
-			else
-			{
-				memcpy(w.data, nrec.d, sizeof(nrec.d));
-				if (nrec.d[21] == 0xFF) memset(((u8*)w.data) + 22, 0xFF, 18);
-				memcpy(t.data, pref->d, sizeof(pref->d));
-				if (pref->d[21] == 0xFF) memset(((u8*)t.data) + 22, 0xFF, 18);
-				TameType = TAME;
-				WildType = nrec.type;
-			}
-
-			bool res = Collision_SOTA(gPntToSolve, t, TameType, w, WildType, false) || Collision_SOTA(gPntToSolve, t, TameType, w, WildType, true);
-			if (!res)
-			{
-				bool w12 = ((pref->type == WILD1) && (nrec.type == WILD2)) || ((pref->type == WILD2) && (nrec.type == WILD1));
-				if (w12) //in rare cases WILD and WILD2 can collide in mirror, in this case there is no way to find K
-					;// ToLog("W1 and W2 collides in mirror");
-				else
-				{
-					printf("Collision Error\r\n");
-					gTotalErrors++;
-				}
-				continue;
-			}
-			gSolved = true;
-			break;
-		}
+		TMetrics::AddHeader(s, "rck_dpserver_clients", "gauge", "Connected DP clients.");
+		TMetrics::AddValue(s, "rck_dpserver_clients", NULL, gDPServer->GetClientCnt());
 	}
+	TMetrics::AddHeader(s, "rck_uptime_seconds", "gauge", "Time since start.");
+	TMetrics::AddValue(s, "rck_uptime_seconds", NULL, (double)(time(NULL) - program_start_time));
+	gMetrics.Publish(s);
 }
 
-void ShowStats(u64 tm_start, double exp_ops, double dp_val)
-{
-#ifdef DEBUG_MODE
-	for (int i = 0; i <= MD_LEN; i++)
-	{
-		u64 val = 0;
-		for (int j = 0; j < GpuCnt; j++)
-		{
-			val += GpuKangs[j]->dbg[i];
-		}
-		if (val)
-			printf("Loop size %d: %llu\r\n", i, val);
-	}
-#endif
-
-	int speed = GpuKangs[0]->GetStatsSpeed();
-	for (int i = 1; i < GpuCnt; i++)
-		speed += GpuKangs[i]->GetStatsSpeed();
-
-	u64 est_dps_cnt = (u64)(exp_ops / dp_val);
-	u64 exp_sec = 0xFFFFFFFFFFFFFFFFull;
-
-	if (speed)
-		exp_sec = (u64)((exp_ops / 1000000) / speed);  // Expected time in seconds
-
-	// Expected Time Breakdown
-	u64 exp_days = exp_sec / (3600 * 24);
-	int exp_hours = (int)(exp_sec % (3600 * 24)) / 3600;
-	int exp_min = (int)(exp_sec % 3600) / 60;
-	int exp_remaining_sec = (int)(exp_sec % 60);  // Expected seconds
-
-	// Elapsed Time Calculation
-	u64 sec = (GetTickCount64() - tm_start) / 1000;  // Elapsed time in seconds
-	u64 days = sec / (3600 * 24);
-	int hours = (int)(sec % (3600 * 24)) / 3600;
-	int min = (int)(sec % 3600) / 60;
-	int remaining_sec = (int)(sec % 60);  // Elapsed seconds
-
-	// Updated printf to include seconds in both elapsed and expected times
-	printf("%sSpeed: %d MKeys/s, Err: %d, DPs: %lluK/%lluK, Time: %llud:%02dh:%02dm:%02ds/%llud:%02dh:%02dm:%02ds\r",
-		gGenMode ? "GEN: " : (IsBench ? "BENCH: " : "MAIN: "),
-		speed, gTotalErrors,
-		db.GetBlockCnt() / 1000, est_dps_cnt / 1000,
-		days, hours, min, remaining_sec,        // Elapsed Time with seconds
-		exp_days, exp_hours, exp_min, exp_remaining_sec  // Expected Time with seconds
-	);
-
-
-	fflush(stdout);  // Force the console to update the line
-
-}
-
-bool SolvePoint(EcPoint PntToSolve, int Range, int DP, EcInt* pk_res)
+//main mode, key is saved as soon as it's found so other points can be solved without the risk to lose it
+bool ReportKey(void* ctx, int target, EcInt& key)
 {
-	if ((Range < 32) || (Range > 180))
-	{
-		printf("Unsupported Range value (%d)!\r\n", Range);
-		return false;
-	}
-	if ((DP < 14) || (DP > 60))
+	EcInt pk_found = key;
+	if (gStrideSet)
+		pk_found.MulModN(gStride);
+	pk_found.AddModN(gStart);
+	EcPoint tmp = ec.MultiplyG(pk_found);
+	if (!tmp.IsEqual(gPubKeys[target]))
 	{
-		printf("Unsupported DP value (%d)!\r\n", DP);
+		printf("FATAL ERROR: SolvePoint found incorrect key\r\n");
 		return false;
 	}
-
-	printf("\r\nSolving point: Range %d bits, DP %d, start...\r\n", Range, DP);
-	double ops = 1.15 * pow(2.0, Range / 2.0);
-	double dp_val = (double)(1ull << DP);
-	double ram = (32 + 4 + 4) * ops / dp_val; //+4 for grow allocation and memory fragmentation
-	ram += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
-	ram /= (1024 * 1024 * 1024); //GB
-	printf("SOTA method, estimated ops: 2^%.3f, RAM for DPs: %.3f GB. DP and GPU overheads not included!\r\n", log2(ops), ram);
-	gIsOpsLimit = false;
-	double MaxTotalOps = 0.0;
-	if (gMax > 0)
+	//happy end
+	char s[100], sx[100];
+	pk_found.GetHexStr(s);
+	trim_leading_zeros(s);
+	gPubKeys[target].x.GetHexStr(sx);
+	bool show_pnt = (gPubKeyCnt > 1) || gDaemonDir[0];
+	if (show_pnt)
+		printf("\r\nPUBLIC KEY X: %s\r\n", sx);
+	printf("\r\nPRIVATE KEY: %s\r\n\r\n", s);
+	FILE* fp = fopen("RESULTS.TXT", "a");
+	if (fp)
 	{
-		MaxTotalOps = gMax * ops;
-		double ram_max = (32 + 4 + 4) * MaxTotalOps / dp_val; //+4 for grow allocation and memory fragmentation
-		ram_max += sizeof(TListRec) * 256 * 256 * 256; //3byte-prefix table
-		ram_max /= (1024 * 1024 * 1024); //GB
-		printf("Max allowed number of ops: 2^%.3f, max RAM for DPs: %.3f GB\r\n", log2(MaxTotalOps), ram_max);
+		if (show_pnt)
+			fprintf(fp, "PUBLIC KEY X: %s\n", sx);
+		fprintf(fp, "PRIVATE KEY: %s\n", s);
+		fclose(fp);
 	}
-
-	u64 total_kangs = GpuKangs[0]->CalcKangCnt();
-	for (int i = 1; i < GpuCnt; i++)
-		total_kangs += GpuKangs[i]->CalcKangCnt();
-	double path_single_kang = ops / total_kangs;
-	double DPs_per_kang = path_single_kang / dp_val;
-	printf("Estimated DPs per kangaroo: %.3f.%s\r\n", DPs_per_kang, (DPs_per_kang < 5) ? " DP overhead is big, use less DP value if possible!" : "");
-
-	if (!gGenMode && gTamesFileName[0])
+	else //we cannot save the key, show error and wait forever so the key is displayed
 	{
-		printf("load tames...\r\n");
-		if (db.LoadFromFile(gTamesFileName))
-		{
-			printf("tames loaded\r\n");
-			if (db.Header[0] != gRange)
-			{
-				printf("loaded tames have different range, they cannot be used, clear\r\n");
-				db.Clear();
-			}
-		}
-		else
-			printf("tames loading failed\r\n");
+		printf("WARNING: Cannot save the key to RESULTS.TXT!\r\n");
+		while (1)
+			Sleep(100);
 	}
+	return true;
+}
 
-	SetRndSeed(0); //use same seed to make tames from file compatible
-	PntTotalOps = 0;
-	PntIndex = 0;
-	//prepare jumps
-	EcInt minjump, t;
-	minjump.Set(1);
-	minjump.ShiftLeft(Range / 2 + 3);
-	for (int i = 0; i < JMP_CNT; i++)
-	{
-		EcJumps1[i].dist = minjump;
-		t.RndMax(minjump);
-		EcJumps1[i].dist.Add(t);
-		EcJumps1[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
-		EcJumps1[i].p = ec.MultiplyG(EcJumps1[i].dist);
-	}
+//first Ctrl-C saves checkpoint and stops, second one kills the process
+void stop_sig_handler(int sig)
+{
+	gSolver.RequestStop();
+	signal(sig, SIG_DFL);
+}
 
-	minjump.Set(1);
-	minjump.ShiftLeft(Range - 10); //large jumps for L1S2 loops. Must be almost RANGE_BITS
-	for (int i = 0; i < JMP_CNT; i++)
-	{
-		EcJumps2[i].dist = minjump;
-		t.RndMax(minjump);
-		EcJumps2[i].dist.Add(t);
-		EcJumps2[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
-		EcJumps2[i].p = ec.MultiplyG(EcJumps2[i].dist);
+char* ensure_hex_prefix(char* str) {
+	if (str[0] != '0' || (str[1] != 'x' && str[1] != 'X')) {
+		static char hex_str[32];
+		snprintf(hex_str, sizeof(hex_str), "0x%s", str);
+		return hex_str;
 	}
+	return str;
+}
 
-	minjump.Set(1);
-	minjump.ShiftLeft(Range - 10 - 2); //large jumps for loops >2
-	for (int i = 0; i < JMP_CNT; i++)
-	{
-		EcJumps3[i].dist = minjump;
-		t.RndMax(minjump);
-		EcJumps3[i].dist.Add(t);
-		EcJumps3[i].dist.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even
-		EcJumps3[i].p = ec.MultiplyG(EcJumps3[i].dist);
-	}
-	SetRndSeed(GetTickCount64());
-
-	Int_HalfRange.Set(1);
-	Int_HalfRange.ShiftLeft(Range - 1);
-	Pnt_HalfRange = ec.MultiplyG(Int_HalfRange);
-	Pnt_NegHalfRange = Pnt_HalfRange;
-	Pnt_NegHalfRange.y.NegModP();
-	Int_TameOffset.Set(1);
-	Int_TameOffset.ShiftLeft(Range - 1);
-	EcInt tt;
-	tt.Set(1);
-	tt.ShiftLeft(Range - 5); //half of tame range width
-	Int_TameOffset.Sub(tt);
-	gPntToSolve = PntToSolve;
-
-	//prepare GPUs
-	for (int i = 0; i < GpuCnt; i++)
-		if (!GpuKangs[i]->Prepare(PntToSolve, Range, DP, EcJumps1, EcJumps2, EcJumps3))
-		{
-			GpuKangs[i]->Failed = true;
-			printf("GPU %d Prepare failed\r\n", GpuKangs[i]->CudaIndex);
-		}
-
-	u64 tm0 = GetTickCount64();
-	printf("GPUs started...\r\n");
-
-#ifdef _WIN32
-	HANDLE thr_handles[MAX_GPU_CNT];
-#else
-	pthread_t thr_handles[MAX_GPU_CNT];
-#endif
-
-	u32 ThreadID;
-	gSolved = false;
-	ThrCnt = GpuCnt;
-	for (int i = 0; i < GpuCnt; i++)
+//one public key per line, empty lines are skipped
+bool LoadPubKeys(char* fn)
+{
+	FILE* fp = fopen(fn, "rt");
+	if (!fp)
 	{
-#ifdef _WIN32
-		thr_handles[i] = (HANDLE)_beginthreadex(NULL, 0, kang_thr_proc, (void*)GpuKangs[i], 0, &ThreadID);
-#else
-		pthread_create(&thr_handles[i], NULL, kang_thr_proc, (void*)GpuKangs[i]);
-#endif
+		printf("error: cannot open public keys file %s\r\n", fn);
+		return false;
 	}
-
-	u64 tm_stats = GetTickCount64();
-	while (!gSolved)
+	char line[1024];
+	int line_num = 0;
+	while (fgets(line, sizeof(line), fp))
 	{
-		CheckNewPoints();
-	
-	#ifdef _WIN32
-		Sleep(5);
-	#else
-		usleep(5000);  // 5 ms
-	#endif
-	
-		if (GetTickCount64() - tm_stats > 5000)  // 5 sec
+		line_num++;
+		int len = (int)strlen(line);
+		while (len && ((u8)line[len - 1] <= ' '))
+			line[--len] = 0;
+		char* str = line;
+		while ((u8)*str && ((u8)*str <= ' '))
+			str++;
+		if (!*str)
+			continue;
+		if (gPubKeyCnt >= MAX_TARGET_CNT)
 		{
-			ShowStats(tm0, ops, dp_val);
-			tm_stats = GetTickCount64();
+			printf("error: too many public keys in %s, max is %d\r\n", fn, MAX_TARGET_CNT);
+			fclose(fp);
+			return false;
 		}
-	
-		if ((MaxTotalOps > 0.0) && (PntTotalOps > MaxTotalOps))
+		if (!gPubKeys[gPubKeyCnt].SetHexStr(str))
 		{
-			gIsOpsLimit = true;
-			printf("Operations limit reached\n");
-			break;
+			printf("error: invalid public key at line %d in %s\r\n", line_num, fn);
+			fclose(fp);
+			return false;
 		}
+		gPubKeyCnt++;
 	}
-
-
-	printf("\n\nStopping work ...\r\n");
-	time_t program_end_time = time(NULL);  // Capture the end time
-	// Calculate total time
-	time_t total_seconds = program_end_time - program_start_time;
-
-	int total_days = total_seconds / (24 * 3600);
-	int total_hours = (total_seconds % (24 * 3600)) / 3600;
-	int total_minutes = (total_seconds % 3600) / 60;
-	int remaining_seconds = total_seconds % 60;
-
-	// Dynamically build the time string
-	printf("Total Time: ");
-
-	int printed = 0;  // To track if we've printed any component yet
-
-	if (total_days > 0) {
-		printf("%d day%s", total_days, total_days == 1 ? "" : "s");
-		printed = 1;
-	}
-
-	if (total_hours > 0) {
-		if (printed) printf(", ");
-		printf("%d hour%s", total_hours, total_hours == 1 ? "" : "s");
-		printed = 1;
-	}
-
-	if (total_minutes > 0) {
-		if (printed) printf(", ");
-		printf("%d minute%s", total_minutes, total_minutes == 1 ? "" : "s");
-		printed = 1;
-	}
-
-	if (remaining_seconds > 0 || !printed) {  // Always print seconds if nothing else was printed
-		if (printed) printf(", ");
-		printf("%d second%s", remaining_seconds, remaining_seconds == 1 ? "" : "s");
-	}
-
-	printf("\n");
-
-
-	for (int i = 0; i < GpuCnt; i++)
-		GpuKangs[i]->Stop();
-	while (ThrCnt)
-		Sleep(10);
-	for (int i = 0; i < GpuCnt; i++)
+	fclose(fp);
+	if (!gPubKeyCnt)
 	{
-#ifdef _WIN32
-		CloseHandle(thr_handles[i]);
-#else
-		pthread_join(thr_handles[i], NULL);
-#endif
-	}
-
-	if (gIsOpsLimit)
-	{
-		if (gGenMode)
-		{
-			printf("saving tames...\r\n");
-			db.Header[0] = gRange;
-			if (db.SaveToFile(gTamesFileName))
-				printf("tames saved\r\n");
-			else
-				printf("tames saving failed\r\n");
-		}
-		db.Clear();
+		printf("error: no public keys in %s\r\n", fn);
 		return false;
 	}
-
-	double K = (double)PntTotalOps / pow(2.0, Range / 2.0);
-	printf("Point solved, K: %.3f (with DP and GPU overheads)\r\n\r\n", K);
-	db.Clear();
-	*pk_res = gPrivKey;
 	return true;
 }
 
-
-char* ensure_hex_prefix(char* str) {
-	if (str[0] != '0' || (str[1] != 'x' && str[1] != 'X')) {
-		static char hex_str[32];
-		snprintf(hex_str, sizeof(hex_str), "0x%s", str);
-		return hex_str;
-	}
-	return str;
-}
-
 bool ParseCommandLine(int argc, char* argv[]) {
 
 	EcInt gEnd;
@@ -623,6 +322,11 @@ bool ParseCommandLine(int argc, char* argv[]) {
 				printf("error: missed value after -dp option\r\n");
 				return false;
 			}
+			if (strcmp(argv[ci], "auto") == 0) {
+				ci++;
+				gAutoDP = true;
+				continue;
+			}
 			int val = atoi(argv[ci++]);
 			if (val < 14 || val > 60) {
 				printf("error: invalid value for -dp option\r\n");
@@ -691,22 +395,330 @@ bool ParseCommandLine(int argc, char* argv[]) {
 
 			gRange = bitlen;
 			printf("Bits: %d\n", gRange);
+		}
 
-			if (gRange < 32 || gRange > 180) {
-				printf("error: invalid range, resulting bit length must be between 32 and 180\n");
+		else if (strcmp(argument, "-stride") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -stride option\r\n");
+				return false;
+			}
+			EcInt one;
+			one.Set(1);
+			if (!gStride.SetHexStr(argv[ci]) || gStride.IsZero() || gStride.IsEqual(one) || !gStride.IsLessThanU(g_N)) {
+				printf("error: invalid value for -stride option\r\n");
 				return false;
 			}
+			ci++;
+			gStrideSet = true;
 		}
 
 		else if (strcmp(argument, "-pubkey") == 0) {
-			if (!gPubKey.SetHexStr(argv[ci++])) {
+			if (gPubKeyCnt) {
+				printf("error: -pubkey and -pubkeys options cannot be used together\r\n");
+				return false;
+			}
+			if (!gPubKeys[0].SetHexStr(argv[ci++])) {
 				printf("error: invalid value for -pubkey option\r\n");
 				return false;
 			}
+			gPubKeyCnt = 1;
+		}
+		else if (strcmp(argument, "-pubkeys") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -pubkeys option\r\n");
+				return false;
+			}
+			if (gPubKeyCnt) {
+				printf("error: -pubkey and -pubkeys options cannot be used together\r\n");
+				return false;
+			}
+			strcpy(gPubKeysFileName, argv[ci++]);
+			if (!LoadPubKeys(gPubKeysFileName))
+				return false;
 		}
 		else if (strcmp(argument, "-tames") == 0) {
 			strcpy(gTamesFileName, argv[ci++]);
 		}
+		else if (strcmp(argument, "-journal") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -journal option\r\n");
+				return false;
+			}
+			strcpy(gJournalFileName, argv[ci++]);
+		}
+		else if (strcmp(argument, "-spill") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -spill option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if (val < 16) {
+				printf("error: invalid value for -spill option, minimum is 16 MB\r\n");
+				return false;
+			}
+			gSpillMB = val;
+		}
+		else if (strcmp(argument, "-tsize") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -tsize option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if (val < 1) {
+				printf("error: invalid value for -tsize option\r\n");
+				return false;
+			}
+			gTamesSizeMB = val;
+		}
+		else if (strcmp(argument, "-bench") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -bench option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if (val < 1) {
+				printf("error: invalid value for -bench option\r\n");
+				return false;
+			}
+			gBenchCnt = val;
+		}
+		else if (strcmp(argument, "-warmup") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -warmup option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if (val < 0) {
+				printf("error: invalid value for -warmup option\r\n");
+				return false;
+			}
+			gBenchWarmup = val;
+		}
+		else if (strcmp(argument, "-seed") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -seed option\r\n");
+				return false;
+			}
+			gSeed = strtoull(argv[ci++], NULL, 10);
+			gSeedSet = true;
+		}
+		else if (strcmp(argument, "-report") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -report option\r\n");
+				return false;
+			}
+			strcpy(gReportFileName, argv[ci++]);
+			if (!TBenchReport::IsFormatSupported(gReportFileName)) {
+				printf("error: -report file must have .json or .csv extension\r\n");
+				return false;
+			}
+		}
+		else if (strcmp(argument, "-synth") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -synth option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if ((val < 1) || (val > MAX_GPU_CNT)) {
+				printf("error: invalid value for -synth option\r\n");
+				return false;
+			}
+			gSynthCnt = val;
+		}
+		else if (strcmp(argument, "-synthrate") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -synthrate option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if (val < 0) {
+				printf("error: invalid value for -synthrate option\r\n");
+				return false;
+			}
+			gSynthParams.rate = val;
+		}
+		else if (strcmp(argument, "-synthbatch") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -synthbatch option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if ((val < 1) || (val > MAX_DP_CNT)) {
+				printf("error: invalid value for -synthbatch option\r\n");
+				return false;
+			}
+			gSynthParams.batch = val;
+		}
+		else if (strcmp(argument, "-synthtame") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -synthtame option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if ((val < 0) || (val > 100)) {
+				printf("error: invalid value for -synthtame option\r\n");
+				return false;
+			}
+			gSynthParams.tame_pct = val;
+		}
+		else if (strcmp(argument, "-synthcoll") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -synthcoll option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if (val < 0) {
+				printf("error: invalid value for -synthcoll option\r\n");
+				return false;
+			}
+			gSynthParams.coll_every = val;
+		}
+		else if (strcmp(argument, "-metrics") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -metrics option\r\n");
+				return false;
+			}
+			strcpy(gMetricsFileName, argv[ci++]);
+		}
+		else if (strcmp(argument, "-metricsport") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -metricsport option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if ((val < 1) || (val > 65535)) {
+				printf("error: invalid value for -metricsport option\r\n");
+				return false;
+			}
+			gMetricsPort = val;
+		}
+		else if (strcmp(argument, "-dpserver") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -dpserver option\r\n");
+				return false;
+			}
+			if (strlen(argv[ci]) >= sizeof(gDPServerAddr)) {
+				printf("error: invalid value for -dpserver option\r\n");
+				return false;
+			}
+			strcpy(gDPServerAddr, argv[ci++]);
+		}
+		else if (strcmp(argument, "-dpclient") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -dpclient option\r\n");
+				return false;
+			}
+			if (strlen(argv[ci]) >= sizeof(gDPClientAddr)) {
+				printf("error: invalid value for -dpclient option\r\n");
+				return false;
+			}
+			strcpy(gDPClientAddr, argv[ci++]);
+		}
+		else if (strcmp(argument, "-jcache") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -jcache option\r\n");
+				return false;
+			}
+			if (strlen(argv[ci]) >= 1000) {
+				printf("error: invalid value for -jcache option\r\n");
+				return false;
+			}
+			gSolver.JumpCache.SetDir(argv[ci++]);
+		}
+		else if (strcmp(argument, "-herd") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -herd option\r\n");
+				return false;
+			}
+			char* val = argv[ci++];
+			if (strcmp(val, "auto") == 0)
+				gHerdAuto = true;
+			else {
+				u32 t, w1, w2;
+				char c;
+				if ((sscanf(val, "%u:%u:%u%c", &t, &w1, &w2, &c) != 3) || (t > 1000000) || (w1 > 1000000) || (w2 > 1000000) || !(w1 + w2)) {
+					printf("error: invalid value for -herd option, use T:W1:W2 weights with at least one wild, or \"auto\"\r\n");
+					return false;
+				}
+				gHerd.tame = t;
+				gHerd.wild1 = w1;
+				gHerd.wild2 = w2;
+				gHerdSet = true;
+			}
+		}
+		else if (strcmp(argument, "-checkpoint") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -checkpoint option\r\n");
+				return false;
+			}
+			if (strlen(argv[ci]) >= 1000) {
+				printf("error: invalid value for -checkpoint option\r\n");
+				return false;
+			}
+			gSolver.Checkpoint.SetFile(argv[ci++]);
+		}
+		else if (strcmp(argument, "-chkint") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -chkint option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if (val < 1) {
+				printf("error: invalid value for -chkint option\r\n");
+				return false;
+			}
+			gSolver.Checkpoint.SetInterval(val);
+		}
+		else if (strcmp(argument, "-resume") == 0) {
+			gResume = true;
+		}
+		else if (strcmp(argument, "-daemon") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -daemon option\r\n");
+				return false;
+			}
+			if (strlen(argv[ci]) >= 1000) {
+				printf("error: invalid value for -daemon option\r\n");
+				return false;
+			}
+			strcpy(gDaemonDir, argv[ci++]);
+		}
+		else if (strcmp(argument, "-wildrestart") == 0) {
+			gWildRestart = true;
+		}
+		else if (strcmp(argument, "-audit") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -audit option\r\n");
+				return false;
+			}
+			int val = atoi(argv[ci++]);
+			if (val < 1) {
+				printf("error: invalid value for -audit option\r\n");
+				return false;
+			}
+			gSolver.Audit.SetInterval(val);
+		}
+		else if (strcmp(argument, "-ram") == 0) {
+			if (ci >= argc) {
+				printf("error: missed value after -ram option\r\n");
+				return false;
+			}
+			double val = atof(argv[ci++]);
+			if (val <= 0.0) {
+				printf("error: invalid value for -ram option\r\n");
+				return false;
+			}
+			gRamGB = val;
+		}
+		else if (strcmp(argument, "-extend") == 0) {
+			gExtendMode = true;
+		}
+		else if (strcmp(argument, "-compress") == 0) {
+			gTamesCompress = true;
+		}
+		else if (strcmp(argument, "-selftest") == 0) {
+			gSelfTest = true;
+		}
 		else if (strcmp(argument, "-max") == 0) {
 			double val = atof(argv[ci++]);
 			if (val < 0.001) {
@@ -721,13 +733,64 @@ bool ParseCommandLine(int argc, char* argv[]) {
 		}
 	}
 
-	if (!gPubKey.x.IsZero()) {
-		if (!gRange || !gDP) {
+	if (gDP && gAutoDP) {
+		printf("error: -dp option is specified twice\r\n");
+		return false;
+	}
+	if ((gRamGB > 0) && !gDP)
+		gAutoDP = true;
+
+	//range and points are in jobs, DP of job replaces -dp option, if DP is not set at all it's selected by planner
+	if (gDaemonDir[0]) {
+		if (!gDP)
+			gAutoDP = true;
+		if (gPubKeyCnt || gRange) {
+			printf("error: -pubkey, -pubkeys and -range options cannot be used with -daemon option, they are set by jobs\r\n");
+			return false;
+		}
+		if (gSolver.Checkpoint.IsEnabled() || gJournalFileName[0] || gDPServerAddr[0] || gDPClientAddr[0]) {
+			printf("error: -checkpoint, -journal, -dpserver and -dpclient options cannot be used with -daemon option\r\n");
+			return false;
+		}
+		if (gBenchCnt || gBenchWarmup || gSeedSet || gReportFileName[0] || gExtendMode) {
+			printf("error: -daemon option cannot be used in benchmark and tames generation modes\r\n");
+			return false;
+		}
+		if (gTamesFileName[0] && !IsFileExist(gTamesFileName)) {
+			printf("error: tames file %s not found, daemon cannot generate tames\r\n", gTamesFileName);
+			return false;
+		}
+	}
+
+	if (gPubKeyCnt) {
+		if (!gRange || (!gDP && !gAutoDP)) {
 			printf("error: you must specify range and dp options\r\n");
 			return false;
 		}
 	}
 
+	//solver range is for index of key: start + stride * i, i <= (end - start) / stride < 2^range
+	if (gStrideSet) {
+		if (!gPubKeyCnt) {
+			printf("error: -stride option requires -pubkey or -pubkeys option\r\n");
+			return false;
+		}
+		EcInt width = gEnd;
+		width.Sub(gStart);
+		EcInt max_ofs = gStride;
+		gRange = 0;
+		while (!width.IsLessThanU(max_ofs)) {
+			max_ofs.ShiftLeft(1);
+			gRange++;
+		}
+		printf("Bits with stride: %d\n", gRange);
+	}
+
+	if ((gRange || gStrideSet) && (gRange < 32 || gRange > 180)) {
+		printf("error: invalid range, resulting bit length must be between 32 and 180\n");
+		return false;
+	}
+
 	if (gTamesFileName[0] && !IsFileExist(gTamesFileName)) {
 		if (gMax == 0.0) {
 			printf("error: you must also specify -max option to generate tames\r\n");
@@ -736,9 +799,294 @@ bool ParseCommandLine(int argc, char* argv[]) {
 		gGenMode = true;
 	}
 
+	if (gExtendMode) {
+		if (!gTamesFileName[0] || gGenMode) {
+			printf("error: -extend option requires existing tames file in -tames option\r\n");
+			return false;
+		}
+		if (gMax == 0.0) {
+			printf("error: you must also specify -max option to extend tames\r\n");
+			return false;
+		}
+		if (gPubKeyCnt) {
+			printf("error: -extend option cannot be used with -pubkey option\r\n");
+			return false;
+		}
+		TTamesReader rd;
+		if (!rd.Open(gTamesFileName)) {
+			printf("error: cannot read tames file %s\r\n", gTamesFileName);
+			return false;
+		}
+		//range and dp are taken from tames file if not specified, they must match existing tames
+		if (!gRange)
+			gRange = rd.Header[0];
+		if (!gDP)
+			gDP = rd.Header[1];
+		if ((gRange != rd.Header[0]) || (rd.Header[1] && (gDP != rd.Header[1]))) {
+			printf("error: tames file was generated with range %d, dp %d\r\n", rd.Header[0], rd.Header[1]);
+			return false;
+		}
+		gGenMode = true;
+		gAutoDP = false;
+	}
+
+	//existing tames define DP, planner cannot change it
+	if (gAutoDP && gTamesFileName[0] && !gGenMode) {
+		TTamesReader rd;
+		if (!rd.Open(gTamesFileName)) {
+			printf("error: cannot read tames file %s\r\n", gTamesFileName);
+			return false;
+		}
+		if (rd.Header[1]) {
+			gDP = rd.Header[1];
+			gAutoDP = false;
+		}
+	}
+
+	if (gJournalFileName[0] && !gPubKeyCnt && !gGenMode) {
+		printf("error: -journal option can be used to solve public key or to generate tames only\r\n");
+		return false;
+	}
+
+	if ((gHerdSet || gHerdAuto) && gGenMode) {
+		printf("error: -herd option cannot be used to generate tames, all kangaroos are tames in this mode\r\n");
+		return false;
+	}
+
+	if (gSolver.Checkpoint.IsEnabled()) {
+		if (!gPubKeyCnt || gGenMode) {
+			printf("error: -checkpoint option can be used to solve public key only\r\n");
+			return false;
+		}
+		if (gResume != IsFileExist(gSolver.Checkpoint.GetFileName())) {
+			printf(gResume ? "error: checkpoint file %s not found\r\n" : "error: checkpoint file %s exists, use -resume option to continue or delete it\r\n", gSolver.Checkpoint.GetFileName());
+			return false;
+		}
+		//DPs of checkpoint are in DP journal, DP client has no DB
+		if (!gJournalFileName[0] && !gDPClientAddr[0])
+			sprintf(gJournalFileName, "%s.dps", gSolver.Checkpoint.GetFileName());
+	}
+	else
+		if (gResume) {
+			printf("error: -resume option requires -checkpoint option\r\n");
+			return false;
+		}
+
+	if (gWildRestart && (!gTamesFileName[0] || gGenMode)) {
+		printf("error: -wildrestart option requires existing tames file in -tames option\r\n");
+		return false;
+	}
+
+	if (gTamesSizeMB && !gGenMode) {
+		printf("error: -tsize option can be used to generate tames only\r\n");
+		return false;
+	}
+
+	if ((gBenchCnt || gBenchWarmup || gSeedSet || gReportFileName[0]) && (gPubKeyCnt || gGenMode)) {
+		printf("error: -bench, -warmup, -seed and -report options can be used in benchmark mode only\r\n");
+		return false;
+	}
+
+	if ((gDPServerAddr[0] || gDPClientAddr[0]) && !gPubKeyCnt) {
+		printf("error: -dpserver and -dpclient options can be used to solve public key only\r\n");
+		return false;
+	}
+
+	if ((gDPServerAddr[0] || gDPClientAddr[0]) && gAutoDP) {
+		printf("error: DP server and clients must use the same DP value, set it by -dp option\r\n");
+		return false;
+	}
+
+	if (gDPServerAddr[0] && gDPClientAddr[0]) {
+		printf("error: -dpserver and -dpclient options cannot be used together\r\n");
+		return false;
+	}
+
+	if (gDPClientAddr[0] && (gTamesFileName[0] || gJournalFileName[0])) {
+		printf("error: -tames and -journal options must be used on DP server, not on client\r\n");
+		return false;
+	}
+
+	//synthetic workers can load test DP server
+	if (gSynthCnt && (gGenMode || (gPubKeyCnt && !gDPClientAddr[0]))) {
+		printf("error: -synth option can be used in benchmark mode or with -dpclient option only\r\n");
+		return false;
+	}
+
+	if (gSpillMB && !gGenMode) {
+		printf("error: -spill option can be used to generate tames only\r\n");
+		return false;
+	}
+
+	if (gSpillMB && gJournalFileName[0]) {
+		printf("error: -spill and -journal options cannot be used together, tames runs are already saved to disk\r\n");
+		return false;
+	}
+
 	return true;
 }
 
+//points are shifted by start offset, so solver always solves range [0, 2^Range)
+void GetPointsToSolve(EcPoint* PntsToSolve)
+{
+	EcPoint PntOfs = ec.MultiplyG(gStart);
+	PntOfs.y.NegModP();
+	char sx[100], sy[100];
+	for (int i = 0; i < gPubKeyCnt; i++)
+	{
+		PntsToSolve[i] = gPubKeys[i];
+		if (!gStart.IsZero())
+			PntsToSolve[i] = ec.AddPoints(PntsToSolve[i], PntOfs);
+		gPubKeys[i].x.GetHexStr(sx);
+		gPubKeys[i].y.GetHexStr(sy);
+		printf("Solving public key\r\nX: %s\r\nY: %s\r\n", sx, sy);
+	}
+	gStart.GetHexStr(sx);
+	trim_leading_zeros(sx);
+	printf("Offset: %s\n", sx);
+	if (gStrideSet)
+	{
+		EcInt inv = gStride;
+		inv.InvModN();
+		for (int i = 0; i < gPubKeyCnt; i++)
+			PntsToSolve[i] = ec.MultiplyPoint(PntsToSolve[i], inv);
+		gStride.GetHexStr(sx);
+		trim_leading_zeros(sx);
+		printf("Stride: %s\n", sx);
+	}
+}
+
+struct TNextJobData
+{
+	int Range;
+	char* TamesFileName;
+	HHANDLER thr;
+	bool active;
+};
+TNextJobData gNextJob;
+
+THR_PROC(next_job_thr_proc)
+{
+	TNextJobData* nd = (TNextJobData*)data;
+	gSolver.PrepareNext(nd->Range, nd->TamesFileName);
+	return 0;
+}
+
+//daemon mode, current job has its jumps already, so next job can be prepared without waiting for jump cache
+void SolveStarted(void* ctx, TKangarooSolver* solver)
+{
+	if (!gDaemonDir[0] || gNextJob.active)
+		return;
+	TJob next;
+	if (gSpool.Peek(&next) && (next.Range != (int)gRange))
+	{
+		gNextJob.Range = next.Range;
+		gNextJob.TamesFileName = gTamesFileName;
+		gNextJob.active = StartThread(&gNextJob.thr, next_job_thr_proc, &gNextJob);
+	}
+}
+
+//job result is appended to RESULTS.TXT after its keys
+void SaveJobResult(TJob* job, const char* status, int solved_cnt, u64 total_ms)
+{
+	char s[1500];
+	sprintf(s, "JOB %s: %s, points %d/%d, range %d, DP %d, ops 2^%.3f, solve %.1f s, total %.1f s",
+		job->name, status, solved_cnt, job->PubKeyCnt, job->Range, gSolver.GetDP(),
+		log2((double)gSolver.PntTotalOps + 1), gSolver.PntSolveMs / 1000.0, total_ms / 1000.0);
+	printf("%s\r\n", s);
+	FILE* fp = fopen("RESULTS.TXT", "a");
+	if (!fp)
+	{
+		printf("WARNING: Cannot save job result to RESULTS.TXT!\r\n");
+		return;
+	}
+	fprintf(fp, "%s\n", s);
+	fclose(fp);
+}
+
+//jobs are solved one by one by the same solver and workers, so devices and buffers are initialized once.
+//Next job is prepared in background while current one works, so workers switch to it almost at once
+void RunDaemon()
+{
+	if (!gSpool.Init(gDaemonDir))
+		return;
+	printf("waiting for jobs in %s...\r\n", gDaemonDir);
+	gNextJob.active = false;
+	while (!gSolver.IsStopRequested())
+	{
+		TJob job;
+		if (!gSpool.Take(&job))
+		{
+			Sleep(1000);
+			continue;
+		}
+		u64 tm = GetTickCount64();
+		//it's started by SolveStarted of previous job, jumps of this job are probably ready
+		if (gNextJob.active)
+		{
+			WaitThread(gNextJob.thr);
+			gNextJob.active = false;
+		}
+		printf("\r\nJOB %s: %d points, range %d bits\r\n", job.name, job.PubKeyCnt, job.Range);
+
+		gStart = job.Start;
+		gPubKeyCnt = job.PubKeyCnt;
+		for (int i = 0; i < gPubKeyCnt; i++)
+			gPubKeys[i] = job.PubKeys[i];
+		gRange = job.Range;
+		EcPoint PntsToSolve[MAX_TARGET_CNT];
+		EcInt pk_found[MAX_TARGET_CNT];
+		bool solved[MAX_TARGET_CNT];
+		GetPointsToSolve(PntsToSolve);
+		int dp = job.DP ? job.DP : gDP;
+		gSolver.Config.AutoDP = !dp;
+		gSolver.Config.Max = (job.Max > 0) ? job.Max : gMax;
+		bool res = gSolver.Solve(PntsToSolve, gPubKeyCnt, gRange, dp, pk_found, solved);
+		if (gSolver.IsStopRequested())
+		{
+			gSpool.Requeue(&job);
+			printf("job %s is queued again\r\n", job.name);
+			break;
+		}
+		int solved_cnt = 0;
+		for (int i = 0; i < gPubKeyCnt; i++)
+			if (res || solved[i])
+				solved_cnt++;
+		const char* status = res ? "solved" : (gSolver.IsOpsLimit ? "limit" : "failed");
+		SaveJobResult(&job, status, solved_cnt, GetTickCount64() - tm);
+		gSpool.Finish(&job, res);
+	}
+	if (gNextJob.active)
+		WaitThread(gNextJob.thr);
+}
+
+//options are copied to solver, it doesn't use program globals
+void SetSolverConfig()
+{
+	TSolverConfig* cfg = &gSolver.Config;
+	cfg->AutoDP = gAutoDP;
+	cfg->RamGB = gRamGB;
+	cfg->Max = gMax;
+	cfg->GenMode = gGenMode;
+	cfg->ExtendMode = gExtendMode;
+	cfg->TamesCompress = gTamesCompress;
+	cfg->TamesSizeMB = gTamesSizeMB;
+	cfg->SpillMB = gSpillMB;
+	strcpy(cfg->TamesFileName, gTamesFileName);
+	strcpy(cfg->JournalFileName, gJournalFileName);
+	strcpy(cfg->DPClientAddr, gDPClientAddr);
+	cfg->KangSeedSet = false;
+	cfg->Herd = gHerd;
+	cfg->HerdSet = gHerdSet;
+	cfg->HerdAuto = gHerdAuto;
+	cfg->WildRestart = gWildRestart;
+	cfg->Resume = gResume;
+	cfg->IsBench = IsBench;
+	gSolver.Callbacks.ctx = NULL;
+	gSolver.Callbacks.OnKey = (IsBench || gGenMode) ? NULL : ReportKey;
+	gSolver.Callbacks.OnStats = UpdateMetrics;
+	gSolver.Callbacks.OnStarted = SolveStarted;
+}
 
 int main(int argc, char* argv[])
 {
@@ -767,15 +1115,66 @@ int main(int argc, char* argv[])
 	gDP = 0;
 	gRange = 0;
 	gStartSet = false;
+	gStrideSet = false;
 	gTamesFileName[0] = 0;
 	gMax = 0.0;
 	gGenMode = false;
-	gIsOpsLimit = false;
+	gExtendMode = false;
+	gTamesCompress = false;
+	gJournalFileName[0] = 0;
+	gSpillMB = 0;
+	gTamesSizeMB = 0;
+	gBenchCnt = 0;
+	gBenchWarmup = 0;
+	gSeedSet = false;
+	gSeed = 0;
+	gReportFileName[0] = 0;
+	gSynthCnt = 0;
+	gSynthParams.rate = 0;
+	gSynthParams.batch = 1024;
+	gSynthParams.tame_pct = 33;
+	gSynthParams.coll_every = 0;
+	gMetricsFileName[0] = 0;
+	gMetricsPort = 0;
+	gDPServerAddr[0] = 0;
+	gDPClientAddr[0] = 0;
+	gDPServer = NULL;
+	gAutoDP = false;
+	gRamGB = 0.0;
+	gHerd.tame = gHerd.wild1 = gHerd.wild2 = 1;
+	gHerdSet = false;
+	gHerdAuto = false;
+	gWildRestart = false;
+	gResume = false;
+	gDaemonDir[0] = 0;
+	gSelfTest = false;
 	memset(gGPUs_Mask, 1, sizeof(gGPUs_Mask));
 	if (!ParseCommandLine(argc, argv))
 		return 0;
+	if (gSelfTest)
+	{
+		bool ok = RunSelfTests();
+		DeInitEc();
+		return ok ? 0 : 1;
+	}
+	if (gSolver.Checkpoint.IsEnabled() || gDaemonDir[0])
+	{
+		signal(SIGINT, stop_sig_handler);
+		signal(SIGTERM, stop_sig_handler);
+	}
 
-	InitGpus();
+	if (!NetInit())
+	{
+		printf("network init failed\r\n");
+		return 0;
+	}
+
+	if (gSynthCnt)
+		InitSynth();
+	else
+		InitGpus();
+	if (gDPServerAddr[0])
+		InitDPServer();
 
 	if (!GpuCnt)
 	{
@@ -783,90 +1182,95 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
-	pPntList = (u8*)malloc(MAX_CNT_LIST * GPU_DP_SIZE);
-	pPntList2 = (u8*)malloc(MAX_CNT_LIST * GPU_DP_SIZE);
 	TotalOps = 0;
 	TotalSolved = 0;
-	gTotalErrors = 0;
-	IsBench = gPubKey.x.IsZero();
+	IsBench = !gPubKeyCnt && !gDaemonDir[0];
+	SetSolverConfig();
+	if (!gSolver.Init(GpuKangs, GpuCnt, gDPServer))
+		goto label_end;
+	if (!gMetrics.Start(gMetricsFileName, gMetricsPort))
+	{
+		printf("metrics HTTP server cannot be started on port %d\r\n", gMetricsPort);
+		goto label_end;
+	}
 
+	if (gDaemonDir[0])
+	{
+		printf("\r\nDAEMON MODE\r\n\r\n");
+		RunDaemon();
+	}
+	else
 	if (!IsBench && !gGenMode)
 	{
 		printf("\r\nMAIN MODE\r\n\r\n");
-		EcPoint PntToSolve, PntOfs;
-		EcInt pk, pk_found;
+		EcPoint PntsToSolve[MAX_TARGET_CNT];
+		EcInt pk_found[MAX_TARGET_CNT];
+		bool solved[MAX_TARGET_CNT];
+		GetPointsToSolve(PntsToSolve);
 
-		PntToSolve = gPubKey;
-		if (!gStart.IsZero())
+		//found keys are reported by ReportKey callback
+		if (!gSolver.Solve(PntsToSolve, gPubKeyCnt, gRange, gDP, pk_found, solved))
 		{
-			PntOfs = ec.MultiplyG(gStart);
-			PntOfs.y.NegModP();
-			PntToSolve = ec.AddPoints(PntToSolve, PntOfs);
-		}
-
-		char sx[100], sy[100];
-		gPubKey.x.GetHexStr(sx);
-		gPubKey.y.GetHexStr(sy);
-		printf("Solving public key\r\nX: %s\r\nY: %s\r\n", sx, sy);
-		gStart.GetHexStr(sx);
-		trim_leading_zeros(sx);
-		printf("Offset: %s\n", sx);
-
-		if (!SolvePoint(PntToSolve, gRange, gDP, &pk_found))
-		{
-			if (!gIsOpsLimit)
+			if (!gSolver.IsOpsLimit && !gSolver.IsStopRequested())
 				printf("FATAL ERROR: SolvePoint failed\r\n");
 			goto label_end;
 		}
-		pk_found.AddModP(gStart);
-		EcPoint tmp = ec.MultiplyG(pk_found);
-		if (!tmp.IsEqual(gPubKey))
-		{
-			printf("FATAL ERROR: SolvePoint found incorrect key\r\n");
-			goto label_end;
-		}
-		//happy end
-		char s[100];
-		pk_found.GetHexStr(s);
-		trim_leading_zeros(s);
-		printf("\r\nPRIVATE KEY: %s\r\n\r\n", s);
-		FILE* fp = fopen("RESULTS.TXT", "a");
-		if (fp)
-		{
-			fprintf(fp, "PRIVATE KEY: %s\n", s);
-			fclose(fp);
-		}
-		else //we cannot save the key, show error and wait forever so the key is displayed
-		{
-			printf("WARNING: Cannot save the key to RESULTS.TXT!\r\n");
-			while (1)
-				Sleep(100);
-		}
+		if (gJournalFileName[0])
+			remove(gJournalFileName);
+		gSolver.Checkpoint.Remove();
 	}
 	else
 	{
 		if (gGenMode)
-			printf("\r\nTAMES GENERATION MODE\r\n");
+			printf(gExtendMode ? "\r\nTAMES EXTENSION MODE\r\n" : "\r\nTAMES GENERATION MODE\r\n");
 		else
 			printf("\r\nBENCHMARK MODE\r\n");
+		if (!gRange)
+			gRange = 78;
+		if (!gDP && !gAutoDP)
+			gDP = 16;
+		gBench.Range = gRange;
+		gBench.DP = gDP;
+		gBench.GpuCnt = GpuCnt;
+		gBench.Warmup = gBenchWarmup;
+		gBench.SeedSet = gSeedSet;
+		gBench.Seed = gSeed;
+		if (!gGenMode && gBenchCnt)
+			printf("%d solves, %d warm-up solves\r\n", gBenchCnt, gBenchWarmup);
+		if (!gSeedSet)
+			gKeyRnd.SetSeed(GetTickCount64());
 		//solve points, show K
-		while (1)
+		for (u32 solve_ind = 0; gGenMode || !gBenchCnt || (solve_ind < gBenchCnt + gBenchWarmup); solve_ind++)
 		{
 			EcInt pk, pk_found;
 			EcPoint PntToSolve;
+			bool solved;
 
-			if (!gRange)
-				gRange = 78;
-			if (!gDP)
-				gDP = 16;
-
+			//with fixed seed every solve gets its own seed, so any solve can be repeated separately
+			u64 seed = gSeed + solve_ind;
+			if (gSeedSet)
+				gKeyRnd.SetSeed(seed);
 			//generate random pk
-			pk.RndBits(gRange);
+			pk.RndBits(gRange, &gKeyRnd);
 			PntToSolve = ec.MultiplyG(pk);
+			//synthetic workers need the key to make true collisions
+			if (gSynthCnt)
+				for (int i = 0; i < GpuCnt; i++)
+				{
+					((RCSynthKang*)GpuKangs[i])->Keys[0] = pk;
+					((RCSynthKang*)GpuKangs[i])->KeysSet = true;
+				}
+			if (gSeedSet)
+			{
+				EcInt t;
+				t.RndBits(64, &gKeyRnd);
+				gSolver.Config.KangSeed = t.data[0];
+				gSolver.Config.KangSeedSet = true;
+			}
 
-			if (!SolvePoint(PntToSolve, gRange, gDP, &pk_found))
+			if (!gSolver.Solve(&PntToSolve, 1, gRange, gDP, &pk_found, &solved))
 			{
-				if (!gIsOpsLimit)
+				if (!gSolver.IsOpsLimit)
 					printf("FATAL ERROR: SolvePoint failed\r\n");
 				break;
 			}
@@ -877,19 +1281,41 @@ int main(int argc, char* argv[])
 			}
 
 
-			TotalOps += PntTotalOps;
+			gBench.DP = gSolver.GetDP();
+			TBenchRec rec;
+			rec.index = solve_ind;
+			rec.warmup = solve_ind < gBenchWarmup;
+			rec.seed = gSeedSet ? seed : 0;
+			rec.ops = gSolver.PntTotalOps;
+			rec.dps = gSolver.PntTotalDPs;
+			rec.time_ms = gSolver.PntSolveMs;
+			rec.K = (double)rec.ops / pow(2.0, gRange / 2.0);
+			rec.speed = rec.time_ms ? (double)rec.ops / (rec.time_ms * 1000.0) : 0.0;
+			gBench.Add(&rec);
+			if (gReportFileName[0] && !gBench.Save(gReportFileName))
+				printf("WARNING: cannot save benchmark report to %s\r\n", gReportFileName);
+			if (rec.warmup)
+			{
+				printf("Warm-up solve %d of %d done\r\n", solve_ind + 1, gBenchWarmup);
+				continue;
+			}
+
+			TotalOps += gSolver.PntTotalOps;
 			TotalSolved++;
 			u64 ops_per_pnt = TotalOps / TotalSolved;
 			double K = (double)ops_per_pnt / pow(2.0, gRange / 2.0);
 			printf("Points solved: %d, average K: %.3f (with DP and GPU overheads)\r\n", TotalSolved, K);
 			//if (TotalSolved >= 100) break; //dbg
 		}
+		if (!gGenMode)
+			gBench.PrintSummary();
 	}
 label_end:
+	gMetrics.Stop();
+	NetDeInit();
+	gSolver.Release();
 	for (int i = 0; i < GpuCnt; i++)
 		delete GpuKangs[i];
 	DeInitEc();
-	free(pPntList2);
-	free(pPntList);
 }
 
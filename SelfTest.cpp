@@ -0,0 +1,431 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include "SelfTest.h"
+#include "Ec.h"
+#include "KangAudit.h"
+#include "Net.h"
+#include "TamesFile.h"
+
+#define ST_SEED				0x5243534Cull
+#define ST_LONG_LOOP		(MD_LEN + 7)
+#define ST_SHORT_LOOP		4
+#define ST_FREE_KANGS		16
+#define ST_BATCH_CNT		64
+#define ST_MODN_CNT			32
+#define ST_PACK_FULL		3 //DPs with random full-size distances
+#define ST_TAMES_FILE		"selftest_tames.tmp"
+#define ST_TAMES_CNT		1000
+
+static TRndGen rnd;
+
+static bool Report(const char* name, bool ok)
+{
+	printf("%-40s %s\r\n", name, ok ? "OK" : "FAILED");
+	return ok;
+}
+
+static u64 RndU64(int nbits)
+{
+	EcInt t;
+	t.RndBits(nbits, &rnd);
+	return t.data[0];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void SetKang(TKangState* k, EcInt& key)
+{
+	EcPoint p = Ec::MultiplyG(key);
+	memcpy(k->x, p.x.data, 32);
+	memcpy(k->y, p.y.data, 32);
+	memset(k->d, 0, sizeof(k->d));
+	k->flags = 0;
+}
+
+//point of kangaroo must be G * (key + d) after any number of jumps and escapes
+static bool IsKangValid(TKangState* k, EcInt& key)
+{
+	EcInt t;
+	t.data[0] = k->d[0];
+	t.data[1] = k->d[1];
+	t.data[2] = k->d[2];
+	t.data[3] = t.data[4] = (k->d[2] >> 63) ? 0xFFFFFFFFFFFFFFFFull : 0;
+	t.Add(key);
+	EcPoint p = Ec::MultiplyG(t);
+	return !memcmp(p.x.data, k->x, 32) && !memcmp(p.y.data, k->y, 32);
+}
+
+static void SetJump(EcJMP* jmp, i64 dist)
+{
+	jmp->dist.Set((dist < 0) ? (u64)-dist : (u64)dist);
+	jmp->p = Ec::MultiplyG(jmp->dist);
+	if (dist < 0)
+	{
+		jmp->p.y.NegModP();
+		jmp->dist.Neg();
+	}
+}
+
+//loop of cnt points from key in jump table 1: every point has its own jump index and the jump leads to the next point,
+//kangaroo with odd y jumps back by table value, so it's negated for such points
+static bool MakeLoop(EcJMP* jumps, bool* used, EcInt& key, int cnt)
+{
+	i64 offs[ST_LONG_LOOP];
+	u32 inds[ST_LONG_LOOP];
+	bool odd[ST_LONG_LOOP];
+	for (int i = 0; i < cnt; i++)
+	{
+		int attempt;
+		for (attempt = 0; attempt < 100; attempt++)
+		{
+			offs[i] = i ? offs[i - 1] + 1 + (i64)RndU64(40) : 0;
+			EcInt k, t;
+			t.Set((u64)offs[i]);
+			k = key;
+			k.Add(t);
+			EcPoint p = Ec::MultiplyG(k);
+			inds[i] = p.x.data[0] % JMP_CNT;
+			odd[i] = (p.y.data[0] & 1) != 0;
+			if (!used[inds[i]])
+				break;
+		}
+		if (attempt == 100)
+			return false;
+		used[inds[i]] = true;
+	}
+	for (int i = 0; i < cnt; i++)
+	{
+		i64 delta = offs[(i + 1) % cnt] - offs[i];
+		SetJump(&jumps[inds[i]], odd[i] ? -delta : delta);
+	}
+	return true;
+}
+
+//one kangaroo in a loop longer than MD_LEN, one in a short loop and some free ones, only the first one must be reported
+static bool TestAudit()
+{
+	rnd.SetSeed(ST_SEED);
+	EcJMP* jumps = new EcJMP[3 * JMP_CNT];
+	bool used[JMP_CNT];
+	memset(used, 0, sizeof(used));
+	int cnt = 2 + ST_FREE_KANGS;
+	EcInt keys[2 + ST_FREE_KANGS];
+	for (int i = 0; i < cnt; i++)
+		keys[i].RndBits(128, &rnd);
+	bool ok = MakeLoop(jumps, used, keys[0], ST_LONG_LOOP) && MakeLoop(jumps, used, keys[1], ST_SHORT_LOOP);
+	for (int i = 0; i < 3 * JMP_CNT; i++)
+		if ((i >= JMP_CNT) || !used[i])
+			SetJump(&jumps[i], 1 + (i64)RndU64(40));
+
+	TKangState kangs[2 + ST_FREE_KANGS];
+	u32 loops[2 + ST_FREE_KANGS];
+	u64 short_loops = 0;
+	for (int i = 0; i < cnt; i++)
+		SetKang(&kangs[i], keys[i]);
+	TKangAudit audit;
+	audit.Start(NULL, 0, jumps, jumps + JMP_CNT, jumps + 2 * JMP_CNT);
+	int looped = audit.CheckKangs(kangs, cnt, loops, &short_loops);
+	ok = ok && (looped == 1) && (loops[0] == ST_LONG_LOOP) && !loops[1] && short_loops;
+	//looped kangaroo is escaped by table 3, others walk on, distances must match points for all
+	for (int i = 0; i < cnt; i++)
+		ok = ok && IsKangValid(&kangs[i], keys[i]);
+	delete[] jumps;
+	return Report("audit loop detection", ok);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//edge keys and random keys of all sizes, including same key twice
+static bool TestMultiplyBatch()
+{
+	rnd.SetSeed(ST_SEED);
+	EcInt k[ST_BATCH_CNT];
+	EcPoint res[ST_BATCH_CNT];
+	k[0].Set(1);
+	k[1].Set(2);
+	k[2].Set(3);
+	k[3] = g_N;
+	k[3].Sub(k[0]); //N - 1
+	k[4].SetZero();
+	k[4].data[3] = 0x8000000000000000ull; //2^255
+	for (int i = 5; i < ST_BATCH_CNT - 1; i++)
+		k[i].RndBits(2 + (i * 253) / ST_BATCH_CNT, &rnd);
+	k[ST_BATCH_CNT - 1] = k[ST_BATCH_CNT - 2];
+	Ec::MultiplyG_Batch(k, res, ST_BATCH_CNT);
+	bool ok = true;
+	for (int i = 0; i < ST_BATCH_CNT; i++)
+	{
+		EcPoint p = Ec::MultiplyG(k[i]);
+		ok = ok && p.IsEqual(res[i]);
+	}
+	//batch of one key, inversion chain has no products
+	Ec::MultiplyG_Batch(&k[3], res, 1);
+	EcPoint p = Ec::MultiplyG(k[3]);
+	ok = ok && p.IsEqual(res[0]);
+	return Report("batched multiplication by G", ok);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//mod N results are checked by points, so they don't depend on mod N code: (a + b) * G = a * G + b * G, (a * b) * G = b * (a * G)
+static bool TestModN()
+{
+	rnd.SetSeed(ST_SEED);
+	EcInt one;
+	one.Set(1);
+	EcInt n1 = g_N;
+	n1.Sub(one);
+	bool ok = true;
+	for (int i = 0; i < ST_MODN_CNT; i++)
+	{
+		EcInt a, b;
+		//sums wrap around N, AddPoints cannot add equal points or get infinity, so edge pairs avoid them
+		if (i == 0)
+		{
+			a = n1;
+			b = n1;
+			b.Sub(one);
+		}
+		else
+		if (i == 1)
+		{
+			a.Set(2);
+			b = n1;
+		}
+		else
+		{
+			a.RndMax(g_N, &rnd);
+			b.RndBits(1 + (i * 255) / ST_MODN_CNT, &rnd);
+			if (b.IsZero())
+				b = one;
+		}
+		EcPoint pa = Ec::MultiplyG(a);
+		EcPoint pb = Ec::MultiplyG(b);
+		EcInt sum = a;
+		sum.AddModN(b);
+		EcPoint p1 = Ec::MultiplyG(sum);
+		EcPoint p2 = Ec::AddPoints(pa, pb);
+		ok = ok && sum.IsLessThanU(g_N) && p1.IsEqual(p2);
+		EcInt mul = a;
+		mul.MulModN(b);
+		p1 = Ec::MultiplyG(mul);
+		p2 = Ec::MultiplyPoint(pa, b);
+		ok = ok && mul.IsLessThanU(g_N) && p1.IsEqual(p2);
+		EcInt inv = b;
+		inv.InvModN();
+		inv.MulModN(b);
+		ok = ok && inv.IsEqual(one);
+		//stride transform: key = start + stride * ind is solved as ind, then mapped back like in ReportKey
+		EcInt start = (i & 1) ? one : n1;
+		EcInt key = b;
+		key.MulModN(a);
+		key.AddModN(start);
+		EcInt ind = start;
+		ind.NegModN();
+		ind.AddModN(key);
+		inv = a;
+		inv.InvModN();
+		ind.MulModN(inv);
+		ok = ok && ind.IsEqual(b);
+		ind.MulModN(a);
+		ind.AddModN(start);
+		ok = ok && ind.IsEqual(key);
+	}
+	return Report("mod N arithmetic", ok);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//distances around byte boundaries, sign bit of the last sent byte decides sign extension, first four fit into one byte
+static const i64 pack_dists[] = { 0, 1, -1, 127, 128, -128, -129, 0x7FFF, 0x8000, -0x8000, -0x8001, 0x123456789ABCll, -0x123456789ABCll };
+
+static bool CheckUnpackedDP(u8* rec, DBRec* src)
+{
+	u8 ext = (src->d[21] & 0x80) ? 0xFF : 0x00;
+	return !memcmp(rec, src->x, 12) && !memcmp(rec + 16, src->d, 22) && (rec[38] == ext) && (rec[39] == ext) &&
+		(rec[40] == (src->type & 3)) && (rec[42] == (src->type >> 2)) && (*(u32*)(rec + 44) == DP_KANG_UNKNOWN);
+}
+
+//DPs from clients are packed with short distances, server must restore them in GPU DP format
+static bool TestPackDPs()
+{
+	rnd.SetSeed(ST_SEED);
+	const int dist_cnt = sizeof(pack_dists) / sizeof(pack_dists[0]);
+	const int cnt = dist_cnt + ST_PACK_FULL;
+	DBRec recs[dist_cnt + ST_PACK_FULL];
+	for (int i = 0; i < cnt; i++)
+	{
+		u64 x[2];
+		x[0] = RndU64(64);
+		x[1] = RndU64(64);
+		memcpy(recs[i].x, x, 12);
+		if (i < dist_cnt)
+		{
+			memset(recs[i].d, (pack_dists[i] < 0) ? 0xFF : 0x00, 22);
+			memcpy(recs[i].d, &pack_dists[i], 8);
+		}
+		else
+			for (int j = 0; j < 22; j++)
+				recs[i].d[j] = (u8)RndU64(8);
+		recs[i].type = (u8)((i % 3) | (((i * 7) % MAX_TARGET_CNT) << 2));
+	}
+	u8 packed[1 + (dist_cnt + ST_PACK_FULL) * (13 + 22)];
+	u8 unpacked[(dist_cnt + ST_PACK_FULL) * GPU_DP_SIZE];
+	int batches[] = { 1, 4, dist_cnt, cnt };
+	bool ok = true;
+	for (int b = 0; b < 4; b++)
+	{
+		int n = batches[b];
+		int size = PackDPs(recs, n, packed);
+		if (n == 4)
+			ok = ok && (size == 1 + 4 * (13 + 1));
+		ok = ok && UnpackDPs(packed, size, n, MAX_TARGET_CNT, unpacked) && !UnpackDPs(packed, size - 1, n, MAX_TARGET_CNT, unpacked);
+		for (int i = 0; i < n; i++)
+			ok = ok && CheckUnpackedDP(unpacked + i * GPU_DP_SIZE, &recs[i]);
+	}
+	//batch is rejected if any DP has invalid kind or target that server doesn't have
+	DBRec bad[2];
+	bad[0] = recs[0];
+	bad[1] = recs[1];
+	bad[1].type = (u8)(WILD1 | (5 << 2));
+	int size = PackDPs(bad, 2, packed);
+	ok = ok && UnpackDPs(packed, size, 2, 6, unpacked) && !UnpackDPs(packed, size, 2, 5, unpacked);
+	bad[1].type = (u8)(3 | (1 << 2));
+	size = PackDPs(bad, 2, packed);
+	ok = ok && !UnpackDPs(packed, size, 2, MAX_TARGET_CNT, unpacked);
+	return Report("DP packing for DP server", ok);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//key is big-endian, like in DB
+static void SetTameKey(u8* rec, u8 hi, u64 lo)
+{
+	rec[0] = hi;
+	for (int i = DB_FIND_LEN - 1; i > 0; i--)
+	{
+		rec[i] = (u8)lo;
+		lo >>= 8;
+	}
+}
+
+static void SetTameDist(u8* rec, i64 dist)
+{
+	memset(rec + DB_FIND_LEN, (dist < 0) ? 0xFF : 0x00, DB_REC_LEN - DB_FIND_LEN - 1);
+	memcpy(rec + DB_FIND_LEN, &dist, 8);
+}
+
+static int CmpTameKeys(const void* a, const void* b)
+{
+	return memcmp(a, b, DB_FIND_LEN);
+}
+
+//three buckets for every path of the codec:
+//- many random keys, distances of all widths and both signs, no types
+//- dense keys and one far key (rice escape), full-size distances and types
+//- last prefix, same key twice
+static int MakeTamesBucket(int ind, u8* recs, int* prefix)
+{
+	int cnt;
+	if (ind == 0)
+	{
+		*prefix = 5;
+		cnt = ST_TAMES_CNT;
+		for (int i = 0; i < cnt; i++)
+		{
+			u8* rec = recs + i * DB_REC_LEN;
+			SetTameKey(rec, (u8)RndU64(8), RndU64(64));
+			i64 d = (i64)RndU64(1 + i % 62);
+			SetTameDist(rec, (i & 1) ? -d : d);
+			rec[DB_REC_LEN - 1] = 0;
+		}
+		qsort(recs, cnt, DB_REC_LEN, CmpTameKeys);
+	}
+	else
+	if (ind == 1)
+	{
+		*prefix = 70000;
+		cnt = 300;
+		for (int i = 0; i < cnt; i++)
+		{
+			u8* rec = recs + i * DB_REC_LEN;
+			SetTameKey(rec, 0, (i < cnt - 1) ? i : 1024);
+			for (int j = DB_FIND_LEN; j < DB_REC_LEN - 1; j++)
+				rec[j] = (u8)RndU64(8);
+			rec[DB_REC_LEN - 1] = (u8)(1 + i % TAMES_MAX_HITS);
+		}
+	}
+	else
+	{
+		*prefix = 256 * 256 * 256 - 1;
+		cnt = 2;
+		SetTameKey(recs, 0xFF, 0xFFFFFFFFFFFFFFFFull);
+		SetTameDist(recs, 0);
+		recs[DB_REC_LEN - 1] = 0;
+		memcpy(recs + DB_REC_LEN, recs, DB_REC_LEN);
+		SetTameDist(recs + DB_REC_LEN, -1);
+	}
+	return cnt;
+}
+
+//both formats are written and read back, records must be the same
+static bool TestTamesCodec()
+{
+	u8* recs[3];
+	int prefixes[3];
+	int cnts[3];
+	rnd.SetSeed(ST_SEED);
+	for (int b = 0; b < 3; b++)
+	{
+		recs[b] = (u8*)malloc(ST_TAMES_CNT * DB_REC_LEN);
+		cnts[b] = MakeTamesBucket(b, recs[b], &prefixes[b]);
+	}
+	u8* read_recs = (u8*)malloc(TAMES_MAX_BUCKET * DB_REC_LEN);
+	u8 header[256];
+	for (int i = 0; i < 256; i++)
+		header[i] = (u8)i;
+	bool ok = true;
+	for (int compressed = 0; compressed < 2; compressed++)
+	{
+		TTamesWriter tw;
+		bool res = tw.Open((char*)ST_TAMES_FILE, header, compressed != 0);
+		for (int b = 0; b < 3; b++)
+			res = res && tw.AddBucket(prefixes[b], recs[b], cnts[b]);
+		res = tw.Close() && res;
+		TTamesReader tr;
+		res = res && tr.Open((char*)ST_TAMES_FILE) && (tr.IsCompressed == (compressed != 0)) && !memcmp(tr.Header, header, 256);
+		int prefix;
+		for (int b = 0; res && (b < 3); b++)
+		{
+			int cnt = tr.ReadBucket(&prefix, read_recs);
+			res = (cnt == cnts[b]) && (prefix == prefixes[b]) && !memcmp(read_recs, recs[b], cnt * DB_REC_LEN);
+		}
+		res = res && !tr.ReadBucket(&prefix, read_recs);
+		tr.Close();
+		remove(ST_TAMES_FILE);
+		ok = ok && res;
+	}
+	for (int b = 0; b < 3; b++)
+		free(recs[b]);
+	free(read_recs);
+	return Report("tames file codec", ok);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RunSelfTests()
+{
+	printf("\r\nSELF-TEST MODE\r\n\r\n");
+	bool ok = true;
+	ok = TestAudit() && ok;
+	ok = TestMultiplyBatch() && ok;
+	ok = TestModN() && ok;
+	ok = TestPackDPs() && ok;
+	ok = TestTamesCodec() && ok;
+	printf(ok ? "\r\nAll checks passed\r\n" : "\r\nSOME CHECKS FAILED\r\n");
+	return ok;
+}
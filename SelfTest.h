@@ -0,0 +1,15 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+
+//host-side checks of code that cannot be verified by solving: loops that are never reached, formats that are decoded by other machines, etc.
+//"-selftest" option runs them and exits, GPUs are not used. Every check uses fixed seed so failure can be repeated
+
+//returns false if any check failed
+bool RunSelfTests();
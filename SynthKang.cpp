@@ -0,0 +1,188 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include "SynthKang.h"
+
+RCSynthKang::RCSynthKang()
+{
+	CudaIndex = 0;
+	KangCnt = 0;
+	Failed = false;
+	StopFlag = false;
+	DPs_out = NULL;
+	DPs_out_cnt = 0;
+	KeysSet = false;
+	memset(&Params, 0, sizeof(Params));
+	memset(dbg, 0, sizeof(dbg));
+}
+
+int RCSynthKang::CalcKangCnt()
+{
+	return SYNTH_KANG_CNT;
+}
+
+//executes in main thread
+bool RCSynthKang::Prepare(EcPoint* _PntsToSolve, int _PntCnt, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3)
+{
+	PntCnt = _PntCnt;
+	Range = _Range;
+	DP = _DP;
+	StopFlag = false;
+	Failed = false;
+	KangCnt = SYNTH_KANG_CNT;
+	memset(SpeedStats, 0, sizeof(SpeedStats));
+	cur_stats_ind = 0;
+	HalfRange.Set(1);
+	HalfRange.ShiftLeft(Range - 1);
+	rnd.seed(Seed + CudaIndex);
+
+	//+2 for collision pair, buffer is kept for next points
+	if (DPs_out_cnt != Params.batch + 2)
+	{
+		Release();
+		DPs_out = (u8*)malloc((Params.batch + 2) * GPU_DP_SIZE);
+		if (!DPs_out)
+			return false;
+		DPs_out_cnt = Params.batch + 2;
+	}
+	char rate[32];
+	if (Params.rate)
+		sprintf(rate, "%u", Params.rate);
+	else
+		strcpy(rate, "max");
+	printf("SYNTH %d: %u DPs per batch, %s DPs/s, %u%% tames, collisions %s\r\n", CudaIndex, Params.batch,
+		rate, Params.tame_pct, (KeysSet && Params.coll_every) ? "on" : "off");
+	return true;
+}
+
+void RCSynthKang::Stop()
+{
+	StopFlag = true;
+}
+
+void RCSynthKang::RndDist(EcInt* d, int bits)
+{
+	d->SetZero();
+	for (int i = 0; i < (bits + 63) / 64; i++)
+		d->data[i] = rnd();
+	d->data[bits / 64] &= (1ull << (bits % 64)) - 1;
+}
+
+//same layout as BuildDP in gpu code: x, distance, kang type and target
+//kangaroo is random, so DPs per kangaroo look like real healthy herd
+void RCSynthKang::SetRec(u8* rec, u8* x, EcInt* d, int kind, int target)
+{
+	memcpy(rec, x, 16);
+	memcpy(rec + 16, d->data, 24);
+	*(u32*)(rec + 40) = kind | (target << 16);
+	*(u32*)(rec + 44) = (u32)(rnd() % KangCnt) | (WorkerInd << DP_KANG_BITS);
+}
+
+void RCSynthKang::GenRec(u8* rec)
+{
+	u64 x[2];
+	x[0] = rnd();
+	x[1] = rnd();
+	EcInt d;
+	if ((int)(rnd() % 100) < (int)Params.tame_pct)
+	{
+		RndDist(&d, Range - 4);
+		SetRec(rec, (u8*)x, &d, TAME, 0);
+	}
+	else
+	{
+		RndDist(&d, Range - 1);
+		d.data[0] &= 0xFFFFFFFFFFFFFFFE; //must be even like real wild distances
+		SetRec(rec, (u8*)x, &d, (rnd() & 1) ? WILD2 : WILD1, (int)(rnd() % PntCnt));
+	}
+}
+
+//key = t - w + HalfRange, w is at least HalfRange so t is never negative
+void RCSynthKang::GenCollision(u8* rec)
+{
+	u64 x[2];
+	x[0] = rnd();
+	x[1] = rnd();
+	int target = (int)(rnd() % PntCnt);
+	EcInt w, t;
+	RndDist(&w, Range - 2);
+	w.Add(HalfRange);
+	t = Keys[target];
+	t.Sub(HalfRange);
+	t.Add(w);
+	SetRec(rec, (u8*)x, &t, TAME, 0);
+	SetRec(rec + GPU_DP_SIZE, (u8*)x, &w, WILD1, target);
+}
+
+//executes in separate thread
+void RCSynthKang::Execute()
+{
+	u64 ops_per_dp = 1ull << DP;
+	u64 tm_start = GetTickCount64();
+	u64 sent = 0;
+	u64 next_coll = Params.coll_every;
+	u64 stats_tm = tm_start;
+	u64 stats_ops = 0;
+	std::vector <u32> reseed;
+	while (!StopFlag)
+	{
+		//synthetic kangaroos are random anyway
+		if (PopReseed(&reseed))
+			ReseedCnt += reseed.size();
+		u32 cnt = Params.batch;
+		if (Params.rate)
+		{
+			u64 allowed = (GetTickCount64() - tm_start) * Params.rate / 1000;
+			if (sent >= allowed)
+			{
+				Sleep(1);
+				continue;
+			}
+			if (allowed - sent < cnt)
+				cnt = (u32)(allowed - sent);
+		}
+		for (u32 i = 0; i < cnt; i++)
+			GenRec(DPs_out + i * GPU_DP_SIZE);
+		if (KeysSet && Params.coll_every && (sent + cnt >= next_coll))
+		{
+			GenCollision(DPs_out + cnt * GPU_DP_SIZE);
+			cnt += 2;
+			next_coll += Params.coll_every;
+		}
+		Host->AddPoints((u32*)DPs_out, cnt, cnt * ops_per_dp);
+		DPsCnt += cnt;
+		if (WildRestart) //synthetic kangaroos are random anyway, only count wilds that would restart
+			for (u32 i = 0; i < cnt; i++)
+				if ((*(u32*)(DPs_out + i * GPU_DP_SIZE + 40) & 0xFFFF) != TAME)
+					RestartCnt++;
+		sent += cnt;
+		stats_ops += cnt * ops_per_dp;
+
+		u64 tm = GetTickCount64();
+		if (tm - stats_tm >= 100)
+		{
+			SpeedStats[cur_stats_ind] = (int)(stats_ops / ((tm - stats_tm) * 1000));
+			cur_stats_ind = (cur_stats_ind + 1) % STATS_WND_SIZE;
+			stats_tm = tm;
+			stats_ops = 0;
+		}
+	}
+}
+
+void RCSynthKang::Release()
+{
+	free(DPs_out);
+	DPs_out = NULL;
+	DPs_out_cnt = 0;
+}
+
+int RCSynthKang::GetStatsSpeed()
+{
+	int res = SpeedStats[0];
+	for (int i = 1; i < STATS_WND_SIZE; i++)
+		res += SpeedStats[i];
+	return res / STATS_WND_SIZE;
+}
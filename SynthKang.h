@@ -0,0 +1,58 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include <random>
+#include "KangWorker.h"
+
+//synthetic worker for load testing of DPs processing on host, no GPU is used
+//it sends random DPs in the same format as GPU, every DP counts as 2^DP ops
+//if keys are known, true collisions are injected: tame and wild DPs with same x and distances that give the key
+
+#define SYNTH_KANG_CNT		(256 * 24 * 128)
+
+struct TSynthParams
+{
+	u32 rate; //DPs per second per worker, 0 - unlimited
+	u32 batch; //DPs per AddPoints call
+	u32 tame_pct; //percent of tame DPs
+	u32 coll_every; //one true collision per this number of DPs, 0 - no collisions
+};
+
+class RCSynthKang : public RCKangWorker
+{
+private:
+	volatile bool StopFlag;
+	int PntCnt;
+	int Range; //in bits
+	int DP; //in bits
+	EcInt HalfRange;
+	u8* DPs_out;
+	u32 DPs_out_cnt; //size of DPs_out in records
+	std::mt19937_64 rnd;
+	int cur_stats_ind;
+	int SpeedStats[STATS_WND_SIZE];
+
+	void RndDist(EcInt* d, int bits);
+	void SetRec(u8* rec, u8* x, EcInt* d, int kind, int target);
+	void GenRec(u8* rec);
+	void GenCollision(u8* rec);
+public:
+	TSynthParams Params;
+	EcInt Keys[MAX_TARGET_CNT]; //private keys of points to solve
+	bool KeysSet; //if false, collisions are not injected
+
+	RCSynthKang();
+	~RCSynthKang() { Release(); }
+	int CalcKangCnt();
+	bool Prepare(EcPoint* _PntsToSolve, int _PntCnt, int _Range, int _DP, EcJMP* _EcJumps1, EcJMP* _EcJumps2, EcJMP* _EcJumps3);
+	void Stop();
+	void Execute();
+	void Release();
+	int GetStatsSpeed();
+	const char* GetKind() { return "synth"; }
+};
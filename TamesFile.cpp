@@ -0,0 +1,536 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <stdlib.h>
+#include <math.h>
+#include "TamesFile.h"
+
+#define TAMES_IO_BUF_SIZE	(16 * 1024 * 1024)
+//worst case per record: rice escape (32 + 72 bits) + distance (176 bits) + type (8 bits) < 40 bytes
+#define PACK_BUF_SIZE		(TAMES_MAX_BUCKET * 40 + 64)
+#define RICE_ESCAPE			32
+#define DIST_LEN			22
+#define PREFIX_CNT			(256 * 256 * 256)
+
+//bits are stored starting from LSB
+struct TBitWriter
+{
+	u8* buf;
+	u32 pos;
+	u64 acc;
+	int acc_bits;
+
+	void Init(u8* _buf) { buf = _buf; pos = 0; acc = 0; acc_bits = 0; }
+	//up to 56 bits
+	void Write(u64 val, int nbits)
+	{
+		acc |= (val & ((1ull << nbits) - 1)) << acc_bits;
+		acc_bits += nbits;
+		while (acc_bits >= 8)
+		{
+			buf[pos++] = (u8)acc;
+			acc >>= 8;
+			acc_bits -= 8;
+		}
+	}
+	//72-bit value as hi:lo
+	void Write72(u64 hi, u64 lo, int nbits)
+	{
+		int n = (nbits < 32) ? nbits : 32;
+		Write(lo, n);
+		nbits -= n;
+		n = (nbits < 32) ? nbits : 32;
+		Write(lo >> 32, n);
+		nbits -= n;
+		Write(hi, nbits);
+	}
+	void WriteBytes(u8* data, int nbits)
+	{
+		int i = 0;
+		for (; nbits >= 8; nbits -= 8)
+			Write(data[i++], 8);
+		if (nbits)
+			Write(data[i], nbits);
+	}
+	void Flush()
+	{
+		if (acc_bits)
+			buf[pos++] = (u8)acc;
+		acc = 0;
+		acc_bits = 0;
+	}
+};
+
+struct TBitReader
+{
+	u8* buf;
+	u32 pos;
+	u32 size;
+	u64 acc;
+	int acc_bits;
+
+	void Init(u8* _buf, u32 _size) { buf = _buf; size = _size; pos = 0; acc = 0; acc_bits = 0; }
+	//up to 56 bits
+	u64 Read(int nbits)
+	{
+		while (acc_bits < nbits)
+		{
+			u64 b = (pos < size) ? buf[pos] : 0;
+			pos++;
+			acc |= b << acc_bits;
+			acc_bits += 8;
+		}
+		u64 res = acc & ((1ull << nbits) - 1);
+		acc >>= nbits;
+		acc_bits -= nbits;
+		return res;
+	}
+	void Read72(u64* hi, u64* lo, int nbits)
+	{
+		int n = (nbits < 32) ? nbits : 32;
+		*lo = Read(n);
+		nbits -= n;
+		n = (nbits < 32) ? nbits : 32;
+		*lo |= Read(n) << 32;
+		nbits -= n;
+		*hi = Read(nbits);
+	}
+	void ReadBytes(u8* data, int nbits)
+	{
+		int i = 0;
+		for (; nbits >= 8; nbits -= 8)
+			data[i++] = (u8)Read(8);
+		if (nbits)
+			data[i] = (u8)Read(nbits);
+	}
+	bool IsOverrun() { return pos > size; }
+};
+
+//key is DB_FIND_LEN (9) bytes compared by memcmp, so it's a 72-bit big-endian value
+static void KeyToInt(u8* key, u64* hi, u64* lo)
+{
+	*hi = key[0];
+	*lo = 0;
+	for (int i = 1; i < DB_FIND_LEN; i++)
+		*lo = (*lo << 8) | key[i];
+}
+
+static void IntToKey(u64 hi, u64 lo, u8* key)
+{
+	key[0] = (u8)hi;
+	for (int i = DB_FIND_LEN - 1; i > 0; i--)
+	{
+		key[i] = (u8)lo;
+		lo >>= 8;
+	}
+}
+
+static int BitLen64(u64 val)
+{
+	int res = 0;
+	while (val)
+	{
+		res++;
+		val >>= 1;
+	}
+	return res;
+}
+
+//min width of two's complement value including sign bit
+static int SignedBitLen(u8* d)
+{
+	u8 ext = (d[DIST_LEN - 1] & 0x80) ? 0xFF : 0x00;
+	int i = DIST_LEN - 1;
+	while ((i >= 0) && (d[i] == ext))
+		i--;
+	if (i < 0)
+		return 1;
+	return 8 * i + BitLen64(d[i] ^ ext) + 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TTamesWriter::TTamesWriter()
+{
+	fp = NULL;
+	io_buf = NULL;
+	pack_buf = NULL;
+}
+
+TTamesWriter::~TTamesWriter()
+{
+	if (fp)
+		fclose(fp);
+	free(io_buf);
+	free(pack_buf);
+}
+
+bool TTamesWriter::WriteVarint(u64 val)
+{
+	u8 buf[10];
+	int len = 0;
+	while (val >= 0x80)
+	{
+		buf[len++] = (u8)val | 0x80;
+		val >>= 7;
+	}
+	buf[len++] = (u8)val;
+	return fwrite(buf, 1, len, fp) == (size_t)len;
+}
+
+bool TTamesWriter::Open(char* fn, u8* header, bool _compressed)
+{
+	compressed = _compressed;
+	next_prefix = 0;
+	fp = fopen(fn, "wb");
+	if (!fp)
+		return false;
+	io_buf = (char*)malloc(TAMES_IO_BUF_SIZE);
+	setvbuf(fp, io_buf, _IOFBF, TAMES_IO_BUF_SIZE);
+	if (compressed)
+	{
+		u8 sign[8];
+		memcpy(sign, TAMES_MAGIC, 4);
+		sign[4] = TAMES_VERSION;
+		sign[5] = sign[6] = sign[7] = 0;
+		if (fwrite(sign, 1, sizeof(sign), fp) != sizeof(sign))
+			return false;
+		pack_buf = (u8*)malloc(PACK_BUF_SIZE);
+	}
+	return fwrite(header, 1, 256, fp) == 256;
+}
+
+//raw format stores counters for empty prefixes too
+bool TTamesWriter::WriteEmptyTill(int prefix)
+{
+	static u8 zeros[4096];
+	while (next_prefix < prefix)
+	{
+		int cnt = prefix - next_prefix;
+		if (cnt > (int)sizeof(zeros) / 2)
+			cnt = sizeof(zeros) / 2;
+		if (fwrite(zeros, 2, cnt, fp) != (size_t)cnt)
+			return false;
+		next_prefix += cnt;
+	}
+	return true;
+}
+
+bool TTamesWriter::AddBucket(int prefix, u8* recs, int cnt)
+{
+	if (!cnt)
+		return true;
+	if ((prefix < next_prefix) || (prefix >= PREFIX_CNT) || (cnt > TAMES_MAX_BUCKET))
+		return false;
+	if (!compressed)
+	{
+		if (!WriteEmptyTill(prefix))
+			return false;
+		u16 cnt16 = (u16)cnt;
+		if (fwrite(&cnt16, 1, 2, fp) != 2)
+			return false;
+		next_prefix = prefix + 1;
+		return fwrite(recs, DB_REC_LEN, cnt, fp) == (size_t)cnt;
+	}
+
+	u64 hi, lo;
+	int dbits = 1;
+	int tbits = 0;
+	for (int i = 0; i < cnt; i++)
+	{
+		u8* rec = recs + i * DB_REC_LEN;
+		int w = SignedBitLen(rec + DB_FIND_LEN);
+		if (w > dbits)
+			dbits = w;
+		if (rec[DB_REC_LEN - 1])
+			tbits = 8;
+	}
+	//keys are uniformly distributed, so average gap is about max_key / cnt
+	KeyToInt(recs + (cnt - 1) * DB_REC_LEN, &hi, &lo);
+	int k = (hi ? 64 + BitLen64(hi) : BitLen64(lo)) - BitLen64(cnt);
+	if (k < 0)
+		k = 0;
+
+	TBitWriter bw;
+	bw.Init(pack_buf);
+	u64 prev_hi = 0, prev_lo = 0;
+	for (int i = 0; i < cnt; i++)
+	{
+		u8* rec = recs + i * DB_REC_LEN;
+		KeyToInt(rec, &hi, &lo);
+		u64 dlo = lo - prev_lo;
+		u64 dhi = hi - prev_hi - (lo < prev_lo ? 1 : 0);
+		prev_hi = hi;
+		prev_lo = lo;
+		//quotient for rice coding
+		u64 q;
+		bool escape = false;
+		if (k >= 64)
+			q = dhi >> (k - 64);
+		else
+		{
+			escape = (k < 8) && (dhi >> k);
+			q = k ? ((dlo >> k) | (dhi << (64 - k))) : dlo;
+		}
+		if (escape || (q >= RICE_ESCAPE))
+		{
+			bw.Write((1ull << RICE_ESCAPE) - 1, RICE_ESCAPE);
+			bw.Write72(dhi, dlo, 72);
+		}
+		else
+		{
+			bw.Write((1ull << q) - 1, (int)q + 1);
+			bw.Write72(dhi, dlo, k);
+		}
+		bw.WriteBytes(rec + DB_FIND_LEN, dbits);
+		if (tbits)
+			bw.Write(rec[DB_REC_LEN - 1], tbits);
+	}
+	bw.Flush();
+
+	u8 params[3];
+	params[0] = (u8)k;
+	params[1] = (u8)dbits;
+	params[2] = (u8)tbits;
+	if (!WriteVarint(cnt) || !WriteVarint(prefix - next_prefix))
+		return false;
+	if (fwrite(params, 1, 3, fp) != 3)
+		return false;
+	if (!WriteVarint(bw.pos))
+		return false;
+	next_prefix = prefix + 1;
+	return fwrite(pack_buf, 1, bw.pos, fp) == bw.pos;
+}
+
+bool TTamesWriter::Close()
+{
+	if (!fp)
+		return false;
+	bool res = compressed ? WriteVarint(0) : WriteEmptyTill(PREFIX_CNT);
+	res = res && FlushFileToDisk(fp); //file is renamed after closing, make sure data are on disk
+	if (fclose(fp))
+		res = false;
+	fp = NULL;
+	return res;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TTamesReader::TTamesReader()
+{
+	fp = NULL;
+	io_buf = NULL;
+	pack_buf = NULL;
+	IsCompressed = false;
+}
+
+TTamesReader::~TTamesReader()
+{
+	Close();
+}
+
+bool TTamesReader::ReadVarint(u64* val)
+{
+	*val = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		int b = fgetc(fp);
+		if (b == EOF)
+			return false;
+		*val |= (u64)(b & 0x7F) << shift;
+		if (!(b & 0x80))
+			return true;
+	}
+	return false;
+}
+
+bool TTamesReader::Open(char* fn)
+{
+	cur_prefix = 0;
+	fp = fopen(fn, "rb");
+	if (!fp)
+		return false;
+	io_buf = (char*)malloc(TAMES_IO_BUF_SIZE);
+	setvbuf(fp, io_buf, _IOFBF, TAMES_IO_BUF_SIZE);
+	u8 sign[8];
+	if (fread(sign, 1, 4, fp) != 4)
+		return false;
+	IsCompressed = memcmp(sign, TAMES_MAGIC, 4) == 0;
+	if (!IsCompressed)
+	{
+		//raw format has no signature, first bytes are header
+		memcpy(Header, sign, 4);
+		return fread(Header + 4, 1, sizeof(Header) - 4, fp) == sizeof(Header) - 4;
+	}
+	if (fread(sign + 4, 1, 4, fp) != 4)
+		return false;
+	if (sign[4] != TAMES_VERSION)
+	{
+		printf("unsupported tames file version %d\r\n", sign[4]);
+		return false;
+	}
+	pack_buf = (u8*)malloc(PACK_BUF_SIZE);
+	return fread(Header, 1, sizeof(Header), fp) == sizeof(Header);
+}
+
+int TTamesReader::ReadBucket(int* prefix, u8* recs)
+{
+	if (!IsCompressed)
+	{
+		while (cur_prefix < PREFIX_CNT)
+		{
+			u16 cnt;
+			if (fread(&cnt, 1, 2, fp) != 2)
+				return -1;
+			*prefix = cur_prefix++;
+			if (!cnt)
+				continue;
+			if (fread(recs, DB_REC_LEN, cnt, fp) != cnt)
+				return -1;
+			return cnt;
+		}
+		return 0;
+	}
+
+	u64 cnt, delta, len;
+	u8 params[3];
+	if (!ReadVarint(&cnt))
+		return -1;
+	if (!cnt)
+		return 0;
+	if (!ReadVarint(&delta) || (fread(params, 1, 3, fp) != 3) || !ReadVarint(&len))
+		return -1;
+	int k = params[0];
+	int dbits = params[1];
+	int tbits = params[2];
+	if ((cnt > TAMES_MAX_BUCKET) || (delta >= (u64)(PREFIX_CNT - cur_prefix)) || (len > PACK_BUF_SIZE) || (k > 72) || !dbits || (dbits > 8 * DIST_LEN) || (tbits > 8))
+		return -1;
+	if (fread(pack_buf, 1, len, fp) != len)
+		return -1;
+	*prefix = cur_prefix + (int)delta;
+	cur_prefix = *prefix + 1;
+
+	TBitReader br;
+	br.Init(pack_buf, (u32)len);
+	u64 hi = 0, lo = 0;
+	for (int i = 0; i < (int)cnt; i++)
+	{
+		u8* rec = recs + i * DB_REC_LEN;
+		u64 q = 0;
+		while ((q < RICE_ESCAPE) && br.Read(1))
+			q++;
+		u64 dhi, dlo;
+		if (q == RICE_ESCAPE)
+			br.Read72(&dhi, &dlo, 72);
+		else
+		{
+			br.Read72(&dhi, &dlo, k);
+			if (k >= 64)
+				dhi |= q << (k - 64);
+			else
+				if (k)
+				{
+					dlo |= q << k;
+					dhi |= q >> (64 - k);
+				}
+				else
+					dlo = q;
+		}
+		lo += dlo;
+		hi += dhi + (lo < dlo ? 1 : 0);
+		IntToKey(hi, lo, rec);
+
+		u8* d = rec + DB_FIND_LEN;
+		memset(d, 0, DIST_LEN);
+		br.ReadBytes(d, dbits);
+		int sb = dbits - 1;
+		if ((d[sb / 8] >> (sb % 8)) & 1)
+		{
+			d[sb / 8] |= (u8)(0xFF << (sb % 8));
+			memset(d + sb / 8 + 1, 0xFF, DIST_LEN - sb / 8 - 1);
+		}
+		rec[DB_REC_LEN - 1] = tbits ? (u8)br.Read(tbits) : 0;
+	}
+	if (br.IsOverrun())
+		return -1;
+	return (int)cnt;
+}
+
+void TTamesReader::Close()
+{
+	if (fp)
+		fclose(fp);
+	fp = NULL;
+	free(io_buf);
+	io_buf = NULL;
+	free(pack_buf);
+	pack_buf = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//for compressed format it's an estimation for uniformly distributed keys and tame distances about 2^range
+u64 EstimateTamesFileSize(u64 cnt, int range, bool compressed)
+{
+	if (!compressed)
+		return 256 + 2ull * PREFIX_CNT + DB_REC_LEN * cnt;
+	if (!cnt)
+		return 8 + 256 + 1;
+	double buckets = PREFIX_CNT * (1.0 - exp(-(double)cnt / PREFIX_CNT));
+	double rec_bits = 8 * DB_FIND_LEN - log2(cnt / buckets) + 2 + (range + 2);
+	return 8 + 256 + (u64)(7 * buckets + cnt * rec_bits / 8) + 1;
+}
+
+u64 GetTamesCntForFileSize(u64 size, int range, bool compressed)
+{
+	u64 lo = 0;
+	u64 hi = size / 8;
+	while (lo < hi)
+	{
+		u64 mid = (lo + hi + 1) / 2;
+		if (EstimateTamesFileSize(mid, range, compressed) <= size)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
+bool GetTamesFileCnt(char* fn, u64* cnt)
+{
+	TTamesReader rd;
+	if (!rd.Open(fn))
+		return false;
+	bool compressed = rd.IsCompressed;
+	int range = rd.Header[0];
+	rd.Close();
+	FILE* fp = fopen(fn, "rb");
+	if (!fp)
+		return false;
+	fseek64(fp, 0, SEEK_END);
+	u64 size = ftell64(fp);
+	fclose(fp);
+	*cnt = GetTamesCntForFileSize(size, range, compressed);
+	return true;
+}
+
+//hist[i] - number of tames with i hits, returns min hits for selected tames and how many tames with min hits are selected
+void SelectTamesByHits(u64* hist, u64 max_cnt, int* min_hits, u64* min_hits_cnt)
+{
+	u64 sum = 0;
+	for (int i = TAMES_MAX_HITS; i >= 0; i--)
+	{
+		if (sum + hist[i] >= max_cnt)
+		{
+			*min_hits = i;
+			*min_hits_cnt = max_cnt - sum;
+			return;
+		}
+		sum += hist[i];
+	}
+	*min_hits = 0;
+	*min_hits_cnt = hist[0];
+}
@@ -0,0 +1,67 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+
+//tames file formats:
+//raw: Header(256), then for every 3-byte prefix: cnt(2) + cnt * DB_REC_LEN records
+//compressed: TAMES_MAGIC(4), version(1), reserved(3), Header(256), then only non-empty prefixes:
+//	cnt(varint), prefix delta(varint), rice k(1), distance bits(1), type bits(1), payload len(varint), payload
+//	payload is a bitstream, for every record: rice-coded key delta, distance (two's complement, "distance bits" wide), type
+//	cnt = 0 marks end of file
+
+#define TAMES_MAGIC			"RCTZ"
+#define TAMES_VERSION		1
+#define TAMES_MAX_BUCKET	0xFFFF
+//in tames generation mode type byte of DB record counts how many times the tame was reached again, it's reset before saving
+#define TAMES_MAX_HITS		0xFF
+
+class TTamesWriter
+{
+private:
+	FILE* fp;
+	char* io_buf;
+	bool compressed;
+	int next_prefix;
+	u8* pack_buf;
+	bool WriteVarint(u64 val);
+	bool WriteEmptyTill(int prefix);
+public:
+	TTamesWriter();
+	~TTamesWriter();
+	bool Open(char* fn, u8* header, bool _compressed);
+	//buckets must be added in ascending prefix order, records in bucket must be sorted
+	bool AddBucket(int prefix, u8* recs, int cnt);
+	bool Close();
+};
+
+class TTamesReader
+{
+private:
+	FILE* fp;
+	char* io_buf;
+	int cur_prefix;
+	u8* pack_buf;
+	bool ReadVarint(u64* val);
+public:
+	u8 Header[256];
+	bool IsCompressed;
+
+	TTamesReader();
+	~TTamesReader();
+	bool Open(char* fn);
+	//returns records count of next non-empty bucket, 0 - end of file, -1 - error
+	int ReadBucket(int* prefix, u8* recs);
+	void Close();
+};
+
+u64 EstimateTamesFileSize(u64 cnt, int range, bool compressed);
+u64 GetTamesCntForFileSize(u64 size, int range, bool compressed);
+//number of tames in file by its size, exact for raw format, estimation for compressed one
+bool GetTamesFileCnt(char* fn, u64* cnt);
+void SelectTamesByHits(u64* hist, u64 max_cnt, int* min_hits, u64* min_hits_cnt);
@@ -0,0 +1,398 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#include <stdlib.h>
+#include <algorithm>
+#include <queue>
+#include "TamesSpill.h"
+
+#define RUN_READ_CNT		(8 * 1024)
+
+THR_PROC(spill_thr_proc)
+{
+	((TTamesSpill*)data)->SaveRun();
+	return 0;
+}
+
+static bool RecLess(const DBRec& a, const DBRec& b)
+{
+	return memcmp(a.x, b.x, sizeof(a.x)) < 0;
+}
+
+//type of tame record is hits counter, every copy is one more hit
+static u8 AddHits(u8 hits1, u8 hits2)
+{
+	u32 res = (u32)hits1 + hits2 + 1;
+	return (res > TAMES_MAX_HITS) ? TAMES_MAX_HITS : (u8)res;
+}
+
+//reads sorted records from run file or from existing tames file
+struct TRunReader
+{
+	FILE* fp;
+	TTamesReader* tames;
+	u8* bucket;
+	DBRec* buf;
+	u32 buf_cnt;
+	u32 buf_pos;
+	u64 left;
+	bool err;
+
+	TRunReader() { fp = NULL; tames = NULL; bucket = NULL; buf = NULL; err = false; }
+	~TRunReader() { if (fp) fclose(fp); delete tames; free(bucket); free(buf); }
+	bool Open(char* fn)
+	{
+		fp = fopen(fn, "rb");
+		if (!fp)
+			return false;
+		TRunHeader hdr;
+		if ((fread(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) || memcmp(hdr.magic, RUN_MAGIC, 4) || (hdr.version != RUN_VERSION))
+			return false;
+		left = hdr.cnt;
+		buf = (DBRec*)malloc(RUN_READ_CNT * sizeof(DBRec));
+		buf_cnt = buf_pos = 0;
+		return true;
+	}
+	bool OpenTames(char* fn)
+	{
+		tames = new TTamesReader();
+		if (!tames->Open(fn))
+			return false;
+		bucket = (u8*)malloc(TAMES_MAX_BUCKET * DB_REC_LEN);
+		buf = (DBRec*)malloc(TAMES_MAX_BUCKET * sizeof(DBRec));
+		buf_cnt = buf_pos = 0;
+		return true;
+	}
+	//records in tames file bucket are not sorted
+	bool NextBucket()
+	{
+		int prefix;
+		int cnt = tames->ReadBucket(&prefix, bucket);
+		err = cnt < 0;
+		if (cnt <= 0)
+			return false;
+		for (int i = 0; i < cnt; i++)
+		{
+			buf[i].x[0] = (u8)(prefix >> 16);
+			buf[i].x[1] = (u8)(prefix >> 8);
+			buf[i].x[2] = (u8)prefix;
+			memcpy(buf[i].x + 3, bucket + i * DB_REC_LEN, DB_REC_LEN);
+		}
+		std::sort(buf, buf + cnt, RecLess);
+		buf_cnt = cnt;
+		buf_pos = 0;
+		return true;
+	}
+	DBRec* Cur() { return buf + buf_pos; }
+	//returns false at the end of run or error
+	bool Next()
+	{
+		if (++buf_pos < buf_cnt)
+			return true;
+		if (tames)
+			return NextBucket();
+		if (!left)
+			return false;
+		buf_cnt = (left > RUN_READ_CNT) ? RUN_READ_CNT : (u32)left;
+		buf_pos = 0;
+		left -= buf_cnt;
+		err = fread(buf, sizeof(DBRec), buf_cnt, fp) != buf_cnt;
+		return !err;
+	}
+};
+
+TTamesSpill::TTamesSpill()
+{
+	buf_cnt = 0;
+	thr_active = false;
+}
+
+TTamesSpill::~TTamesSpill()
+{
+	Release();
+}
+
+void TTamesSpill::GetRunName(int ind, char* fn)
+{
+	sprintf(fn, "%s.run%04d", base_fn, ind);
+}
+
+bool TTamesSpill::Init(char* tames_fn, u64 mem_size, int _range, int _dp, u64* resumed_ops)
+{
+	strcpy(base_fn, tames_fn);
+	range = _range;
+	dp = _dp;
+	buf_cnt = mem_size / 2 / sizeof(DBRec); //two buffers: one is collected, another one is saved
+	if (buf_cnt < 1024)
+		buf_cnt = 1024;
+	active.clear();
+	active.reserve(buf_cnt);
+	saving.clear();
+	saving.reserve(buf_cnt);
+	run_cnt = 0;
+	spilled_cnt = 0;
+	total_ops = 0;
+	failed = false;
+	*resumed_ops = 0;
+	while (1)
+	{
+		char fn[1100];
+		GetRunName(run_cnt, fn);
+		FILE* fp = fopen(fn, "rb");
+		if (!fp)
+			break;
+		TRunHeader hdr;
+		bool ok = (fread(&hdr, 1, sizeof(hdr), fp) == sizeof(hdr)) && !memcmp(hdr.magic, RUN_MAGIC, 4) && (hdr.version == RUN_VERSION);
+		fclose(fp);
+		if (!ok)
+		{
+			printf("invalid tames run file %s\r\n", fn);
+			return false;
+		}
+		//runs of other generation cannot be merged, user must delete them
+		if ((hdr.range != (u32)range) || (hdr.dp != (u32)dp))
+		{
+			printf("tames run file %s has range %d and DP %d, it's from another generation\r\n", fn, hdr.range, hdr.dp);
+			return false;
+		}
+		spilled_cnt += hdr.cnt;
+		if (hdr.total_ops > *resumed_ops)
+			*resumed_ops = hdr.total_ops;
+		run_cnt++;
+	}
+	total_ops = *resumed_ops;
+	return true;
+}
+
+void TTamesSpill::Add(DBRec* rec)
+{
+	active.push_back(*rec);
+	if (active.size() >= buf_cnt)
+	{
+		WaitSaving();
+		active.swap(saving);
+		saving_ops = total_ops;
+		if (!StartSaving())
+			SaveRun();
+	}
+}
+
+bool TTamesSpill::StartSaving()
+{
+	thr_active = StartThread(&thr, spill_thr_proc, this);
+	return thr_active;
+}
+
+void TTamesSpill::WaitSaving()
+{
+	if (!thr_active)
+		return;
+	WaitThread(thr);
+	thr_active = false;
+}
+
+//sorts "saving" buffer and writes it as next run
+void TTamesSpill::SaveRun()
+{
+	std::sort(saving.begin(), saving.end(), RecLess);
+	u64 cnt = 0;
+	for (u64 i = 0; i < saving.size(); i++)
+		if (!cnt || memcmp(saving[cnt - 1].x, saving[i].x, sizeof(saving[i].x)))
+			saving[cnt++] = saving[i];
+		else
+			saving[cnt - 1].type = AddHits(saving[cnt - 1].type, saving[i].type);
+
+	char fn[1100], tmp_fn[1200];
+	GetRunName(run_cnt, fn);
+	sprintf(tmp_fn, "%s.tmp", fn);
+	TRunHeader hdr;
+	memcpy(hdr.magic, RUN_MAGIC, 4);
+	hdr.version = RUN_VERSION;
+	hdr.cnt = cnt;
+	hdr.total_ops = saving_ops;
+	hdr.range = range;
+	hdr.dp = dp;
+	bool ok = false;
+	FILE* fp = fopen(tmp_fn, "wb");
+	if (fp)
+	{
+		ok = (fwrite(&hdr, 1, sizeof(hdr), fp) == sizeof(hdr)) && (fwrite(saving.data(), sizeof(DBRec), cnt, fp) == cnt);
+		ok = FlushFileToDisk(fp) && ok;
+		fclose(fp);
+		ok = ok && RenameFile(tmp_fn, fn);
+	}
+	if (ok)
+	{
+		run_cnt++;
+		spilled_cnt += cnt;
+	}
+	else
+	{
+		printf("\r\ntames run %s saving failed!\r\n", fn);
+		failed = true;
+	}
+	saving.clear();
+}
+
+//merges all runs and base tames file, same tames are combined and their hits are summed
+//if wr is NULL only hits histogram is calculated, otherwise selected tames are written
+bool TTamesSpill::MergePass(char* base_fn, TTamesWriter* wr, u64* hist, bool select, int min_hits, u64 min_hits_cnt)
+{
+	char run_fn[1100];
+	int stream_cnt = run_cnt + (base_fn ? 1 : 0);
+	std::vector <TRunReader> readers(stream_cnt);
+	auto cmp = [&readers](int a, int b) { return RecLess(*readers[b].Cur(), *readers[a].Cur()); };
+	std::priority_queue <int, std::vector <int>, decltype(cmp)> heap(cmp);
+	for (int i = 0; i < run_cnt; i++)
+	{
+		GetRunName(i, run_fn);
+		if (!readers[i].Open(run_fn))
+		{
+			printf("cannot read tames run %s\r\n", run_fn);
+			return false;
+		}
+		if (readers[i].Next())
+			heap.push(i);
+	}
+	if (base_fn)
+	{
+		if (!readers[run_cnt].OpenTames(base_fn))
+		{
+			printf("cannot read tames file %s\r\n", base_fn);
+			return false;
+		}
+		if (readers[run_cnt].Next())
+			heap.push(run_cnt);
+	}
+
+	u8* bucket = wr ? (u8*)malloc(TAMES_MAX_BUCKET * DB_REC_LEN) : NULL;
+	int bucket_cnt = 0;
+	int bucket_prefix = -1;
+	u64 dropped = 0;
+	DBRec cur;
+	bool has_cur = false;
+	bool ok = true;
+	while (ok)
+	{
+		int ind = -1;
+		DBRec* rec = NULL;
+		if (!heap.empty())
+		{
+			ind = heap.top();
+			heap.pop();
+			rec = readers[ind].Cur();
+		}
+		if (rec && has_cur && !memcmp(cur.x, rec->x, sizeof(rec->x)))
+			cur.type = AddHits(cur.type, rec->type);
+		else
+		{
+			//all copies of current tame are collected
+			if (has_cur && !wr)
+				hist[cur.type]++;
+			bool keep = has_cur && wr;
+			if (keep && select)
+			{
+				if (cur.type < min_hits)
+					keep = false;
+				else
+					if (cur.type == min_hits)
+					{
+						if (min_hits_cnt)
+							min_hits_cnt--;
+						else
+							keep = false;
+					}
+			}
+			if (keep)
+			{
+				int prefix = (cur.x[0] << 16) | (cur.x[1] << 8) | cur.x[2];
+				if (prefix != bucket_prefix)
+				{
+					ok = wr->AddBucket(bucket_prefix, bucket, bucket_cnt);
+					bucket_prefix = prefix;
+					bucket_cnt = 0;
+				}
+				cur.type = TAME;
+				if (bucket_cnt < TAMES_MAX_BUCKET)
+					memcpy(bucket + DB_REC_LEN * bucket_cnt++, cur.x + 3, DB_REC_LEN);
+				else
+					dropped++;
+			}
+			if (!rec)
+				break;
+			cur = *rec;
+			has_cur = true;
+		}
+		if (readers[ind].Next())
+			heap.push(ind);
+	}
+	for (int i = 0; i < stream_cnt; i++)
+		if (readers[i].err)
+		{
+			printf("tames stream %d read error\r\n", i);
+			ok = false;
+		}
+	if (wr)
+		ok = ok && wr->AddBucket(bucket_prefix, bucket, bucket_cnt);
+	free(bucket);
+	if (dropped)
+		printf("%llu tames dropped because of prefix overflow\r\n", dropped);
+	return ok;
+}
+
+bool TTamesSpill::Merge(char* fn, char* base_fn, u8* header, bool compressed, u64 max_cnt)
+{
+	WaitSaving();
+	if (!active.empty())
+	{
+		active.swap(saving);
+		saving_ops = total_ops;
+		SaveRun();
+	}
+	if (failed)
+		return false;
+
+	int min_hits = 0;
+	u64 min_hits_cnt = 0;
+	if (max_cnt)
+	{
+		u64 hist[TAMES_MAX_HITS + 1];
+		memset(hist, 0, sizeof(hist));
+		if (!MergePass(base_fn, NULL, hist, false, 0, 0))
+			return false;
+		SelectTamesByHits(hist, max_cnt, &min_hits, &min_hits_cnt);
+	}
+
+	char tmp_fn[1100];
+	sprintf(tmp_fn, "%s.tmp", fn);
+	TTamesWriter wr;
+	if (!wr.Open(tmp_fn, header, compressed))
+		return false;
+	bool ok = MergePass(base_fn, &wr, NULL, max_cnt != 0, min_hits, min_hits_cnt);
+	ok = wr.Close() && ok;
+	if (!ok || !RenameFile(tmp_fn, fn))
+	{
+		remove(tmp_fn);
+		return false;
+	}
+	char run_fn[1100];
+	for (int i = 0; i < run_cnt; i++)
+	{
+		GetRunName(i, run_fn);
+		remove(run_fn);
+	}
+	run_cnt = 0;
+	spilled_cnt = 0;
+	return true;
+}
+
+void TTamesSpill::Release()
+{
+	WaitSaving();
+	std::vector <DBRec>().swap(active);
+	std::vector <DBRec>().swap(saving);
+	buf_cnt = 0;
+}
@@ -0,0 +1,65 @@
+// This file is a part of RCKangaroo software
+// (c) 2024, RetiredCoder (RC)
+// License: GPLv3, see "LICENSE.TXT" file
+// https://github.com/RetiredC
+
+
+#pragma once
+
+#include "utils.h"
+#include "TamesFile.h"
+
+//in tames generation mode DPs are collected to a bounded buffer, when it's full it's sorted and saved to "<tames>.runNNNN" file in background
+//at the end all runs are merged to the tames file, so RAM usage doesn't depend on the number of tames
+//run file: TRunHeader, then cnt * DBRec sorted by x
+
+#define RUN_MAGIC			"RCTR"
+#define RUN_VERSION			2
+
+#pragma pack(push, 1)
+struct TRunHeader
+{
+	char magic[4];
+	u32 version;
+	u64 cnt;
+	u64 total_ops;
+	u32 range;
+	u32 dp;
+};
+#pragma pack(pop)
+
+class TTamesSpill
+{
+private:
+	char base_fn[1024];
+	int range;
+	int dp;
+	u64 buf_cnt; //max recs in one buffer
+	std::vector <DBRec> active;
+	std::vector <DBRec> saving;
+	u64 saving_ops;
+	int run_cnt;
+	u64 spilled_cnt;
+	u64 total_ops;
+	bool thr_active;
+	bool failed;
+	HHANDLER thr;
+	void GetRunName(int ind, char* fn);
+	void WaitSaving();
+	bool StartSaving();
+	bool MergePass(char* base_fn, TTamesWriter* wr, u64* hist, bool select, int min_hits, u64 min_hits_cnt);
+public:
+	TTamesSpill();
+	~TTamesSpill();
+	bool IsActive() { return buf_cnt != 0; }
+	//picks up runs left by previous generation with the same range and DP, returns their ops
+	bool Init(char* tames_fn, u64 mem_size, int _range, int _dp, u64* resumed_ops);
+	void Add(DBRec* rec);
+	void SetOps(u64 ops) { total_ops = ops; }
+	u64 GetCnt() { return spilled_cnt + active.size(); }
+	//base_fn - existing tames file to merge with new tames, can be NULL
+	//max_cnt - if not zero, only max_cnt most reached tames are saved
+	bool Merge(char* fn, char* base_fn, u8* header, bool compressed, u64 max_cnt);
+	void Release();
+	void SaveRun();
+};
@@ -50,7 +50,23 @@ typedef char i8;
 #define WILD1				1  // Wild kangs1 
 #define WILD2				2  // Wild kangs2
 
+//herd composition, weights of kang types: kangaroos of worker are ordered by type,
+//first KangCnt * tame / sum kangs are tames, then KangCnt * wild1 / sum kangs are wild1, others are wild2
+struct THerd
+{
+	u32 tame;
+	u32 wild1;
+	u32 wild2;
+};
+
+//multi-target mode: wild kang solves target (kang_ind % TargetCnt), DP type is kang type | (target << 16)
+//in DB record type byte is kang type | (target << 2)
+#define MAX_TARGET_CNT		64
+
+//DP record: x(16), distance(24), kang type | (target << 16), kang_ind | (worker index << DP_KANG_BITS)
 #define GPU_DP_SIZE			48
+#define DP_KANG_BITS		24
+#define DP_KANG_UNKNOWN		0xFFFFFFFF //kangaroo is not known, for example for DPs from DP clients
 #define MAX_DP_CNT			(256 * 1024)
 
 #define JMP_MASK			(JMP_CNT-1)
@@ -88,7 +104,13 @@ struct TKparams
 	u64* LoopTable;
 	u32* dbg_buf;
 	u32* LoopedKangs;
+	u32* GenList; //kangs to restart by KernelGenList: count, then kang indexes
+	u64* GenPnts; //x0(32b), y0(32b), d(24b) for every listed kang, same layout as Kangs
 	bool IsGenMode; //tames generation mode
+	u32 TargetCnt; //number of points to solve
+	u32 WorkerInd; //for DP records
+	u32 TameCnt; //kangs [0, TameCnt) are tames
+	u32 Wild1Cnt; //kangs [TameCnt, TameCnt + Wild1Cnt) are wild1, others are wild2
 
 	u32 KernelA_LDS_Size;
 	u32 KernelB_LDS_Size;
@@ -5,12 +5,19 @@
 
 
 #include "utils.h"
+#include "TamesFile.h"
 #include <wchar.h>
+#include <chrono>
+#include <algorithm>
 
 #ifdef _WIN32
 
+#include <io.h>
+
 #else
 
+#include <dirent.h>
+
 void _BitScanReverse64(u32* index, u64 msk)
 {
 	*index = 63 - __builtin_clzll(msk);
@@ -54,10 +61,13 @@ u64 GetTickCount64()
 }
 #endif
 
+u64 GetTimeUs()
+{
+	return (u64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#define DB_REC_LEN			32
-#define DB_FIND_LEN			9
 #define DB_MIN_GROW_CNT		2
 
 //we need advanced memory management to reduce memory fragmentation
@@ -86,6 +96,11 @@ void MemPool::Clear()
 	pnt = 0;
 }
 
+u64 MemPool::GetMemSize()
+{
+	return (u64)pages.size() * MEM_PAGE_SIZE;
+}
+
 void* MemPool::AllocRec(u32* cmp_ptr)
 {
 	void* mem;
@@ -114,6 +129,8 @@ TFastBase::TFastBase()
 {
 	memset(lists, 0, sizeof(lists));
 	memset(Header, 0, sizeof(Header));
+	block_cnt = 0;
+	lists_size = 0;
 }
 
 TFastBase::~TFastBase()
@@ -136,16 +153,22 @@ void TFastBase::Clear()
 			}
 		mps[i].Clear();
 	}
+	block_cnt = 0;
+	lists_size = 0;
 }
 
 u64 TFastBase::GetBlockCnt()
 {
-	u64 blockCount = 0;
+	return block_cnt;
+}
+
+//records pages, lists index and lists
+u64 TFastBase::GetMemSize()
+{
+	u64 res = sizeof(lists) + lists_size;
 	for (int i = 0; i < 256; i++)
-		for (int j = 0; j < 256; j++)
-			for (int k = 0; k < 256; k++)
-				blockCount += lists[i][j][k].cnt;
-	return blockCount;
+		res += mps[i].GetMemSize();
+	return res;
 }
 
 // http://en.cppreference.com/w/cpp/algorithm/lower_bound
@@ -185,6 +208,7 @@ u8* TFastBase::AddDataBlock(u8* data, int pos)
 		if (newcap <= list->capacity)
 			return NULL; //failed
 		list->data = (u32*)realloc(list->data, newcap * sizeof(u32));
+		lists_size += (newcap - list->capacity) * sizeof(u32);
 		list->capacity = newcap;
 	}
 	int first = (pos < 0) ? lower_bound(list, data[0], data + 3) : pos;
@@ -194,6 +218,7 @@ u8* TFastBase::AddDataBlock(u8* data, int pos)
 	list->data[first] = cmp_ptr;
 	memcpy(ptr, data + 3, DB_REC_LEN);
 	list->cnt++;
+	block_cnt++;
 	return (u8*)ptr;
 }
 
@@ -226,87 +251,229 @@ label_not_found:
 	return NULL;
 }
 
-//slow but I hope you are not going to create huge DB with this proof-of-concept software
 bool TFastBase::LoadFromFile(char* fn)
 {
 	Clear();
-	FILE* fp = fopen(fn, "rb");
-	if (!fp)
+	TTamesReader rd;
+	if (!rd.Open(fn))
 		return false;
-	if (fread(Header, 1, sizeof(Header), fp) != sizeof(Header))
+	memcpy(Header, rd.Header, sizeof(Header));
+	u8* recs = (u8*)malloc(TAMES_MAX_BUCKET * DB_REC_LEN);
+	int cnt, prefix;
+	while ((cnt = rd.ReadBucket(&prefix, recs)) > 0)
 	{
-		fclose(fp);
-		return false;
+		int i = (prefix >> 16) & 0xFF;
+		TListRec* list = &lists[i][(prefix >> 8) & 0xFF][prefix & 0xFF];
+		u32 grow = cnt / 2;
+		if (grow < DB_MIN_GROW_CNT)
+			grow = DB_MIN_GROW_CNT;
+		u32 newcap = cnt + grow;
+		if (newcap > 0xFFFF)
+			newcap = 0xFFFF;
+		list->data = (u32*)realloc(list->data, newcap * sizeof(u32));
+		lists_size += ((i64)newcap - list->capacity) * sizeof(u32);
+		list->capacity = newcap;
+		for (int m = 0; m < cnt; m++)
+		{
+			u32 cmp_ptr;
+			void* ptr = mps[i].AllocRec(&cmp_ptr);
+			list->data[m] = cmp_ptr;
+			memcpy(ptr, recs + m * DB_REC_LEN, DB_REC_LEN);
+		}
+		block_cnt += cnt - list->cnt;
+		list->cnt = cnt;
 	}
-	for (int i = 0; i < 256; i++)
-		for (int j = 0; j < 256; j++)
-			for (int k = 0; k < 256; k++)
-			{
-				TListRec* list = &lists[i][j][k];
-				if (fread(&list->cnt, 1, 2, fp) != 2)
-					if (list->cnt)
-					{
-						u32 grow = list->cnt / 2;
-						if (grow < DB_MIN_GROW_CNT)
-							grow = DB_MIN_GROW_CNT;
-						u32 newcap = list->cnt + grow;
-						if (newcap > 0xFFFF)
-							newcap = 0xFFFF;
-						list->data = (u32*)realloc(list->data, newcap * sizeof(u32));
-						list->capacity = newcap;
-
-						for (int m = 0; m < list->cnt; m++)
-						{
-							u32 cmp_ptr;
-							void* ptr = mps[i].AllocRec(&cmp_ptr);
-							list->data[m] = cmp_ptr;
-							if (fread(ptr, 1, DB_REC_LEN, fp) != DB_REC_LEN)
-							{
-								fclose(fp);
-								return false;
-							}
-						}
-					}
-			}
-	fclose(fp);
-	return true;
+	free(recs);
+	return cnt == 0;
 }
 
-bool TFastBase::SaveToFile(char* fn)
+//file is written to temp file first, so existing file is replaced only when new one is complete
+//type byte of tames is a hits counter, if max_cnt is set only max_cnt most reached tames are saved, type is reset to TAME in the file
+bool TFastBase::SaveToFile(char* fn, bool compressed, u64 max_cnt)
 {
-	FILE* fp = fopen(fn, "wb");
-	if (!fp)
-		return false;
-	if (fwrite(Header, 1, sizeof(Header), fp) != sizeof(Header))
+	int min_hits = 0;
+	u64 min_hits_cnt = 0;
+	if (max_cnt)
 	{
-		fclose(fp);
-		return false;
+		u64 hist[TAMES_MAX_HITS + 1];
+		memset(hist, 0, sizeof(hist));
+		for (int i = 0; i < 256; i++)
+			for (int j = 0; j < 256; j++)
+				for (int k = 0; k < 256; k++)
+				{
+					TListRec* list = &lists[i][j][k];
+					for (int m = 0; m < list->cnt; m++)
+						hist[((u8*)mps[i].GetRecPtr(list->data[m]))[DB_REC_LEN - 1]]++;
+				}
+		SelectTamesByHits(hist, max_cnt, &min_hits, &min_hits_cnt);
 	}
-	for (int i = 0; i < 256; i++)
-		for (int j = 0; j < 256; j++)
+
+	char tmp_fn[1100];
+	sprintf(tmp_fn, "%s.tmp", fn);
+	TTamesWriter wr;
+	if (!wr.Open(tmp_fn, Header, compressed))
+		return false;
+	u8* recs = (u8*)malloc(TAMES_MAX_BUCKET * DB_REC_LEN);
+	bool res = true;
+	for (int i = 0; (i < 256) && res; i++)
+		for (int j = 0; (j < 256) && res; j++)
 			for (int k = 0; k < 256; k++)
 			{
 				TListRec* list = &lists[i][j][k];
-				fwrite(&list->cnt, 1, 2, fp);
+				int cnt = 0;
 				for (int m = 0; m < list->cnt; m++)
 				{
-					void* ptr = mps[i].GetRecPtr(list->data[m]);
-					if (fwrite(ptr, 1, DB_REC_LEN, fp) != DB_REC_LEN)
+					u8* rec = (u8*)mps[i].GetRecPtr(list->data[m]);
+					int hits = rec[DB_REC_LEN - 1];
+					if (hits < min_hits)
+						continue;
+					if (max_cnt && (hits == min_hits))
 					{
-						fclose(fp);
-						return false;
+						if (!min_hits_cnt)
+							continue;
+						min_hits_cnt--;
 					}
+					memcpy(recs + cnt * DB_REC_LEN, rec, DB_REC_LEN);
+					recs[cnt * DB_REC_LEN + DB_REC_LEN - 1] = TAME;
+					cnt++;
+				}
+				if (!wr.AddBucket((i << 16) | (j << 8) | k, recs, cnt))
+				{
+					res = false;
+					break;
 				}
 			}
+	free(recs);
+	if (!wr.Close())
+		res = false;
+	if (res)
+		res = RenameFile(tmp_fn, fn);
+	if (!res)
+		remove(tmp_fn);
+	return res;
+}
+
+bool IsFileExist(char* fn)
+{
+	FILE* fp = fopen(fn, "rb");
+	if (!fp)
+		return false;
 	fclose(fp);
 	return true;
 }
 
-bool IsFileExist(char* fn)
+bool StartThread(HHANDLER* h, TThrProc proc, void* data)
+{
+#ifdef _WIN32
+	u32 id;
+	*h = (HANDLE)_beginthreadex(NULL, 0, proc, data, 0, &id);
+	return *h != 0;
+#else
+	return pthread_create(h, NULL, proc, data) == 0;
+#endif
+}
+
+void WaitThread(HHANDLER h)
+{
+#ifdef _WIN32
+	WaitForSingleObject(h, INFINITE);
+	CloseHandle(h);
+#else
+	pthread_join(h, NULL);
+#endif
+}
+
+//flush stdio buffers and force data to the disk
+bool FlushFileToDisk(FILE* fp)
+{
+	if (fflush(fp))
+		return false;
+#ifdef _WIN32
+	return _commit(_fileno(fp)) == 0;
+#else
+	return fsync(fileno(fp)) == 0;
+#endif
+}
+
+u64 GetPhysRamSize()
+{
+#ifdef _WIN32
+	MEMORYSTATUSEX ms;
+	ms.dwLength = sizeof(ms);
+	if (!GlobalMemoryStatusEx(&ms))
+		return 0;
+	return ms.ullTotalPhys;
+#else
+	long pages = sysconf(_SC_PHYS_PAGES);
+	long page_size = sysconf(_SC_PAGE_SIZE);
+	if ((pages < 0) || (page_size < 0))
+		return 0;
+	return (u64)pages * page_size;
+#endif
+}
+
+//replaces dst if it exists
+bool RenameFile(char* src, char* dst)
+{
+#ifdef _WIN32
+	return MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return rename(src, dst) == 0;
+#endif
+}
+
+//reads file to OS cache so it's loaded fast later, file larger than max_size is not read
+bool ReadFileToCache(char* fn, u64 max_size)
 {
 	FILE* fp = fopen(fn, "rb");
 	if (!fp)
 		return false;
+	fseek64(fp, 0, SEEK_END);
+	u64 size = ftell64(fp);
+	fseek64(fp, 0, SEEK_SET);
+	bool res = size <= max_size;
+	if (res)
+	{
+		u8* buf = (u8*)malloc(4 * 1024 * 1024);
+		while (fread(buf, 1, 4 * 1024 * 1024, fp) == 4 * 1024 * 1024)
+			;
+		free(buf);
+	}
 	fclose(fp);
+	return res;
+}
+
+//names of files with extension ext in dir, without extension, sorted
+bool ListFiles(char* dir, const char* ext, std::vector <std::string>& names)
+{
+	std::vector <std::string> all;
+#ifdef _WIN32
+	char mask[1100];
+	sprintf(mask, "%s\\*", dir);
+	WIN32_FIND_DATAA fd;
+	HANDLE h = FindFirstFileA(mask, &fd);
+	if (h == INVALID_HANDLE_VALUE)
+		return false;
+	do
+	{
+		if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			all.push_back(fd.cFileName);
+	} while (FindNextFileA(h, &fd));
+	FindClose(h);
+#else
+	DIR* d = opendir(dir);
+	if (!d)
+		return false;
+	struct dirent* de;
+	while ((de = readdir(d)) != NULL)
+		all.push_back(de->d_name);
+	closedir(d);
+#endif
+	names.clear();
+	size_t ext_len = strlen(ext);
+	for (size_t i = 0; i < all.size(); i++)
+		if ((all[i].size() > ext_len) && !all[i].compare(all[i].size() - ext_len, ext_len, ext))
+			names.push_back(all[i].substr(0, all[i].size() - ext_len));
+	std::sort(names.begin(), names.end());
 	return true;
 }
@@ -9,6 +9,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <vector>
+#include <string>
 #include "defs.h"
 
 #ifdef _WIN32
@@ -25,6 +26,10 @@
 	#define UNLOCK_CS(cs)   LeaveCriticalSection((cs))
 
 	#define HHANDLER		HANDLE
+	#define THR_PROC(name)	u32 __stdcall name(void* data)
+	typedef u32 (__stdcall *TThrProc)(void*);
+	#define fseek64			_fseeki64
+	#define ftell64			_ftelli64
 
 #else
 	#include <math.h>
@@ -38,6 +43,10 @@
 	#define LOCK_CS(cs)		pthread_mutex_lock((cs))
 	#define UNLOCK_CS(cs)	pthread_mutex_unlock((cs))
 	#define HHANDLER		pthread_t
+	#define THR_PROC(name)	void* name(void* data)
+	typedef void* (*TThrProc)(void*);
+	#define fseek64			fseeko
+	#define ftell64			ftello
  
 	u64 GetTickCount64();
 	static void Sleep(int x) { usleep(x * 1000); }      
@@ -61,7 +70,18 @@ public:
 	void Leave() { UNLOCK_CS(&cs_body); };
 };
 
+//DB record is DBRec without first 3 bytes (they are used as index)
+#define DB_REC_LEN			32
+#define DB_FIND_LEN			9
+
 #pragma pack(push, 1)
+struct DBRec
+{
+	u8 x[12];
+	u8 d[22];
+	u8 type; //0 - tame, 1 - wild1, 2 - wild2
+};
+
 struct TListRec
 {
 	u16 cnt;
@@ -79,6 +99,7 @@ public:
 	MemPool();
 	~MemPool();
 	void Clear();
+	u64 GetMemSize();
 	inline void* AllocRec(u32* cmp_ptr);
 	inline void* GetRecPtr(u32 cmp_ptr);
 };
@@ -88,6 +109,8 @@ class TFastBase
 private:
 	MemPool mps[256];
 	TListRec lists[256][256][256];
+	u64 block_cnt; //counters are updated on every change, walking all lists takes too long for stats
+	u64 lists_size;
 	int lower_bound(TListRec* list, int mps_ind, u8* data);
 public:
 	u8 Header[256];
@@ -99,8 +122,17 @@ public:
 	u8* FindDataBlock(u8* data);
 	u8* FindOrAddDataBlock(u8* data);
 	u64 GetBlockCnt();
+	u64 GetMemSize();
 	bool LoadFromFile(char* fn);
-	bool SaveToFile(char* fn);
+	bool SaveToFile(char* fn, bool compressed = false, u64 max_cnt = 0);
 };
 
-bool IsFileExist(char* fn);
\ No newline at end of file
+bool IsFileExist(char* fn);
+bool StartThread(HHANDLER* h, TThrProc proc, void* data);
+void WaitThread(HHANDLER h);
+bool FlushFileToDisk(FILE* fp);
+bool RenameFile(char* src, char* dst);
+u64 GetTimeUs();
+u64 GetPhysRamSize();
+bool ReadFileToCache(char* fn, u64 max_size);
+bool ListFiles(char* dir, const char* ext, std::vector <std::string>& names);
\ No newline at end of file